@@ -0,0 +1,306 @@
+/**
+ * @file batchProcessor.cpp
+ * @brief Implementation of directory batch processing
+ */
+
+#include "batchProcessor.h"
+#include "fileHandler.h"
+#include "sidecarCache.h"
+#include "trace.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * @struct BatchScheduler
+ * @brief Shared state of the worker pool
+ */
+typedef struct {
+    std::mutex mutex;
+    std::condition_variable released;   ///< Signalled whenever memory is given back
+    std::vector<int> pending;           ///< Indices into the report, largest file first
+    long long reservedBytes;
+    long long peakReservedBytes;
+    int running;
+} BatchScheduler;
+
+/**
+ * Estimates the peak memory of one file from its estimated shape: the rows as
+ * counted by FileHandler_getAllocationStats plus heap overhead, the scratch of
+ * the keyed sort, and the copies taken by the result cache and sidecar writer.
+ */
+static long long estimateMemory(const BatchConfig* config, const char* path, long long fileBytes) {
+    long long rows;
+    int cols;
+    if (!FileHandler_estimateShape(path, fileBytes, &rows, &cols)) {
+        return 0;  // The load will fail without allocating
+    }
+    if (rows > INT_MAX) {
+        rows = INT_MAX;
+    }
+    long long allocations, bytes;
+    FileHandler_getAllocationStats((int)rows, cols, &allocations, &bytes);
+    long long need = bytes + allocations * BATCH_ALLOCATION_OVERHEAD;
+    need += sortCoordinatesByKeysScratchBytes(rows, config->nKeys, config->engine);
+    if (config->results) {
+        need += rows * (long long)sizeof(double*);  // Order before the sort, for the cached permutation
+    }
+    if (Sidecar_enabled()) {
+        need += rows * cols * (long long)sizeof(double);  // Contiguous copy handed to the sidecar writer
+    }
+    return need;
+}
+
+static char* copyString(const std::string& text) {
+    char* copy = (char*)malloc(text.size() + 1);
+    if (copy) {
+        memcpy(copy, text.c_str(), text.size() + 1);
+    }
+    return copy;
+}
+
+/**
+ * Takes the largest pending file whose estimate fits in the remaining budget,
+ * waiting for running files to finish if none does. A file larger than the
+ * whole budget is allowed to run on its own. Returns -1 when nothing is left.
+ */
+static int nextFile(BatchScheduler* scheduler, const BatchReport* report, long long budget) {
+    std::unique_lock<std::mutex> lock(scheduler->mutex);
+    while (!scheduler->pending.empty()) {
+        for (size_t i = 0; i < scheduler->pending.size(); i++) {
+            int index = scheduler->pending[i];
+            long long need = report->files[index].memoryBytes;
+            if (budget <= 0 || scheduler->running == 0 || scheduler->reservedBytes + need <= budget) {
+                scheduler->pending.erase(scheduler->pending.begin() + i);
+                scheduler->reservedBytes += need;
+                scheduler->running++;
+                if (scheduler->reservedBytes > scheduler->peakReservedBytes) {
+                    scheduler->peakReservedBytes = scheduler->reservedBytes;
+                }
+                return index;
+            }
+        }
+        scheduler->released.wait(lock);
+    }
+    return -1;
+}
+
+static void releaseFile(BatchScheduler* scheduler, long long memoryBytes) {
+    {
+        std::lock_guard<std::mutex> lock(scheduler->mutex);
+        scheduler->reservedBytes -= memoryBytes;
+        scheduler->running--;
+    }
+    scheduler->released.notify_all();
+}
+
+/** Engine name as used by the command line, so both share cached results */
+static const char* engineName(SortEngine engine) {
+    switch (engine) {
+        case SORT_ENGINE_BUBBLE: return "bubble";
+        case SORT_ENGINE_SELECTION: return "selection";
+        default: return "radix";
+    }
+}
+
+static void processFile(const BatchConfig* config, BatchFileResult* result) {
+    TRACE_SCOPE("batch.file");
+    SortStats* stats = &result->stats;
+    PhaseTimer timer;
+    PhaseTimer_start(&timer);
+    uint64_t contentHash = 0;
+    double** coordinates = FileHandler_loadCoordinatesHashed(result->input, &result->rows, &result->cols, &contentHash);
+    int hashed = config->results != NULL;
+    PhaseTimer_stop(&timer, stats, PHASE_LOAD);
+    if (!coordinates) {
+        return;
+    }
+    FileHandler_getAllocationStats(result->rows, result->cols, &stats->allocations, &stats->allocatedBytes);
+    if (!SortKeys_isValid(config->keys, config->nKeys, result->cols)) {
+        FileHandler_freeCoordinates(coordinates, result->rows);
+        return;
+    }
+
+    ResultKey resultKey;
+    ResultCache_makeKey(&resultKey, contentHash, config->keys, config->nKeys,
+                        engineName(config->engine), result->rows, result->cols);
+    if (hashed) {
+        PhaseTimer_start(&timer);
+        result->cached = ResultCache_apply(config->results, &resultKey, coordinates);
+        PhaseTimer_stop(&timer, stats, PHASE_SORT);
+    }
+    if (!result->cached) {
+        double** original = hashed ? (double**)malloc(result->rows * sizeof(double*)) : NULL;
+        if (original) {
+            memcpy(original, coordinates, result->rows * sizeof(double*));
+        }
+        SortStats sortStats = sortCoordinatesByKeys(coordinates, result->rows, result->cols,
+                                                    config->keys, config->nKeys, config->engine);
+        SortStats_add(stats, &sortStats);
+        if (original) {
+            ResultCache_record(config->results, &resultKey, original, coordinates);
+            free(original);
+        }
+    }
+
+    PhaseTimer_start(&timer);
+    result->ok = FileHandler_saveCoordinates(result->output, coordinates, result->rows, result->cols);
+    PhaseTimer_stop(&timer, stats, PHASE_SAVE);
+    FileHandler_freeCoordinates(coordinates, result->rows);
+}
+
+void BatchProcessor_defaults(BatchConfig* config, const char* inputDir, const char* outputDir) {
+    config->inputDir = inputDir;
+    config->outputDir = outputDir;
+    config->extension = "csv";
+    config->engine = SORT_ENGINE_RADIX;
+    config->nKeys = SortKeys_parse("sum", config->keys, MAX_SORT_KEYS);
+    config->jobs = 0;
+    config->memoryBudgetBytes = 0;
+    config->results = NULL;
+}
+
+int BatchProcessor_run(const BatchConfig* config, BatchReport* report) {
+    TRACE_SCOPE("BatchProcessor_run");
+    memset(report, 0, sizeof(BatchReport));
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code error;
+    fs::create_directories(config->outputDir, error);
+    if (fs::equivalent(config->inputDir, config->outputDir, error)) {
+        fprintf(stderr, "Output directory must differ from the input directory: %s\n", config->outputDir);
+        return 0;
+    }
+    if (!fs::is_directory(config->outputDir, error)) {
+        fprintf(stderr, "Error creating output directory: %s\n", config->outputDir);
+        return 0;
+    }
+
+    // Collect matching files with their sizes
+    std::string wanted = std::string(".") + config->extension;
+    std::vector<std::pair<long long, fs::path>> found;
+    fs::directory_iterator it(config->inputDir, error);
+    if (error) {
+        fprintf(stderr, "Error reading directory: %s\n", config->inputDir);
+        return 0;
+    }
+    for (const fs::directory_entry& entry : it) {
+        if (entry.is_regular_file(error) && entry.path().extension() == wanted) {
+            found.emplace_back((long long)entry.file_size(error), entry.path());
+        }
+    }
+
+    // Largest first, name order among equal sizes so runs are repeatable
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    report->files = (BatchFileResult*)calloc(found.size() ? found.size() : 1, sizeof(BatchFileResult));
+    if (!report->files) {
+        return 0;
+    }
+    report->count = (int)found.size();
+    BatchScheduler scheduler;
+    scheduler.reservedBytes = 0;
+    scheduler.peakReservedBytes = 0;
+    scheduler.running = 0;
+    for (int i = 0; i < report->count; i++) {
+        BatchFileResult* result = &report->files[i];
+        result->input = copyString(found[i].second.string());
+        result->output = copyString((fs::path(config->outputDir) / found[i].second.filename()).string());
+        result->fileBytes = found[i].first;
+        result->memoryBytes = result->input ? estimateMemory(config, result->input, result->fileBytes) : 0;
+        scheduler.pending.push_back(i);
+    }
+
+    int jobs = config->jobs > 0 ? config->jobs : (int)std::thread::hardware_concurrency();
+    if (jobs < 1) jobs = 1;
+    if (jobs > report->count) jobs = report->count > 0 ? report->count : 1;
+    report->jobs = jobs;
+
+    auto worker = [&]() {
+        TRACE_THREAD_NAME("batch worker");
+        int index;
+        while ((index = nextFile(&scheduler, report, config->memoryBudgetBytes)) >= 0) {
+            BatchFileResult* result = &report->files[index];
+            if (result->input && result->output) {
+                processFile(config, result);
+            }
+            releaseFile(&scheduler, result->memoryBytes);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < jobs; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();  // The calling thread works too
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    for (int i = 0; i < report->count; i++) {
+        if (!report->files[i].ok) report->failed++;
+    }
+    report->peakReservedBytes = scheduler.peakReservedBytes;
+    report->wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return 1;
+}
+
+void BatchProcessor_printReport(FILE* file, const BatchReport* report) {
+    fprintf(file, "%-40s %12s %10s %5s %10s %10s %10s  %s\n",
+            "File", "Bytes", "Rows", "Cols", "Load ms", "Sort ms", "Save ms", "Status");
+    long long totalBytes = 0, totalRows = 0;
+    for (int i = 0; i < report->count; i++) {
+        const BatchFileResult* result = &report->files[i];
+        const PhaseTime* phases = result->stats.phases;
+        const char* name = strrchr(result->input, '/');
+#ifdef _WIN32
+        const char* backslash = strrchr(result->input, '\\');
+        if (!name || (backslash && backslash > name)) name = backslash;
+#endif
+        name = name ? name + 1 : result->input;
+        fprintf(file, "%-40.40s %12lld %10d %5d %10.2f %10.2f %10.2f  %s\n",
+                name, result->fileBytes, result->rows, result->cols,
+                phases[PHASE_LOAD].wallMs, phases[PHASE_KEYS].wallMs + phases[PHASE_SORT].wallMs,
+                phases[PHASE_SAVE].wallMs, !result->ok ? "FAILED" : result->cached ? "cached" : "ok");
+        totalBytes += result->fileBytes;
+        totalRows += result->rows;
+    }
+
+    double seconds = report->wallMs / 1000.0;
+    fprintf(file, "\n%d files (%d failed), %lld rows, %.1f MB in %.2f s with %d workers",
+            report->count, report->failed, totalRows, totalBytes / (1024.0 * 1024.0), seconds, report->jobs);
+    if (seconds > 0) {
+        fprintf(file, ": %.1f files/s, %.1f MB/s", report->count / seconds, totalBytes / (1024.0 * 1024.0) / seconds);
+    }
+    fprintf(file, "\nPeak estimated memory in use: %.1f MB\n", report->peakReservedBytes / (1024.0 * 1024.0));
+}
+
+void BatchProcessor_writeJson(FILE* file, const BatchReport* report, const char* label) {
+    for (int i = 0; i < report->count; i++) {
+        const BatchFileResult* result = &report->files[i];
+        SortStats_writeJson(file, &result->stats, result->ok ? label : "failed",
+                            result->input, result->rows, result->cols);
+    }
+}
+
+void BatchProcessor_freeReport(BatchReport* report) {
+    if (report->files) {
+        for (int i = 0; i < report->count; i++) {
+            free(report->files[i].input);
+            free(report->files[i].output);
+        }
+        free(report->files);
+    }
+    memset(report, 0, sizeof(BatchReport));
+}
@@ -0,0 +1,105 @@
+/**
+ * @file batchProcessor.h
+ * @brief Concurrent load, sort and save of every matching file in a directory
+ *
+ * Files are scheduled largest first across a pool of worker threads so the
+ * long jobs start early and the small ones fill in the gaps at the end. Each
+ * file reserves an estimate of its in-memory size before it is loaded; a
+ * worker only starts a file that fits in what is left of the memory budget.
+ */
+
+#ifndef BATCH_PROCESSOR_H
+#define BATCH_PROCESSOR_H
+
+#include <stdio.h>
+#include "sortEngine.h"
+#include "resultCache.h"
+
+/** Heap bookkeeping assumed per allocation when estimating a file's memory */
+#define BATCH_ALLOCATION_OVERHEAD 16
+
+/**
+ * @struct BatchConfig
+ * @brief What to process and how
+ */
+typedef struct {
+    const char* inputDir;         ///< Directory to scan (not recursive)
+    const char* outputDir;        ///< Where sorted files are written (created if missing)
+    const char* extension;        ///< File extension to match, without the dot
+    SortEngine engine;
+    SortKey keys[MAX_SORT_KEYS];
+    int nKeys;
+    int jobs;                     ///< Worker threads, 0 = one per hardware thread
+    long long memoryBudgetBytes;  ///< Cap on estimated memory in use, 0 = unlimited
+    ResultCache* results;         ///< Memoized sort results shared by the workers, NULL = none
+} BatchConfig;
+
+/**
+ * @struct BatchFileResult
+ * @brief Outcome for one file
+ */
+typedef struct {
+    char* input;            ///< Input path
+    char* output;           ///< Output path
+    long long fileBytes;    ///< Input file size
+    long long memoryBytes;  ///< Estimated peak memory, reserved while the file runs
+    int rows;
+    int cols;
+    int ok;                 ///< 1 if the file was loaded, sorted and saved
+    int cached;             ///< 1 if the sort was replayed from the result cache
+    SortStats stats;        ///< Load, key, sort and save figures for this file
+} BatchFileResult;
+
+/**
+ * @struct BatchReport
+ * @brief Results of a batch run, in scheduling order (largest file first)
+ */
+typedef struct {
+    BatchFileResult* files;
+    int count;
+    int failed;
+    int jobs;                      ///< Worker threads used
+    double wallMs;                 ///< Elapsed time for the whole batch
+    long long peakReservedBytes;   ///< Highest total of concurrent memory estimates
+} BatchReport;
+
+/**
+ * @brief Fills a configuration with defaults (csv files, radix sort by row sum, no memory cap, no result cache)
+ * @param config Configuration to initialise
+ * @param inputDir Directory to scan
+ * @param outputDir Directory for sorted files
+ */
+void BatchProcessor_defaults(BatchConfig* config, const char* inputDir, const char* outputDir);
+
+/**
+ * @brief Loads, sorts and saves every matching file
+ * @param config What to process
+ * @param report Output parameter for per-file results
+ * @return 1 if the batch ran (individual files may still have failed), 0 if the
+ *         input directory could not be read or the output directory created
+ * @note Free the report with BatchProcessor_freeReport
+ */
+int BatchProcessor_run(const BatchConfig* config, BatchReport* report);
+
+/**
+ * @brief Prints a per-file table and totals
+ * @param file Destination stream
+ * @param report Results to print
+ */
+void BatchProcessor_printReport(FILE* file, const BatchReport* report);
+
+/**
+ * @brief Writes one JSON line per file (same schema as lab06_stats.jsonl)
+ * @param file Destination stream
+ * @param report Results to write
+ * @param label Label recorded for every file
+ */
+void BatchProcessor_writeJson(FILE* file, const BatchReport* report, const char* label);
+
+/**
+ * @brief Frees the memory owned by a report
+ * @param report Report to free
+ */
+void BatchProcessor_freeReport(BatchReport* report);
+
+#endif // BATCH_PROCESSOR_H
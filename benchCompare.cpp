@@ -0,0 +1,388 @@
+/**
+ * @file benchCompare.cpp
+ * @brief Compares two Lab06_bench JSON files and flags performance regressions
+ *
+ * For every benchmark present in both files the tool compares the median of
+ * the raw samples and estimates a confidence interval for the ratio of the
+ * medians by bootstrap resampling. A benchmark is a regression when its
+ * median slowed down by more than the threshold AND the whole confidence
+ * interval lies above 1, so noisy benchmarks are not flagged on one bad run.
+ *
+ * Usage:
+ *   Lab06_bench_compare baseline.json current.json [--threshold 5]
+ *                       [--confidence 0.95] [--resamples 2000] [--filter text]
+ *
+ * Exit status: 0 = no regressions, 1 = at least one regression, 2 = bad input
+ * (including a baseline benchmark missing from the current file, a benchmark
+ * with too few samples to compare, or nothing compared at all).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/** Smallest sample count per side for which a confidence interval is computed */
+#define COMPARE_MIN_SAMPLES 3
+
+/**
+ * @struct BenchRecord
+ * @brief One benchmark from a results file
+ */
+typedef struct {
+    std::string name;
+    std::vector<double> samples;
+} BenchRecord;
+
+/**
+ * @struct JsonReader
+ * @brief Cursor over a JSON document
+ *
+ * Only as much of JSON as Lab06_bench writes is interpreted; everything else
+ * is skipped structurally so extra fields do not break older tools.
+ */
+typedef struct {
+    const char* p;
+    int ok;
+} JsonReader;
+
+static void skipSpace(JsonReader* reader) {
+    while (isspace((unsigned char)*reader->p)) reader->p++;
+}
+
+static int expect(JsonReader* reader, char c) {
+    skipSpace(reader);
+    if (*reader->p != c) {
+        reader->ok = 0;
+        return 0;
+    }
+    reader->p++;
+    return 1;
+}
+
+static std::string readString(JsonReader* reader) {
+    std::string text;
+    if (!expect(reader, '"')) return text;
+    while (*reader->p && *reader->p != '"') {
+        if (*reader->p == '\\' && reader->p[1]) {
+            reader->p++;
+            if (*reader->p == 'u') {
+                // Benchmark names are ASCII; keep escaped characters as '?'
+                for (int i = 0; i < 4 && reader->p[1]; i++) reader->p++;
+                text += '?';
+            } else {
+                text += *reader->p == 'n' ? '\n' : *reader->p == 't' ? '\t' : *reader->p;
+            }
+        } else {
+            text += *reader->p;
+        }
+        reader->p++;
+    }
+    expect(reader, '"');
+    return text;
+}
+
+static double readNumber(JsonReader* reader) {
+    skipSpace(reader);
+    char* end;
+    double value = strtod(reader->p, &end);
+    if (end == reader->p) reader->ok = 0;
+    reader->p = end;
+    return value;
+}
+
+static void skipValue(JsonReader* reader);
+
+/** Calls onMember(key) for each member of an object; onMember must consume the value */
+template <typename OnMember>
+static void readObject(JsonReader* reader, OnMember onMember) {
+    if (!expect(reader, '{')) return;
+    skipSpace(reader);
+    if (*reader->p == '}') {
+        reader->p++;
+        return;
+    }
+    while (reader->ok) {
+        std::string key = readString(reader);
+        if (!expect(reader, ':')) return;
+        onMember(key);
+        skipSpace(reader);
+        if (*reader->p == ',') {
+            reader->p++;
+        } else {
+            expect(reader, '}');
+            return;
+        }
+    }
+}
+
+/** Calls onElement() for each element of an array; onElement must consume the value */
+template <typename OnElement>
+static void readArray(JsonReader* reader, OnElement onElement) {
+    if (!expect(reader, '[')) return;
+    skipSpace(reader);
+    if (*reader->p == ']') {
+        reader->p++;
+        return;
+    }
+    while (reader->ok) {
+        onElement();
+        skipSpace(reader);
+        if (*reader->p == ',') {
+            reader->p++;
+        } else {
+            expect(reader, ']');
+            return;
+        }
+    }
+}
+
+static void skipValue(JsonReader* reader) {
+    skipSpace(reader);
+    char c = *reader->p;
+    if (c == '{') {
+        readObject(reader, [&](const std::string&) { skipValue(reader); });
+    } else if (c == '[') {
+        readArray(reader, [&]() { skipValue(reader); });
+    } else if (c == '"') {
+        readString(reader);
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        while (isalpha((unsigned char)*reader->p)) reader->p++;
+    } else {
+        readNumber(reader);
+    }
+}
+
+static char* readFile(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        printf("Error opening file: %s\n", filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc(size + 1);
+    if (text) {
+        size_t length = fread(text, 1, size, file);
+        text[length] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+/** Loads the "benchmarks" array of a Lab06_bench JSON file */
+static int loadResults(const char* filename, std::vector<BenchRecord>& records) {
+    char* text = readFile(filename);
+    if (!text) {
+        return 0;
+    }
+    JsonReader reader = {text, 1};
+    readObject(&reader, [&](const std::string& key) {
+        if (key != "benchmarks") {
+            skipValue(&reader);
+            return;
+        }
+        readArray(&reader, [&]() {
+            BenchRecord record;
+            readObject(&reader, [&](const std::string& field) {
+                if (field == "name") {
+                    record.name = readString(&reader);
+                } else if (field == "samples_ns") {
+                    readArray(&reader, [&]() { record.samples.push_back(readNumber(&reader)); });
+                } else {
+                    skipValue(&reader);
+                }
+            });
+            if (!record.name.empty() && !record.samples.empty()) {
+                records.push_back(record);
+            }
+        });
+    });
+    free(text);
+    if (!reader.ok) {
+        printf("Malformed benchmark file: %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+/** xorshift64*: deterministic resampling so the same inputs always give the same verdict */
+static unsigned long long nextRandom(unsigned long long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static std::vector<double> resample(const std::vector<double>& values, unsigned long long* state) {
+    std::vector<double> drawn(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        drawn[i] = values[nextRandom(state) % values.size()];
+    }
+    return drawn;
+}
+
+/**
+ * Percentile bootstrap interval for median(current) / median(baseline).
+ * Returns 0 when there are too few samples for an interval to mean anything.
+ */
+static int bootstrapRatio(const std::vector<double>& baseline, const std::vector<double>& current,
+                          double confidence, int resamples, double* low, double* high) {
+    if ((int)baseline.size() < COMPARE_MIN_SAMPLES || (int)current.size() < COMPARE_MIN_SAMPLES) {
+        return 0;
+    }
+    unsigned long long state = 0x9e3779b97f4a7c15ULL;
+    std::vector<double> ratios;
+    ratios.reserve(resamples);
+    for (int r = 0; r < resamples; r++) {
+        double base = median(resample(baseline, &state));
+        if (base > 0) {
+            ratios.push_back(median(resample(current, &state)) / base);
+        }
+    }
+    if (ratios.empty()) {
+        return 0;
+    }
+    std::sort(ratios.begin(), ratios.end());
+    double tail = (1.0 - confidence) / 2.0;
+    size_t last = ratios.size() - 1;
+    *low = ratios[(size_t)(tail * last)];
+    *high = ratios[(size_t)ceil((1.0 - tail) * last)];
+    return 1;
+}
+
+static void printUsage(void) {
+    printf("Usage: Lab06_bench_compare BASELINE.json CURRENT.json [options]\n");
+    printf("  --threshold PCT     Slowdown that counts as a regression (default 5)\n");
+    printf("  --confidence P      Confidence level of the interval (default 0.95)\n");
+    printf("  --resamples N       Bootstrap resamples (default 2000)\n");
+    printf("  --filter TEXT       Only compare benchmarks whose name contains TEXT\n");
+    printf("Exit status: 0 = no regressions, 1 = regressions found, 2 = bad input, a missing benchmark,\n");
+    printf("             too few samples or nothing compared\n");
+}
+
+int main(int argc, char** argv) {
+    const char* files[2] = {NULL, NULL};
+    int nFiles = 0;
+    double threshold = 5.0;
+    double confidence = 0.95;
+    int resamples = 2000;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (strncmp(arg, "--", 2) != 0) {
+            if (nFiles == 2) {
+                printUsage();
+                return 2;
+            }
+            files[nFiles++] = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printf("Missing value for %s\n", arg);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--threshold") == 0) {
+            threshold = atof(value);
+        } else if (strcmp(arg, "--confidence") == 0) {
+            confidence = atof(value);
+        } else if (strcmp(arg, "--resamples") == 0) {
+            resamples = atoi(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            filter = value;
+        } else {
+            printf("Invalid argument: %s\n", arg);
+            printUsage();
+            return 2;
+        }
+    }
+    if (nFiles != 2 || threshold < 0 || confidence <= 0 || confidence >= 1 || resamples < 100) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<BenchRecord> baseline, current;
+    if (!loadResults(files[0], baseline) || !loadResults(files[1], current)) {
+        return 2;
+    }
+
+    printf("%-64s %12s %12s %9s %19s  %s\n", "Benchmark", "Base (ns)", "New (ns)", "Change", "CI", "Verdict");
+    int regressions = 0, improvements = 0, compared = 0, missing = 0, unchecked = 0;
+    for (const BenchRecord& base : baseline) {
+        if (filter && !strstr(base.name.c_str(), filter)) continue;
+        const BenchRecord* now = NULL;
+        for (const BenchRecord& candidate : current) {
+            if (candidate.name == base.name) {
+                now = &candidate;
+                break;
+            }
+        }
+        if (!now) {
+            missing++;
+            continue;
+        }
+        compared++;
+
+        double baseMedian = median(base.samples);
+        double newMedian = median(now->samples);
+        double ratio = baseMedian > 0 ? newMedian / baseMedian : 1.0;
+        double low = ratio, high = ratio;
+        int haveInterval = bootstrapRatio(base.samples, now->samples, confidence, resamples, &low, &high);
+        double limit = 1.0 + threshold / 100.0;
+
+        const char* verdict = "same";
+        if (!haveInterval) {
+            verdict = "TOO FEW SAMPLES";
+            unchecked++;
+        } else if (ratio > limit && low > 1.0) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (ratio < 1.0 / limit && high < 1.0) {
+            verdict = "improved";
+            improvements++;
+        } else if (ratio > limit || ratio < 1.0 / limit) {
+            verdict = "noisy";
+        }
+
+        char interval[32] = "-";
+        if (haveInterval) {
+            snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", (low - 1) * 100, (high - 1) * 100);
+        }
+        printf("%-64s %12.0f %12.0f %+8.1f%% %19s  %s\n", base.name.c_str(), baseMedian, newMedian,
+               (ratio - 1) * 100, interval, verdict);
+    }
+
+    printf("\n%d compared, %d regressions, %d improvements", compared, regressions, improvements);
+    if (missing) {
+        printf(", %d only in baseline", missing);
+    }
+    if (unchecked) {
+        printf(", %d with too few samples", unchecked);
+    }
+    printf(" (threshold %.1f%%, %.0f%% confidence)\n", threshold, confidence * 100);
+    if (compared == 0) {
+        printf("No benchmark is in both files%s\n", filter ? " and matches the filter" : "");
+    }
+    if (unchecked || missing || compared == 0) {
+        // A benchmark that could not be checked must not pass the gate silently
+        return 2;
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file benchCompareTest.cpp
+ * @brief Exit status checks of Lab06_bench_compare (run by ctest)
+ *
+ * Usage: Lab06_test_benchCompare PATH_TO_Lab06_bench_compare
+ * Writes small result files to the working directory and checks the exit
+ * status of the compare tool on each pair.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+static int g_failures = 0;
+
+/** Writes a results file holding the given "benchmarks" array entries */
+static void writeResults(const char* filename, const char* benchmarks) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        printf("FAIL cannot write %s\n", filename);
+        exit(1);
+    }
+    fprintf(file, "{\"tool\": \"Lab06_bench\", \"benchmarks\": [%s]}\n", benchmarks);
+    fclose(file);
+}
+
+/** Runs the compare tool on the two files with extra arguments and checks its exit status */
+static void checkStatus(const char* tool, const char* baseline, const char* current, const char* extra,
+                        int expected, const char* name) {
+    std::string command = std::string("\"") + tool + "\" " + baseline + " " + current + " " + extra;
+#ifdef _WIN32
+    command += " > NUL";
+    int status = system(command.c_str());
+#else
+    command += " > /dev/null";
+    int status = system(command.c_str());
+    status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+    if (status != expected) {
+        printf("FAIL %s: exit status %d, expected %d\n", name, status, expected);
+        g_failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        printf("Usage: %s PATH_TO_Lab06_bench_compare\n", argv[0]);
+        return 1;
+    }
+    const char* tool = argv[1];
+
+    const char* steady = "{\"name\": \"sort/a\", \"samples_ns\": [100, 101, 99, 100, 100]},"
+                         "{\"name\": \"sort/b\", \"samples_ns\": [200, 201, 199, 200, 200]}";
+    writeResults("compare_base.json", steady);
+    writeResults("compare_same.json", steady);
+    writeResults("compare_slower.json",
+                 "{\"name\": \"sort/a\", \"samples_ns\": [150, 151, 149, 150, 150]},"
+                 "{\"name\": \"sort/b\", \"samples_ns\": [200, 201, 199, 200, 200]}");
+    writeResults("compare_missing.json", "{\"name\": \"sort/a\", \"samples_ns\": [100, 101, 99, 100, 100]}");
+    writeResults("compare_few.json",
+                 "{\"name\": \"sort/a\", \"samples_ns\": [100]},"
+                 "{\"name\": \"sort/b\", \"samples_ns\": [200, 201, 199, 200, 200]}");
+    writeResults("compare_empty.json", "");
+
+    checkStatus(tool, "compare_base.json", "compare_same.json", "", 0, "unchanged");
+    checkStatus(tool, "compare_base.json", "compare_slower.json", "", 1, "regression");
+    checkStatus(tool, "compare_base.json", "compare_missing.json", "", 2, "benchmark missing from current");
+    checkStatus(tool, "compare_base.json", "compare_few.json", "", 2, "too few samples");
+    checkStatus(tool, "compare_base.json", "compare_empty.json", "", 2, "current has no benchmarks");
+    checkStatus(tool, "compare_empty.json", "compare_empty.json", "", 2, "nothing to compare");
+    checkStatus(tool, "compare_base.json", "compare_same.json", "--filter parse/", 2, "filter matches nothing");
+    checkStatus(tool, "compare_base.json", "compare_missing.json", "--filter sort/a", 0, "filter skips the missing one");
+    checkStatus(tool, "compare_base.json", "compare_nonexistent.json", "", 2, "unreadable file");
+
+    if (g_failures == 0) {
+        printf("All compare checks passed\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
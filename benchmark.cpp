@@ -0,0 +1,414 @@
+/**
+ * @file benchmark.cpp
+ * @brief Microbenchmarks for the load, key, sort and save paths
+ *
+ * Every benchmark is run for each combination of row count (n), components
+ * per row (m) and input distribution. Each repetition produces one sample;
+ * very fast cases run several iterations per sample so a sample lasts at
+ * least BENCH_MIN_SAMPLE_NS. Results are printed as a table and can be
+ * written as JSON for later comparison.
+ *
+ * Usage:
+ *   Lab06_bench [--n 10,1000,100000] [--m 2,3,64] [--dist uniform,clusters,...]
+ *               [--reps 5] [--max-quadratic-n 10000] [--filter text]
+ *               [--json results.json]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include "datasetGenerator.h"
+#include "fileHandler.h"
+#include "sortEngine.h"
+
+/** Shortest time a single sample should cover */
+#define BENCH_MIN_SAMPLE_NS 1000000LL
+/** Upper bound on iterations folded into one sample */
+#define BENCH_MAX_ITERATIONS 100000
+
+/**
+ * @struct Dataset
+ * @brief Coordinates in one contiguous block plus row pointers
+ */
+typedef struct {
+    double* block;
+    double** rows;
+    int n;
+    int m;
+} Dataset;
+
+/**
+ * @struct BenchResult
+ * @brief Samples and derived figures for one benchmark case
+ */
+typedef struct {
+    char name[128];
+    char group[16];        ///< "sort", "keys", "parse" or "write"
+    char variant[48];      ///< Engine or operation name
+    int n;
+    int m;
+    int distribution;
+    long long bytes;       ///< Bytes processed per iteration (parse/write), else 0
+    long long comparisons; ///< From the counting variant of a sort, else 0
+    long long swaps;
+    std::vector<double> samplesNs;
+} BenchResult;
+
+/**
+ * @struct BenchEngine
+ * @brief A sort entry point under test
+ */
+typedef struct {
+    const char* name;
+    int quadratic;  ///< Non-zero for O(n^2) engines, which are capped in n
+    SortStats (*run)(double** coordinates, int n, int m);
+} BenchEngine;
+
+static const SortKey SUM_KEY = {SORT_KEY_SUM, 0, 0};
+
+template <typename Stats, SortEngine Engine>
+static SortStats runKeyed(double** coordinates, int n, int m) {
+    return sortCoordinatesByKeysWith<Stats>(coordinates, n, m, &SUM_KEY, 1, Engine);
+}
+
+static const BenchEngine ENGINES[] = {
+    {"bubble/none",            1, sortCoordinatesWith<NoSortStats>},
+    {"bubble/counting",        1, sortCoordinatesWith<CountingSortStats>},
+    {"optimised/none",         1, optimisedSortCoordinatesWith<NoSortStats>},
+    {"optimised/counting",     1, optimisedSortCoordinatesWith<CountingSortStats>},
+    {"keyed-bubble/none",      1, runKeyed<NoSortStats, SORT_ENGINE_BUBBLE>},
+    {"keyed-bubble/counting",  1, runKeyed<CountingSortStats, SORT_ENGINE_BUBBLE>},
+    {"keyed-selection/none",   1, runKeyed<NoSortStats, SORT_ENGINE_SELECTION>},
+    {"keyed-selection/counting", 1, runKeyed<CountingSortStats, SORT_ENGINE_SELECTION>},
+    {"keyed-radix/none",       0, runKeyed<NoSortStats, SORT_ENGINE_RADIX>},
+    {"keyed-radix/counting",   0, runKeyed<CountingSortStats, SORT_ENGINE_RADIX>},
+};
+static const int NUM_ENGINES = sizeof(ENGINES) / sizeof(ENGINES[0]);
+
+/**
+ * @struct BenchOptions
+ * @brief Command-line configuration
+ */
+typedef struct {
+    std::vector<int> sizes;
+    std::vector<int> dims;
+    std::vector<int> dists;
+    int repetitions;
+    int maxQuadraticN;
+    const char* filter;
+    const char* jsonPath;
+} BenchOptions;
+
+static long long nowNs(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int makeDataset(Dataset* data, int n, int m, int dist, unsigned long long seed) {
+    data->n = n;
+    data->m = m;
+    data->block = (double*)malloc((size_t)n * m * sizeof(double));
+    data->rows = (double**)malloc((size_t)n * sizeof(double*));
+    if (!data->block || !data->rows) {
+        free(data->block);
+        free(data->rows);
+        return 0;
+    }
+
+    GeneratorConfig config;
+    DatasetGenerator_defaults(&config);
+    config.rows = n;
+    config.cols = m;
+    config.distribution = (GeneratorDistribution)dist;
+    config.seed = seed;
+    DatasetGenerator_fill(&config, data->block);
+    for (int i = 0; i < n; i++) {
+        data->rows[i] = data->block + (size_t)i * m;
+    }
+    return 1;
+}
+
+static void freeDataset(Dataset* data) {
+    free(data->block);
+    free(data->rows);
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+static int matchesFilter(const BenchOptions* options, const char* name) {
+    return !options->filter || strstr(name, options->filter) != NULL;
+}
+
+/**
+ * Measures body() and returns the time per call in nanoseconds, running
+ * enough calls per sample to cover BENCH_MIN_SAMPLE_NS.
+ */
+template <typename Body>
+static void collectSamples(BenchResult* result, int repetitions, Body body) {
+    // Calibrate the iteration count on a warm-up run
+    long long start = nowNs();
+    body();
+    long long single = nowNs() - start;
+    int iterations = 1;
+    if (single < BENCH_MIN_SAMPLE_NS) {
+        iterations = (int)(BENCH_MIN_SAMPLE_NS / (single > 0 ? single : 1)) + 1;
+        if (iterations > BENCH_MAX_ITERATIONS) iterations = BENCH_MAX_ITERATIONS;
+    }
+
+    for (int r = 0; r < repetitions; r++) {
+        start = nowNs();
+        for (int i = 0; i < iterations; i++) {
+            body();
+        }
+        result->samplesNs.push_back((double)(nowNs() - start) / iterations);
+    }
+}
+
+static void initResult(BenchResult* result, const char* group, const char* variant,
+                       const Dataset* data, int dist) {
+    snprintf(result->group, sizeof(result->group), "%s", group);
+    snprintf(result->variant, sizeof(result->variant), "%s", variant);
+    snprintf(result->name, sizeof(result->name), "%s/%s/n=%d/m=%d/%s",
+             group, variant, data->n, data->m, DatasetGenerator_distributionName((GeneratorDistribution)dist));
+    result->n = data->n;
+    result->m = data->m;
+    result->distribution = dist;
+    result->bytes = 0;
+    result->comparisons = 0;
+    result->swaps = 0;
+}
+
+static void benchSorts(const BenchOptions* options, const Dataset* data, int dist,
+                       std::vector<BenchResult>& results) {
+    std::vector<double*> work(data->n);
+    for (int e = 0; e < NUM_ENGINES; e++) {
+        const BenchEngine* engine = &ENGINES[e];
+        BenchResult result;
+        initResult(&result, "sort", engine->name, data, dist);
+        if (!matchesFilter(options, result.name)) continue;
+        if (engine->quadratic && data->n > options->maxQuadraticN) continue;
+
+        SortStats stats = {};
+        collectSamples(&result, options->repetitions, [&]() {
+            memcpy(work.data(), data->rows, data->n * sizeof(double*));
+            stats = engine->run(work.data(), data->n, data->m);
+        });
+        result.comparisons = stats.comparisons;
+        result.swaps = stats.swaps;
+        results.push_back(result);
+    }
+}
+
+static void benchKeys(const BenchOptions* options, const Dataset* data, int dist,
+                      std::vector<BenchResult>& results) {
+    BenchResult result;
+    initResult(&result, "keys", "rowsum", data, dist);
+    if (!matchesFilter(options, result.name)) return;
+
+    std::vector<double> sums(data->n);
+    collectSamples(&result, options->repetitions, [&]() {
+        for (int i = 0; i < data->n; i++) {
+            sums[i] = calculateRowSum(data->rows[i], data->m);
+        }
+    });
+    results.push_back(result);
+}
+
+static void benchFiles(const BenchOptions* options, const Dataset* data, int dist,
+                       std::vector<BenchResult>& results) {
+    BenchResult write, parse;
+    initResult(&write, "write", "FileHandler_saveCoordinates", data, dist);
+    initResult(&parse, "parse", "FileHandler_readCoordinates", data, dist);
+    int doWrite = matchesFilter(options, write.name);
+    int doParse = matchesFilter(options, parse.name);
+    if (!doWrite && !doParse) return;
+
+    std::string path = (std::filesystem::temp_directory_path() / "lab06_bench.csv").string();
+    FileHandler_saveCoordinates(path.c_str(), data->rows, data->n, data->m);
+    std::error_code error;
+    long long fileBytes = (long long)std::filesystem::file_size(path, error);
+
+    if (doWrite) {
+        write.bytes = fileBytes;
+        collectSamples(&write, options->repetitions, [&]() {
+            FileHandler_saveCoordinates(path.c_str(), data->rows, data->n, data->m);
+        });
+        results.push_back(write);
+    }
+    if (doParse) {
+        parse.bytes = fileBytes;
+        collectSamples(&parse, options->repetitions, [&]() {
+            int rows = 0, cols = 0;
+            double** coordinates = FileHandler_readCoordinates(path.c_str(), &rows, &cols);
+            FileHandler_freeCoordinates(coordinates, rows);
+        });
+        results.push_back(parse);
+    }
+    std::filesystem::remove(path, error);
+}
+
+static void printTable(const std::vector<BenchResult>& results) {
+    printf("\n%-64s %14s %14s %14s %10s\n", "Benchmark", "Median (ns)", "Min (ns)", "Rows/s", "MB/s");
+    for (const BenchResult& result : results) {
+        double med = median(result.samplesNs);
+        double best = *std::min_element(result.samplesNs.begin(), result.samplesNs.end());
+        double rowsPerSecond = med > 0 ? result.n * 1e9 / med : 0.0;
+        printf("%-64s %14.0f %14.0f %14.3g", result.name, med, best, rowsPerSecond);
+        if (result.bytes > 0 && med > 0) {
+            printf(" %10.1f", result.bytes / med * 1e9 / (1024.0 * 1024.0));
+        }
+        printf("\n");
+    }
+}
+
+static int writeJson(const char* path, const BenchOptions* options, const std::vector<BenchResult>& results) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("Error creating output file: %s\n", path);
+        return 0;
+    }
+#ifdef LAB06_VERSION
+    const char* version = LAB06_VERSION;
+#else
+    const char* version = "dev";
+#endif
+    fprintf(file, "{\n  \"context\": {\"version\": \"%s\", \"repetitions\": %d, \"max_quadratic_n\": %d},\n",
+            version, options->repetitions, options->maxQuadraticN);
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"group\": \"%s\", \"variant\": \"%s\", "
+                      "\"n\": %d, \"m\": %d, \"distribution\": \"%s\", \"bytes\": %lld, "
+                      "\"comparisons\": %lld, \"swaps\": %lld, \"median_ns\": %.1f, \"samples_ns\": [",
+                result.name, result.group, result.variant, result.n, result.m,
+                DatasetGenerator_distributionName((GeneratorDistribution)result.distribution), result.bytes, result.comparisons, result.swaps,
+                median(result.samplesNs));
+        for (size_t s = 0; s < result.samplesNs.size(); s++) {
+            fprintf(file, "%s%.1f", s ? ", " : "", result.samplesNs[s]);
+        }
+        fprintf(file, "]}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return 1;
+}
+
+static int parseIntList(const char* text, std::vector<int>& values) {
+    values.clear();
+    const char* p = text;
+    while (*p) {
+        char* end;
+        double value = strtod(p, &end);  // Accepts 1e6 style sizes
+        if (end == p || value < 1 || value > 2147483647.0) return 0;
+        values.push_back((int)value);
+        p = (*end == ',') ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return !values.empty();
+}
+
+static int parseDistList(const char* text, std::vector<int>& values) {
+    values.clear();
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+        int found = DatasetGenerator_parseDistribution(token);
+        if (found < 0) return 0;
+        values.push_back(found);
+    }
+    return !values.empty();
+}
+
+static void printUsage(void) {
+    printf("Usage: Lab06_bench [options]\n");
+    printf("  --n LIST               Row counts, e.g. 10,1000,1e6 (default 10,1000,100000)\n");
+    printf("  --m LIST               Components per row (default 2,3,64)\n");
+    printf("  --dist LIST            uniform,clusters,sorted,reversed,duplicates,adversarial\n                         (default all)\n");
+    printf("  --reps N               Samples per benchmark (default 5)\n");
+    printf("  --max-quadratic-n N    Largest n for O(n^2) engines (default 10000)\n");
+    printf("  --filter TEXT          Only run benchmarks whose name contains TEXT\n");
+    printf("  --json FILE            Also write results as JSON\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    options.sizes = {10, 1000, 100000};
+    options.dims = {2, 3, 64};
+    for (int d = 0; d < GEN_DIST_COUNT; d++) {
+        options.dists.push_back(d);
+    }
+    options.repetitions = 5;
+    options.maxQuadraticN = 10000;
+    options.filter = NULL;
+    options.jsonPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        int ok = 1;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            printUsage();
+            return 0;
+        } else if (!value) {
+            ok = 0;
+        } else if (strcmp(arg, "--n") == 0) {
+            ok = parseIntList(value, options.sizes);
+        } else if (strcmp(arg, "--m") == 0) {
+            ok = parseIntList(value, options.dims);
+        } else if (strcmp(arg, "--dist") == 0) {
+            ok = parseDistList(value, options.dists);
+        } else if (strcmp(arg, "--reps") == 0) {
+            options.repetitions = atoi(value);
+            ok = options.repetitions > 0;
+        } else if (strcmp(arg, "--max-quadratic-n") == 0) {
+            options.maxQuadraticN = atoi(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(arg, "--json") == 0) {
+            options.jsonPath = value;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            printf("Invalid argument: %s\n", arg);
+            printUsage();
+            return 2;
+        }
+        i++;
+    }
+
+    std::vector<BenchResult> results;
+    for (int n : options.sizes) {
+        for (int m : options.dims) {
+            for (int dist : options.dists) {
+                Dataset data;
+                if (!makeDataset(&data, n, m, dist, 12345ULL + n * 31ULL + m)) {
+                    printf("Skipping n=%d m=%d: not enough memory\n", n, m);
+                    continue;
+                }
+                printf("Running n=%d m=%d %s...\n", n, m, DatasetGenerator_distributionName((GeneratorDistribution)dist));
+                fflush(stdout);
+                benchKeys(&options, &data, dist, results);
+                benchSorts(&options, &data, dist, results);
+                benchFiles(&options, &data, dist, results);
+                freeDataset(&data);
+            }
+        }
+    }
+
+    printTable(results);
+    if (options.jsonPath && !writeJson(options.jsonPath, &options, results)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file commandLine.cpp
+ * @brief Implementation of the non-interactive command-line front end
+ */
+
+#include "commandLine.h"
+#include "batchProcessor.h"
+#include "fileHandler.h"
+#include "sortDaemon.h"
+#include "sortEngine.h"
+#include "perfCounters.h"
+#include "resultCache.h"
+#include "sidecarCache.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LAB06_VERSION
+#define LAB06_VERSION "dev"
+#endif
+
+/** How statistics are reported after a command */
+typedef enum {
+    STATS_TEXT,   ///< Human-readable summary
+    STATS_JSON,   ///< One JSON object on a single line (same schema as lab06_stats.jsonl)
+    STATS_NONE    ///< Nothing
+} StatsFormat;
+
+/** Sort engines selectable with --engine */
+typedef enum {
+    CLI_ENGINE_BUBBLE,
+    CLI_ENGINE_OPTIMISED,
+    CLI_ENGINE_SELECTION,
+    CLI_ENGINE_RADIX
+} CliEngine;
+
+static const char* ENGINE_NAMES[] = {"bubble", "optimised", "selection", "radix"};
+static const int NUM_ENGINES = sizeof(ENGINE_NAMES) / sizeof(ENGINE_NAMES[0]);
+
+/**
+ * @struct SortOptions
+ * @brief Arguments of the sort command
+ */
+typedef struct {
+    const char* input;
+    const char* output;
+    const char* keySpec;
+    CliEngine engine;
+    StatsFormat statsFormat;
+} SortOptions;
+
+static void printUsage(FILE* out) {
+    fprintf(out, "Usage:\n");
+    fprintf(out, "  Lab06                          Interactive menu\n");
+    fprintf(out, "  Lab06 sort --in FILE [options] Sort one file\n");
+    fprintf(out, "  Lab06 batch --dir DIR [options] Sort every file in a directory\n");
+    fprintf(out, "  Lab06 serve [options]          Run the resident sort daemon\n");
+    fprintf(out, "  Lab06 --version\n");
+    fprintf(out, "\nsort options:\n");
+    fprintf(out, "  --in FILE          Input coordinates (CSV, or binary from Lab06_generate)\n");
+    fprintf(out, "  --out FILE         Write sorted coordinates as CSV (default: don't save)\n");
+    fprintf(out, "  --engine NAME      bubble, optimised, selection or radix (default radix)\n");
+    fprintf(out, "  --key LIST         Sort keys, e.g. sum or -sum,x (default sum)\n");
+    fprintf(out, "  --stats FORMAT     text (default), json or none\n");
+    fprintf(out, "\nbatch options:\n");
+    fprintf(out, "  --dir DIR          Directory to process (not recursive)\n");
+    fprintf(out, "  --out-dir DIR      Where sorted files go (default DIR/sorted)\n");
+    fprintf(out, "  --ext EXT          File extension to match (default csv)\n");
+    fprintf(out, "  --engine NAME      bubble, selection or radix (default radix)\n");
+    fprintf(out, "  --key LIST         Sort keys (default sum)\n");
+    fprintf(out, "  --jobs N           Worker threads (default: one per hardware thread)\n");
+    fprintf(out, "  --memory-mb N      Memory budget for files in flight (default: unlimited)\n");
+    fprintf(out, "  --stats FORMAT     text (default), json (one line per file) or none\n");
+    fprintf(out, "\nserve options:\n");
+    fprintf(out, "  --socket PATH      Unix socket to listen on (default %s)\n", DAEMON_DEFAULT_SOCKET);
+    fprintf(out, "  --memory-mb N      Dataset cache budget (default: unlimited)\n");
+}
+
+static void printTextStats(const SortStats* stats, const char* label, int n, int m) {
+    printf("%s: %d rows x %d columns\n", label, n, m);
+    printf("  comparisons %lld, swaps %lld, bytes moved %lld\n",
+           stats->comparisons, stats->swaps, stats->bytesMoved);
+    printf("  allocations %lld (%lld bytes), peak memory %lld bytes\n",
+           stats->allocations, stats->allocatedBytes, stats->peakMemoryBytes);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        printf("  %-5s %10.3f ms wall %10.3f ms cpu\n", SortStats_phaseName((SortPhase)p),
+               stats->phases[p].wallMs, stats->phases[p].cpuMs);
+    }
+}
+
+static int parseSortOptions(int argc, char** argv, SortOptions* options) {
+    options->input = NULL;
+    options->output = NULL;
+    options->keySpec = "sum";
+    options->engine = CLI_ENGINE_RADIX;
+    options->statsFormat = STATS_TEXT;
+
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 0;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--in") == 0) {
+            options->input = value;
+        } else if (strcmp(arg, "--out") == 0) {
+            options->output = value;
+        } else if (strcmp(arg, "--key") == 0) {
+            options->keySpec = value;
+        } else if (strcmp(arg, "--engine") == 0) {
+            int found = -1;
+            for (int e = 0; e < NUM_ENGINES; e++) {
+                if (strcmp(value, ENGINE_NAMES[e]) == 0) found = e;
+            }
+            if (found < 0) {
+                fprintf(stderr, "Unknown engine: %s\n", value);
+                return 0;
+            }
+            options->engine = (CliEngine)found;
+        } else if (strcmp(arg, "--stats") == 0) {
+            if (strcmp(value, "text") == 0) options->statsFormat = STATS_TEXT;
+            else if (strcmp(value, "json") == 0) options->statsFormat = STATS_JSON;
+            else if (strcmp(value, "none") == 0) options->statsFormat = STATS_NONE;
+            else {
+                fprintf(stderr, "Unknown stats format: %s\n", value);
+                return 0;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return 0;
+        }
+    }
+    if (!options->input) {
+        fprintf(stderr, "sort needs --in FILE\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Sorts one file. "optimised" is the optimised bubble sort and only sorts by
+ * row sum; the other engines accept any key list.
+ */
+static int runSort(int argc, char** argv) {
+    SortOptions options;
+    if (!parseSortOptions(argc, argv, &options)) {
+        printUsage(stderr);
+        return CLI_EXIT_USAGE;
+    }
+
+    SortKey keys[MAX_SORT_KEYS];
+    int nKeys = SortKeys_parse(options.keySpec, keys, MAX_SORT_KEYS);
+    if (nKeys == 0) {
+        fprintf(stderr, "Invalid sort keys: %s\n", options.keySpec);
+        return CLI_EXIT_USAGE;
+    }
+    int sumOnly = nKeys == 1 && keys[0].type == SORT_KEY_SUM && !keys[0].descending;
+    if (options.engine == CLI_ENGINE_OPTIMISED && !sumOnly) {
+        fprintf(stderr, "The optimised engine only sorts by ascending row sum\n");
+        return CLI_EXIT_USAGE;
+    }
+
+    // Results are memoized by file content, so the input is hashed as part of loading it
+    ResultCacheConfig resultConfig;
+    ResultCache_defaults(&resultConfig);
+    ResultCache* results = ResultCache_create(&resultConfig);
+    uint64_t contentHash = 0;
+
+    int n = 0, m = 0;
+    SortStats stats = {};
+    PhaseTimer timer;
+    PhaseTimer_start(&timer);
+    double** coordinates = FileHandler_loadCoordinatesHashed(options.input, &n, &m, &contentHash);
+    int hashed = results != NULL;
+    PhaseTimer_stop(&timer, &stats, PHASE_LOAD);
+    if (!coordinates) {
+        fprintf(stderr, "Failed to read coordinates from %s\n", options.input);
+        ResultCache_destroy(results);
+        return CLI_EXIT_FAILED;
+    }
+    FileHandler_getAllocationStats(n, m, &stats.allocations, &stats.allocatedBytes);
+    if (!SortKeys_isValid(keys, nKeys, m)) {
+        fprintf(stderr, "Sort keys %s do not fit %d columns\n", options.keySpec, m);
+        FileHandler_freeCoordinates(coordinates, n);
+        ResultCache_destroy(results);
+        return CLI_EXIT_USAGE;
+    }
+
+    // The same content sorted the same way before only needs its permutation applied
+    ResultKey resultKey;
+    ResultCache_makeKey(&resultKey, contentHash, keys, nKeys, ENGINE_NAMES[options.engine], n, m);
+    int cached = 0;
+    if (hashed) {
+        PhaseTimer_start(&timer);
+        cached = ResultCache_apply(results, &resultKey, coordinates);
+        PhaseTimer_stop(&timer, &stats, PHASE_SORT);
+    }
+
+    if (!cached) {
+        double** original = hashed ? (double**)malloc(n * sizeof(double*)) : NULL;
+        if (original) {
+            memcpy(original, coordinates, n * sizeof(double*));
+        }
+
+        SortStats sortStats;
+        switch (options.engine) {
+            case CLI_ENGINE_OPTIMISED:
+                sortStats = optimisedSortCoordinates(coordinates, n, m);
+                break;
+            case CLI_ENGINE_BUBBLE:
+                sortStats = sortCoordinatesByKeys(coordinates, n, m, keys, nKeys, SORT_ENGINE_BUBBLE);
+                break;
+            case CLI_ENGINE_SELECTION:
+                sortStats = sortCoordinatesByKeys(coordinates, n, m, keys, nKeys, SORT_ENGINE_SELECTION);
+                break;
+            case CLI_ENGINE_RADIX:
+            default:
+                sortStats = sortCoordinatesByKeys(coordinates, n, m, keys, nKeys, SORT_ENGINE_RADIX);
+                break;
+        }
+        SortStats_add(&stats, &sortStats);
+
+        if (original) {
+            ResultCache_record(results, &resultKey, original, coordinates);
+            free(original);
+        }
+    }
+    ResultCache_destroy(results);
+
+    int status = CLI_EXIT_OK;
+    if (options.output) {
+        PhaseTimer_start(&timer);
+        int saved = FileHandler_saveCoordinates(options.output, coordinates, n, m);
+        PhaseTimer_stop(&timer, &stats, PHASE_SAVE);
+        if (!saved) {
+            fprintf(stderr, "Failed to write %s\n", options.output);
+            status = CLI_EXIT_FAILED;
+        }
+    }
+    SortStats_capturePeakMemory(&stats);
+
+    char label[160];
+    snprintf(label, sizeof(label), "%s by %s%s", ENGINE_NAMES[options.engine], options.keySpec,
+             cached ? " (cached result)" : "");
+    if (options.statsFormat == STATS_JSON) {
+        SortStats_writeJson(stdout, &stats, label, options.input, n, m);
+    } else if (options.statsFormat == STATS_TEXT) {
+        printTextStats(&stats, label, n, m);
+    }
+
+    FileHandler_freeCoordinates(coordinates, n);
+    return status;
+}
+
+/**
+ * Sorts every matching file in a directory. The keyed engines cover every
+ * key list, so the sum-only "optimised" engine is not offered here.
+ */
+static int runBatch(int argc, char** argv) {
+    const char* dir = NULL;
+    const char* outDir = NULL;
+    const char* keySpec = "sum";
+    StatsFormat statsFormat = STATS_TEXT;
+    BatchConfig config;
+    BatchProcessor_defaults(&config, NULL, NULL);
+
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            printUsage(stderr);
+            return CLI_EXIT_USAGE;
+        }
+        const char* value = argv[++i];
+        int ok = 1;
+        if (strcmp(arg, "--dir") == 0) {
+            dir = value;
+        } else if (strcmp(arg, "--out-dir") == 0) {
+            outDir = value;
+        } else if (strcmp(arg, "--ext") == 0) {
+            config.extension = value[0] == '.' ? value + 1 : value;
+        } else if (strcmp(arg, "--key") == 0) {
+            keySpec = value;
+        } else if (strcmp(arg, "--engine") == 0) {
+            if (strcmp(value, "bubble") == 0) config.engine = SORT_ENGINE_BUBBLE;
+            else if (strcmp(value, "selection") == 0) config.engine = SORT_ENGINE_SELECTION;
+            else if (strcmp(value, "radix") == 0) config.engine = SORT_ENGINE_RADIX;
+            else ok = 0;
+        } else if (strcmp(arg, "--jobs") == 0) {
+            config.jobs = atoi(value);
+            ok = config.jobs >= 0;
+        } else if (strcmp(arg, "--memory-mb") == 0) {
+            config.memoryBudgetBytes = (long long)(atof(value) * 1024 * 1024);
+            ok = config.memoryBudgetBytes >= 0;
+        } else if (strcmp(arg, "--stats") == 0) {
+            if (strcmp(value, "text") == 0) statsFormat = STATS_TEXT;
+            else if (strcmp(value, "json") == 0) statsFormat = STATS_JSON;
+            else if (strcmp(value, "none") == 0) statsFormat = STATS_NONE;
+            else ok = 0;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "Invalid option: %s %s\n", arg, value);
+            printUsage(stderr);
+            return CLI_EXIT_USAGE;
+        }
+    }
+    if (!dir) {
+        fprintf(stderr, "batch needs --dir DIR\n");
+        printUsage(stderr);
+        return CLI_EXIT_USAGE;
+    }
+    config.nKeys = SortKeys_parse(keySpec, config.keys, MAX_SORT_KEYS);
+    if (config.nKeys == 0) {
+        fprintf(stderr, "Invalid sort keys: %s\n", keySpec);
+        return CLI_EXIT_USAGE;
+    }
+
+    char defaultOutDir[1024];
+    if (!outDir) {
+        snprintf(defaultOutDir, sizeof(defaultOutDir), "%s/sorted", dir);
+        outDir = defaultOutDir;
+    }
+    config.inputDir = dir;
+    config.outputDir = outDir;
+
+    ResultCacheConfig resultConfig;
+    ResultCache_defaults(&resultConfig);
+    config.results = ResultCache_create(&resultConfig);
+
+    BatchReport report;
+    int ran = BatchProcessor_run(&config, &report);
+    ResultCache_destroy(config.results);
+    if (!ran) {
+        return CLI_EXIT_FAILED;
+    }
+    char label[160];
+    snprintf(label, sizeof(label), "batch %s by %s",
+             config.engine == SORT_ENGINE_BUBBLE ? "bubble" :
+             config.engine == SORT_ENGINE_SELECTION ? "selection" : "radix", keySpec);
+    if (statsFormat == STATS_JSON) {
+        BatchProcessor_writeJson(stdout, &report, label);
+    } else if (statsFormat == STATS_TEXT) {
+        BatchProcessor_printReport(stdout, &report);
+    }
+    int status = report.failed ? CLI_EXIT_FAILED : CLI_EXIT_OK;
+    BatchProcessor_freeReport(&report);
+    return status;
+}
+
+/** Runs the resident sort daemon until it is interrupted */
+static int runServe(int argc, char** argv) {
+    const char* socketPath = DAEMON_DEFAULT_SOCKET;
+    long long budget = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return CLI_EXIT_USAGE;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--socket") == 0) {
+            socketPath = value;
+        } else if (strcmp(arg, "--memory-mb") == 0) {
+            budget = (long long)(atof(value) * 1024 * 1024);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            printUsage(stderr);
+            return CLI_EXIT_USAGE;
+        }
+    }
+    return SortDaemon_run(socketPath, budget) ? CLI_EXIT_OK : CLI_EXIT_FAILED;
+}
+
+int CommandLine_run(int argc, char** argv) {
+    PerfCounters_init();
+    Trace_init();
+
+    const char* command = argv[1];
+    int status;
+    if (strcmp(command, "sort") == 0) {
+        status = runSort(argc, argv);
+    } else if (strcmp(command, "batch") == 0) {
+        status = runBatch(argc, argv);
+    } else if (strcmp(command, "serve") == 0) {
+        status = runServe(argc, argv);
+    } else if (strcmp(command, "--version") == 0) {
+        printf("Lab06 %s\n", LAB06_VERSION);
+        status = CLI_EXIT_OK;
+    } else if (strcmp(command, "--help") == 0 || strcmp(command, "-h") == 0) {
+        printUsage(stdout);
+        status = CLI_EXIT_OK;
+    } else {
+        fprintf(stderr, "Unknown command: %s\n", command);
+        printUsage(stderr);
+        status = CLI_EXIT_USAGE;
+    }
+
+    Sidecar_waitForWrites();
+    PerfCounters_shutdown();
+    return status;
+}
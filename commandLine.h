@@ -0,0 +1,33 @@
+/**
+ * @file commandLine.h
+ * @brief Non-interactive command-line front end
+ *
+ * When the program is started with arguments it runs one command and exits
+ * instead of opening the menu, so it can be used from scripts and batch jobs:
+ *
+ *   Lab06 sort --engine radix --key sum --in a.csv --out b.csv --stats json
+ *
+ * This module only uses the loader, the sort engines and the writer; it has
+ * no console or SelectionMenu dependencies. Results go to stdout, errors to
+ * stderr.
+ */
+
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+/** Exit status: success */
+#define CLI_EXIT_OK 0
+/** Exit status: the command failed (unreadable input, unwritable output) */
+#define CLI_EXIT_FAILED 1
+/** Exit status: invalid command line */
+#define CLI_EXIT_USAGE 2
+
+/**
+ * @brief Runs the command named by argv[1]
+ * @param argc Argument count from main (at least 2)
+ * @param argv Argument vector from main
+ * @return Process exit status (CLI_EXIT_*)
+ */
+int CommandLine_run(int argc, char** argv);
+
+#endif // COMMAND_LINE_H
@@ -0,0 +1,169 @@
+/**
+ * @file contentHash.cpp
+ * @brief Implementation of XXH64
+ */
+
+#include "contentHash.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Bytes read per call when hashing a file */
+#define CONTENT_HASH_CHUNK (1 << 20)
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+static const uint64_t PRIME4 = 9650029242287828579ULL;
+static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Input is read in the machine's byte order; every supported platform is little-endian
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t value) {
+    acc ^= round64(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+/** Consumes one 32-byte stripe */
+static inline void consumeStripe(uint64_t* acc, const unsigned char* p) {
+    acc[0] = round64(acc[0], read64(p));
+    acc[1] = round64(acc[1], read64(p + 8));
+    acc[2] = round64(acc[2], read64(p + 16));
+    acc[3] = round64(acc[3], read64(p + 24));
+}
+
+void ContentHash_init(ContentHash* hash, uint64_t seed) {
+    hash->seed = seed;
+    hash->acc[0] = seed + PRIME1 + PRIME2;
+    hash->acc[1] = seed + PRIME2;
+    hash->acc[2] = seed;
+    hash->acc[3] = seed - PRIME1;
+    hash->totalBytes = 0;
+    hash->buffered = 0;
+}
+
+void ContentHash_update(ContentHash* hash, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + length;
+    hash->totalBytes += length;
+
+    // Top up a partial stripe left from the previous call
+    if (hash->buffered) {
+        size_t take = 32 - hash->buffered;
+        if (take > length) take = length;
+        memcpy(hash->buffer + hash->buffered, p, take);
+        hash->buffered += (uint32_t)take;
+        p += take;
+        if (hash->buffered < 32) {
+            return;
+        }
+        consumeStripe(hash->acc, hash->buffer);
+        hash->buffered = 0;
+    }
+
+    while (end - p >= 32) {
+        consumeStripe(hash->acc, p);
+        p += 32;
+    }
+
+    if (p < end) {
+        memcpy(hash->buffer, p, end - p);
+        hash->buffered = (uint32_t)(end - p);
+    }
+}
+
+uint64_t ContentHash_final(const ContentHash* hash) {
+    uint64_t h;
+    if (hash->totalBytes >= 32) {
+        const uint64_t* acc = hash->acc;
+        h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+        h = mergeRound(h, acc[0]);
+        h = mergeRound(h, acc[1]);
+        h = mergeRound(h, acc[2]);
+        h = mergeRound(h, acc[3]);
+    } else {
+        h = hash->seed + PRIME5;
+    }
+    h += hash->totalBytes;
+
+    const unsigned char* p = hash->buffer;
+    const unsigned char* end = p + hash->buffered;
+    while (end - p >= 8) {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t ContentHash_bytes(const void* data, size_t length, uint64_t seed) {
+    ContentHash hash;
+    ContentHash_init(&hash, seed);
+    ContentHash_update(&hash, data, length);
+    return ContentHash_final(&hash);
+}
+
+int ContentHash_file(const char* path, uint64_t* hash) {
+    TRACE_SCOPE("ContentHash_file");
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    unsigned char* chunk = (unsigned char*)malloc(CONTENT_HASH_CHUNK);
+    if (!chunk) {
+        fclose(file);
+        return 0;
+    }
+
+    ContentHash state;
+    ContentHash_init(&state, 0);
+    size_t got;
+    while ((got = fread(chunk, 1, CONTENT_HASH_CHUNK, file)) > 0) {
+        ContentHash_update(&state, chunk, got);
+    }
+    int ok = !ferror(file);
+    free(chunk);
+    fclose(file);
+    if (ok) {
+        *hash = ContentHash_final(&state);
+    }
+    return ok;
+}
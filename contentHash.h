@@ -0,0 +1,66 @@
+/**
+ * @file contentHash.h
+ * @brief Fast non-cryptographic 64-bit hash of file contents (XXH64)
+ *
+ * Used to tell whether a file still has the contents something was derived
+ * from. It is not a defence against deliberate collisions.
+ */
+
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct ContentHash
+ * @brief Streaming hash state
+ */
+typedef struct {
+    uint64_t acc[4];          ///< Lane accumulators
+    uint64_t seed;
+    uint64_t totalBytes;
+    unsigned char buffer[32]; ///< Input not yet consumed as a full stripe
+    uint32_t buffered;
+} ContentHash;
+
+/**
+ * @brief Starts a new hash
+ * @param hash State to initialise
+ * @param seed Seed; the same data and seed always give the same hash
+ */
+void ContentHash_init(ContentHash* hash, uint64_t seed);
+
+/**
+ * @brief Adds bytes to a hash
+ * @param hash State from ContentHash_init
+ * @param data Bytes to add
+ * @param length Number of bytes
+ */
+void ContentHash_update(ContentHash* hash, const void* data, size_t length);
+
+/**
+ * @brief Gets the hash of everything added so far
+ * @param hash State from ContentHash_init (not modified)
+ * @return 64-bit hash
+ */
+uint64_t ContentHash_final(const ContentHash* hash);
+
+/**
+ * @brief Hashes a block of memory in one call
+ * @param data Bytes to hash
+ * @param length Number of bytes
+ * @param seed Seed
+ * @return 64-bit hash
+ */
+uint64_t ContentHash_bytes(const void* data, size_t length, uint64_t seed);
+
+/**
+ * @brief Hashes the contents of a file with seed 0
+ * @param path File to hash
+ * @param hash Output parameter for the hash
+ * @return 1 on success, 0 if the file cannot be read
+ */
+int ContentHash_file(const char* path, uint64_t* hash);
+
+#endif // CONTENT_HASH_H
@@ -0,0 +1,169 @@
+/**
+ * @file daemonClient.cpp
+ * @brief Command-line client for testing the resident sort daemon
+ *
+ * Usage:
+ *   Lab06_client [--socket PATH] sort  --in FILE [--key LIST] [--engine NAME] [--out FILE]
+ *   Lab06_client [--socket PATH] topk  --in FILE --k N [--key LIST] [--engine NAME] [--out FILE]
+ *   Lab06_client [--socket PATH] range --in FILE --rect X0,Y0,X1,Y1 [--key LIST] [--out FILE]
+ *   Lab06_client [--socket PATH] stats
+ *
+ * Rows received from the daemon are printed as CSV unless --quiet is given.
+ * --repeat N sends the same request N times over one connection and reports
+ * the latency of each, which shows the difference between a cold and a
+ * cached dataset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include "sortDaemon.h"
+#include "sortEngine.h"
+
+static void printUsage(void) {
+    printf("Usage: Lab06_client [--socket PATH] COMMAND [options]\n");
+    printf("Commands: sort, topk, range, stats\n");
+    printf("  --in FILE          Input file (resolved to an absolute path)\n");
+    printf("  --key LIST         Sort keys (default sum)\n");
+    printf("  --engine NAME      bubble, selection or radix (default radix)\n");
+    printf("  --k N              Number of rows for topk\n");
+    printf("  --rect X0,Y0,X1,Y1 Rectangle for range\n");
+    printf("  --out FILE         Have the daemon write the rows to FILE instead\n");
+    printf("  --repeat N         Send the request N times and report each latency\n");
+    printf("  --quiet            Don't print the rows\n");
+}
+
+int main(int argc, char** argv) {
+    const char* socketPath = DAEMON_DEFAULT_SOCKET;
+    const char* command = NULL;
+    const char* input = NULL;
+    const char* keys = NULL;
+    const char* output = NULL;
+    int repeat = 1;
+    int quiet = 0;
+    DaemonRequestHeader header;
+    SortDaemon_initRequest(&header, DAEMON_OP_SORT);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (strcmp(arg, "--quiet") == 0) {
+            quiet = 1;
+            continue;
+        }
+        if (strncmp(arg, "--", 2) != 0) {
+            command = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 2;
+        }
+        const char* value = argv[++i];
+        int ok = 1;
+        if (strcmp(arg, "--socket") == 0) {
+            socketPath = value;
+        } else if (strcmp(arg, "--in") == 0) {
+            input = value;
+        } else if (strcmp(arg, "--key") == 0) {
+            keys = value;
+        } else if (strcmp(arg, "--out") == 0) {
+            output = value;
+        } else if (strcmp(arg, "--k") == 0) {
+            header.limit = (uint32_t)atoi(value);
+        } else if (strcmp(arg, "--repeat") == 0) {
+            repeat = atoi(value);
+            ok = repeat > 0;
+        } else if (strcmp(arg, "--engine") == 0) {
+            if (strcmp(value, "bubble") == 0) header.engine = SORT_ENGINE_BUBBLE;
+            else if (strcmp(value, "selection") == 0) header.engine = SORT_ENGINE_SELECTION;
+            else if (strcmp(value, "radix") == 0) header.engine = SORT_ENGINE_RADIX;
+            else ok = 0;
+        } else if (strcmp(arg, "--rect") == 0) {
+            ok = sscanf(value, "%lf,%lf,%lf,%lf", &header.rect[0], &header.rect[1],
+                        &header.rect[2], &header.rect[3]) == 4;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "Invalid argument: %s %s\n", arg, value);
+            return 2;
+        }
+    }
+
+    if (!command) {
+        printUsage();
+        return 2;
+    } else if (strcmp(command, "sort") == 0) {
+        header.op = DAEMON_OP_SORT;
+    } else if (strcmp(command, "topk") == 0) {
+        header.op = DAEMON_OP_TOPK;
+    } else if (strcmp(command, "range") == 0) {
+        header.op = DAEMON_OP_RANGE;
+    } else if (strcmp(command, "stats") == 0) {
+        header.op = DAEMON_OP_STATS;
+    } else {
+        fprintf(stderr, "Unknown command: %s\n", command);
+        return 2;
+    }
+    if (header.op != DAEMON_OP_STATS && !input) {
+        fprintf(stderr, "%s needs --in FILE\n", command);
+        return 2;
+    }
+
+    // The daemon has its own working directory, so send absolute paths
+    std::string inputPath, outputPath;
+    std::error_code error;
+    if (input) inputPath = std::filesystem::absolute(input, error).string();
+    if (output) outputPath = std::filesystem::absolute(output, error).string();
+
+    int connection = SortDaemon_connect(socketPath);
+    if (connection < 0) {
+        fprintf(stderr, "Cannot connect to %s; start the daemon with: Lab06 serve --socket %s\n", socketPath, socketPath);
+        return 1;
+    }
+
+    int status = 0;
+    for (int r = 0; r < repeat && status == 0; r++) {
+        DaemonResponseHeader response;
+        char* message = NULL;
+        double* data = NULL;
+        auto start = std::chrono::steady_clock::now();
+        if (!SortDaemon_request(connection, &header, input ? inputPath.c_str() : NULL, keys,
+                                output ? outputPath.c_str() : NULL, &response, &message, &data)) {
+            fprintf(stderr, "Connection to the daemon failed\n");
+            SortDaemon_close(connection);
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (response.status != DAEMON_OK) {
+            fprintf(stderr, "Error %d: %s\n", response.status, message);
+            status = 1;
+        } else if (header.op == DAEMON_OP_STATS) {
+            printf("%s\n", message);
+        } else {
+            if (data && !quiet && r == repeat - 1) {
+                for (uint32_t i = 0; i < response.rows; i++) {
+                    for (uint32_t j = 0; j < response.cols; j++) {
+                        printf("%.2f%s", data[(size_t)i * response.cols + j], j + 1 < response.cols ? "," : "\n");
+                    }
+                }
+            }
+            fprintf(stderr, "%u rows x %u cols, server %.3f ms, round trip %.3f ms, %s\n",
+                    response.rows, response.cols, response.serverMs, ms,
+                    response.cacheHit ? "cached" : "loaded");
+        }
+        free(message);
+        free(data);
+    }
+
+    SortDaemon_close(connection);
+    return status;
+}
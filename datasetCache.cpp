@@ -0,0 +1,320 @@
+/**
+ * @file datasetCache.cpp
+ * @brief Implementation of the dataset cache
+ */
+
+#include "datasetCache.h"
+#include "fileHandler.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/** Load states of a cache entry */
+typedef enum {
+    ENTRY_LOADING,
+    ENTRY_READY,
+    ENTRY_FAILED
+} EntryState;
+
+/**
+ * @struct CacheEntry
+ * @brief One cached file; its dataset points back to it
+ */
+typedef struct DatasetCacheEntry {
+    CachedDataset dataset;
+    std::string path;
+    EntryState state;
+    int refCount;
+    int detached;                        ///< No longer in the map (stale or evicted); freed at refCount 0
+    std::list<struct DatasetCacheEntry*>::iterator lru;
+    std::mutex gridMutex;
+    SpatialGrid grid;
+    int hasGrid;
+} CacheEntry;
+
+struct DatasetCache {
+    std::mutex mutex;
+    std::condition_variable loaded;
+    std::unordered_map<std::string, CacheEntry*> entries;
+    std::list<CacheEntry*> lru;          ///< Most recently used first
+    long long budgetBytes;
+    long long bytes;
+    long long hits;
+    long long misses;
+    long long evictions;
+};
+
+/** Reads a file's size and modification time in file clock ticks (which may be negative) */
+static int fileVersion(const char* path, long long* fileBytes, long long* mtime) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return 0;
+    }
+    *mtime = (long long)time.time_since_epoch().count();
+    uintmax_t size = std::filesystem::file_size(path, error);
+    *fileBytes = (long long)size;
+    return !error;
+}
+
+static void freeEntry(DatasetCache* cache, CacheEntry* entry) {
+    cache->bytes -= entry->dataset.memoryBytes;
+    FileHandler_freeCoordinates(entry->dataset.rows, entry->dataset.n);
+    if (entry->hasGrid) {
+        SpatialGrid_free(&entry->grid);
+    }
+    delete entry;
+}
+
+/** Removes an entry from the map and LRU list; frees it now if nobody holds it. Caller holds the lock. */
+static void detachEntry(DatasetCache* cache, CacheEntry* entry) {
+    cache->entries.erase(entry->path);
+    if (entry->state == ENTRY_READY) {
+        cache->lru.erase(entry->lru);
+    }
+    entry->detached = 1;
+    if (entry->refCount == 0) {
+        freeEntry(cache, entry);
+    }
+}
+
+/** Evicts unused entries, least recently used first, until under budget. Caller holds the lock. */
+static void evictOverBudget(DatasetCache* cache) {
+    if (cache->budgetBytes <= 0) {
+        return;
+    }
+    auto it = cache->lru.end();
+    while (cache->bytes > cache->budgetBytes && it != cache->lru.begin()) {
+        --it;
+        CacheEntry* entry = *it;
+        if (entry->refCount == 0) {
+            it = cache->lru.erase(it);
+            cache->entries.erase(entry->path);
+            freeEntry(cache, entry);
+            cache->evictions++;
+        }
+    }
+}
+
+DatasetCache* DatasetCache_create(long long memoryBudgetBytes) {
+    DatasetCache* cache = new DatasetCache();
+    cache->budgetBytes = memoryBudgetBytes;
+    cache->bytes = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    return cache;
+}
+
+/** DatasetCache_acquire, loading a missing file under the given handle (NULL for none) */
+static const CachedDataset* acquire(DatasetCache* cache, const char* path, int* hit, FileLoad* load) {
+    TRACE_SCOPE("DatasetCache_acquire");
+    if (hit) *hit = 0;
+    long long fileBytes, mtime;
+    if (!fileVersion(path, &fileBytes, &mtime)) {
+        return NULL;
+    }
+
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    for (;;) {
+        auto found = cache->entries.find(path);
+        if (found == cache->entries.end()) {
+            break;
+        }
+        CacheEntry* entry = found->second;
+        if (entry->state == ENTRY_LOADING) {
+            cache->loaded.wait(lock);   // Someone else is loading it; look again afterwards
+            continue;
+        }
+        if (entry->dataset.mtime != mtime || entry->dataset.fileBytes != fileBytes) {
+            detachEntry(cache, entry);  // Changed on disk: drop the old version
+            break;
+        }
+        entry->refCount++;
+        cache->lru.splice(cache->lru.begin(), cache->lru, entry->lru);
+        cache->hits++;
+        if (hit) *hit = 1;
+        return &entry->dataset;
+    }
+
+    // Miss: publish a loading placeholder so concurrent requests wait for this load
+    CacheEntry* entry = new CacheEntry();
+    entry->path = path;
+    entry->state = ENTRY_LOADING;
+    entry->refCount = 1;
+    entry->detached = 0;
+    entry->dataset.memoryBytes = 0;
+    entry->hasGrid = 0;
+    entry->dataset.path = entry->path.c_str();
+    entry->dataset.entry = entry;
+    entry->dataset.mtime = mtime;
+    entry->dataset.fileBytes = fileBytes;
+    cache->entries[entry->path] = entry;
+    cache->misses++;
+    lock.unlock();
+
+    int n = 0, m = 0;
+    double** rows = FileHandler_loadCoordinatesTracked(path, &n, &m, load);
+
+    lock.lock();
+    if (!rows) {
+        entry->state = ENTRY_FAILED;
+        cache->entries.erase(entry->path);
+        delete entry;
+        cache->loaded.notify_all();
+        return NULL;
+    }
+    long long allocations;
+    entry->dataset.rows = rows;
+    entry->dataset.n = n;
+    entry->dataset.m = m;
+    FileHandler_getAllocationStats(n, m, &allocations, &entry->dataset.memoryBytes);
+    entry->state = ENTRY_READY;
+    cache->lru.push_front(entry);
+    entry->lru = cache->lru.begin();
+    cache->bytes += entry->dataset.memoryBytes;
+    evictOverBudget(cache);
+    cache->loaded.notify_all();
+    return &entry->dataset;
+}
+
+const CachedDataset* DatasetCache_acquire(DatasetCache* cache, const char* path, int* hit) {
+    return acquire(cache, path, hit, NULL);
+}
+
+const SpatialGrid* DatasetCache_getGrid(DatasetCache* cache, const CachedDataset* dataset) {
+    CacheEntry* entry = dataset->entry;
+    std::lock_guard<std::mutex> gridLock(entry->gridMutex);
+    if (!entry->hasGrid) {
+        if (!SpatialGrid_build(&entry->grid, dataset->rows, dataset->n, dataset->m)) {
+            return NULL;
+        }
+        entry->hasGrid = 1;
+        long long gridBytes = (long long)(entry->grid.cellsX * entry->grid.cellsY + 1) * sizeof(int) +
+                              (long long)dataset->n * sizeof(double*);
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        entry->dataset.memoryBytes += gridBytes;
+        cache->bytes += gridBytes;
+    }
+    return &entry->grid;
+}
+
+void DatasetCache_release(DatasetCache* cache, const CachedDataset* dataset) {
+    if (!dataset) {
+        return;
+    }
+    CacheEntry* entry = dataset->entry;
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    entry->refCount--;
+    if (entry->refCount == 0 && entry->detached) {
+        freeEntry(cache, entry);
+    } else {
+        evictOverBudget(cache);
+    }
+}
+
+/** Points a view at a dataset, or empties it when there is none */
+static int fillView(DatasetView* view, const CachedDataset* dataset) {
+    view->dataset = dataset;
+    view->ownsRows = 0;
+    if (!dataset) {
+        view->rows = NULL;
+        view->n = 0;
+        view->m = 0;
+        return 0;
+    }
+    view->rows = dataset->rows;
+    view->n = dataset->n;
+    view->m = dataset->m;
+    return 1;
+}
+
+int DatasetCache_openView(DatasetCache* cache, const char* path, DatasetView* view, int* hit) {
+    return fillView(view, DatasetCache_acquire(cache, path, hit));
+}
+
+/** Arguments and outputs of DatasetCache_startOpenView */
+typedef struct {
+    DatasetCache* cache;
+    std::string path;
+    const CachedDataset* dataset;
+    int hit;
+} ViewRequest;
+
+static void* openViewTask(FileLoad* load, void* context) {
+    ViewRequest* request = (ViewRequest*)context;
+    request->dataset = acquire(request->cache, request->path.c_str(), &request->hit, load);
+    return request;
+}
+
+FileLoad* DatasetCache_startOpenView(DatasetCache* cache, const char* path) {
+    ViewRequest* request = new ViewRequest();
+    request->cache = cache;
+    request->path = path;
+    request->dataset = NULL;
+    request->hit = 0;
+    return FileHandler_startTask(openViewTask, request);
+}
+
+int DatasetCache_finishOpenView(FileLoad* load, DatasetView* view, int* hit) {
+    ViewRequest* request = (ViewRequest*)FileHandler_finishTask(load);
+    if (hit) *hit = request->hit;
+    int opened = fillView(view, request->dataset);
+    delete request;
+    return opened;
+}
+
+double** DatasetView_mutableRows(DatasetView* view) {
+    if (!view->ownsRows) {
+        double** rows = (double**)malloc((size_t)view->n * sizeof(double*));
+        if (!rows) {
+            return NULL;
+        }
+        memcpy(rows, view->rows, (size_t)view->n * sizeof(double*));
+        view->rows = rows;
+        view->ownsRows = 1;
+    }
+    return view->rows;
+}
+
+void DatasetCache_closeView(DatasetCache* cache, DatasetView* view) {
+    if (view->ownsRows) {
+        free(view->rows);
+    }
+    DatasetCache_release(cache, view->dataset);
+    view->dataset = NULL;
+    view->rows = NULL;
+    view->ownsRows = 0;
+}
+
+void DatasetCache_setBudget(DatasetCache* cache, long long memoryBudgetBytes) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->budgetBytes = memoryBudgetBytes;
+    evictOverBudget(cache);
+}
+
+void DatasetCache_getStats(DatasetCache* cache, DatasetCacheStats* stats) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->bytes = cache->bytes;
+    stats->budgetBytes = cache->budgetBytes;
+    stats->entries = (int)cache->entries.size();
+}
+
+void DatasetCache_destroy(DatasetCache* cache) {
+    if (!cache) {
+        return;
+    }
+    for (auto& item : cache->entries) {
+        freeEntry(cache, item.second);
+    }
+    delete cache;
+}
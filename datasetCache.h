@@ -0,0 +1,171 @@
+/**
+ * @file datasetCache.h
+ * @brief Thread-safe LRU cache of parsed coordinate files
+ *
+ * Datasets are keyed by path, size and modification time: a file that
+ * changed on disk is reloaded on its next use, while callers still holding
+ * the old version keep it until they release it. Cached rows are shared
+ * between callers and must be treated as read-only; sort a copy of the row
+ * pointer array instead of the rows themselves. A DatasetView does exactly
+ * that, copying the pointer array the first time the order is changed.
+ *
+ * When the total size of the cached datasets exceeds the memory budget, the
+ * least recently used datasets nobody is holding are evicted.
+ */
+
+#ifndef DATASET_CACHE_H
+#define DATASET_CACHE_H
+
+#include "fileHandler.h"
+#include "spatialGrid.h"
+
+/** The cache's bookkeeping for one dataset (opaque) */
+struct DatasetCacheEntry;
+
+/**
+ * @struct CachedDataset
+ * @brief A loaded file, shared read-only between everyone who acquired it
+ */
+typedef struct {
+    double** rows;         ///< Row pointers; do not modify or reorder
+    int n;
+    int m;
+    const char* path;
+    long long mtime;       ///< Modification time the rows were loaded from
+    long long fileBytes;   ///< File size the rows were loaded from
+    long long memoryBytes; ///< Heap used by the rows (and grid, once built)
+    struct DatasetCacheEntry* entry; ///< Entry holding this dataset; for the cache's own use
+} CachedDataset;
+
+/**
+ * @struct DatasetCacheStats
+ * @brief Cache counters
+ */
+typedef struct {
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long bytes;        ///< Memory held by cached datasets
+    long long budgetBytes;
+    int entries;
+} DatasetCacheStats;
+
+/**
+ * @struct DatasetView
+ * @brief Copy-on-write ordering of a cached dataset
+ *
+ * The view starts out sharing the cached row pointer array. Sorters permute
+ * row pointers only, so the first call to DatasetView_mutableRows copies that
+ * array and the cached order stays as it was in the file.
+ */
+typedef struct {
+    const CachedDataset* dataset; ///< Held until DatasetCache_closeView
+    double** rows;                ///< Current order; the cached array until first modified
+    int n;
+    int m;
+    int ownsRows;                 ///< 1 once rows is a private copy
+} DatasetView;
+
+/** Opaque cache handle */
+typedef struct DatasetCache DatasetCache;
+
+/**
+ * @brief Creates an empty cache
+ * @param memoryBudgetBytes Target upper bound on cached memory, 0 = unlimited
+ * @return New cache, or NULL on allocation failure
+ */
+DatasetCache* DatasetCache_create(long long memoryBudgetBytes);
+
+/**
+ * @brief Gets a dataset, loading it (CSV or binary) if it is not cached or changed on disk
+ * @param cache Cache to use
+ * @param path File to load
+ * @param hit Optional output parameter, set to 1 if the dataset came from the cache
+ * @return Dataset pinned in the cache until DatasetCache_release, or NULL if the file cannot be read
+ * @note Concurrent requests for the same file share a single load
+ */
+const CachedDataset* DatasetCache_acquire(DatasetCache* cache, const char* path, int* hit);
+
+/**
+ * @brief Opens a copy-on-write view of a dataset, loading it if needed
+ * @param cache Cache to use
+ * @param path File to load
+ * @param view Output parameter for the view
+ * @param hit Optional output parameter, set to 1 if the dataset came from the cache
+ * @return 1 on success, 0 if the file cannot be read
+ */
+int DatasetCache_openView(DatasetCache* cache, const char* path, DatasetView* view, int* hit);
+
+/**
+ * @brief Starts DatasetCache_openView on a background thread
+ *
+ * Follow, wait for or cancel the load with FileHandler_getLoadStatus,
+ * FileHandler_waitLoad and FileHandler_cancelLoad. A cached file finishes
+ * almost at once. A cancelled load leaves nothing in the cache.
+ *
+ * @param cache Cache to use
+ * @param path File to load
+ * @return Load handle; pass it to DatasetCache_finishOpenView exactly once
+ */
+FileLoad* DatasetCache_startOpenView(DatasetCache* cache, const char* path);
+
+/**
+ * @brief Collects the view of DatasetCache_startOpenView, waiting for it if needed
+ * @param load Handle from DatasetCache_startOpenView, freed by this call
+ * @param view Output parameter for the view
+ * @param hit Optional output parameter, set to 1 if the dataset came from the cache
+ * @return 1 on success, 0 if the file cannot be read or the load was cancelled
+ */
+int DatasetCache_finishOpenView(FileLoad* load, DatasetView* view, int* hit);
+
+/**
+ * @brief Gets row pointers of a view that may be reordered
+ * @param view View from DatasetCache_openView
+ * @return The view's own pointer array (copied on first call), or NULL on allocation failure
+ * @note The rows themselves are still shared and must not be written to
+ */
+double** DatasetView_mutableRows(DatasetView* view);
+
+/**
+ * @brief Closes a view and releases its dataset
+ * @param cache Cache that owns the dataset
+ * @param view View to close
+ */
+void DatasetCache_closeView(DatasetCache* cache, DatasetView* view);
+
+/**
+ * @brief Gets the spatial grid of a dataset, building it on first use
+ * @param cache Cache that owns the dataset
+ * @param dataset Dataset from DatasetCache_acquire (must still be held)
+ * @return Grid over the dataset's first two components, or NULL if it has fewer than two
+ */
+const SpatialGrid* DatasetCache_getGrid(DatasetCache* cache, const CachedDataset* dataset);
+
+/**
+ * @brief Releases a dataset returned by DatasetCache_acquire
+ * @param cache Cache that owns the dataset
+ * @param dataset Dataset to release
+ */
+void DatasetCache_release(DatasetCache* cache, const CachedDataset* dataset);
+
+/**
+ * @brief Changes the memory budget, evicting unused datasets right away if it shrank
+ * @param cache Cache to change
+ * @param memoryBudgetBytes New budget, 0 = unlimited
+ */
+void DatasetCache_setBudget(DatasetCache* cache, long long memoryBudgetBytes);
+
+/**
+ * @brief Reads the cache counters
+ * @param cache Cache to inspect
+ * @param stats Output parameter for the counters
+ */
+void DatasetCache_getStats(DatasetCache* cache, DatasetCacheStats* stats);
+
+/**
+ * @brief Frees the cache and every dataset in it
+ * @param cache Cache to free; no dataset may still be held
+ */
+void DatasetCache_destroy(DatasetCache* cache);
+
+#endif // DATASET_CACHE_H
@@ -0,0 +1,361 @@
+/**
+ * @file datasetGenerator.cpp
+ * @brief Implementation of the synthetic dataset generator
+ */
+
+#include "datasetGenerator.h"
+#include "fileHandler.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+/** Rows each worker generates and formats per batch when writing a file */
+#define GEN_ROWS_PER_CHUNK 65536
+/** Minimum rows per worker before another thread is worth starting */
+#define GEN_ROWS_PER_THREAD 65536
+/** Longest CSV text for one value: sign, 19 digits, point, 2 decimals, separator */
+#define GEN_MAX_VALUE_CHARS 24
+
+static const char* DISTRIBUTION_NAMES[GEN_DIST_COUNT] = {
+    "uniform", "clusters", "sorted", "reversed", "duplicates", "adversarial"
+};
+
+/** Stream ids mixed into the hash so each use of a row's randomness is independent */
+enum { STREAM_VALUE = 1, STREAM_CLUSTER, STREAM_CENTRE, STREAM_GAUSS, STREAM_JITTER };
+
+/** SplitMix64 finaliser: a cheap, well-mixed hash of a 64-bit counter */
+static inline unsigned long long mix64(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline unsigned long long randomBits(unsigned long long seed, long long row, int stream, int col) {
+    return mix64(seed ^ mix64((unsigned long long)row * 0x100000001b3ULL + ((unsigned long long)stream << 48) + (unsigned int)col));
+}
+
+/** Uniform integer in [low, high] */
+static inline long long randomRange(unsigned long long bits, long long low, long long high) {
+    return low + (long long)(bits % (unsigned long long)(high - low + 1));
+}
+
+/** Uniform double in (0, 1) */
+static inline double randomUnit(unsigned long long bits) {
+    return ((bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/** Position (0 .. rows-1) of a row in the median-of-3 killer permutation (Musser 1997) */
+static long long adversarialRank(long long row, long long rows) {
+    long long k = rows / 2;
+    if (row >= 2 * k) return rows - 1;   // Odd row count: largest value last
+    if (row < k) {
+        // i = row + 1 runs 1..k; odd i take value i, even i take the odd values above k
+        // (k + i - 1 when k is even, k + i when k is odd), so no value is used twice
+        return (row % 2 == 0) ? row : k + row - 1 + k % 2;
+    }
+    return 2 * (row - k + 1) - 1;
+}
+
+/**
+ * Splits a target row sum (in cents) into cols values within [low, high],
+ * then moves random amounts between neighbouring pairs so the row sum
+ * stays exact but the individual values look random.
+ */
+static void splitSum(long long sum, long long low, long long high, int cols,
+                     unsigned long long seed, long long row, long long* out) {
+    long long base = sum / cols;
+    long long remainder = sum - base * cols;
+    if (remainder < 0) {
+        base--;
+        remainder += cols;
+    }
+    for (int j = 0; j < cols; j++) {
+        out[j] = base + (j < remainder ? 1 : 0);
+    }
+    for (int j = 0; j + 1 < cols; j += 2) {
+        long long lowShift = low - out[j] > out[j + 1] - high ? low - out[j] : out[j + 1] - high;
+        long long highShift = high - out[j] < out[j + 1] - low ? high - out[j] : out[j + 1] - low;
+        long long shift = randomRange(randomBits(seed, row, STREAM_JITTER, j), lowShift, highShift);
+        out[j] += shift;
+        out[j + 1] -= shift;
+    }
+}
+
+/** Generates one row as integer cents */
+static void generateRow(const GeneratorConfig* config, long long low, long long high,
+                        long long row, long long* out) {
+    int cols = config->cols;
+    unsigned long long seed = config->seed;
+
+    switch (config->distribution) {
+        case GEN_DIST_CLUSTERS: {
+            int clusters = config->clusters > 0 ? config->clusters : 1;
+            int cluster = (int)(randomBits(seed, row, STREAM_CLUSTER, 0) % (unsigned int)clusters);
+            double spread = (double)(high - low) / (8.0 * clusters);
+            for (int j = 0; j < cols; j++) {
+                // Centres depend only on the seed and cluster, not on the row
+                long long centre = randomRange(randomBits(seed, cluster, STREAM_CENTRE, j), low, high);
+                double u1 = randomUnit(randomBits(seed, row, STREAM_GAUSS, 2 * j));
+                double u2 = randomUnit(randomBits(seed, row, STREAM_GAUSS, 2 * j + 1));
+                double gauss = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+                long long value = centre + llround(gauss * spread);
+                out[j] = value < low ? low : value > high ? high : value;
+            }
+            break;
+        }
+        case GEN_DIST_SORTED:
+        case GEN_DIST_REVERSED:
+        case GEN_DIST_ADVERSARIAL: {
+            long long rank = row;
+            if (config->distribution == GEN_DIST_REVERSED) rank = config->rows - 1 - row;
+            if (config->distribution == GEN_DIST_ADVERSARIAL) rank = adversarialRank(row, config->rows);
+            long long lowSum = low * cols;
+            long long span = (high - low) * cols;
+            long long sum = lowSum;
+            if (config->rows > 1) {
+                sum += (long long)((double)span * rank / (config->rows - 1));
+            }
+            splitSum(sum, low, high, cols, seed, row, out);
+            break;
+        }
+        case GEN_DIST_DUPLICATES: {
+            int levels = config->distinctValues > 1 ? config->distinctValues : 2;
+            for (int j = 0; j < cols; j++) {
+                int level = (int)(randomBits(seed, row, STREAM_VALUE, j) % (unsigned int)levels);
+                out[j] = low + (high - low) * level / (levels - 1);
+            }
+            break;
+        }
+        case GEN_DIST_UNIFORM:
+        default:
+            for (int j = 0; j < cols; j++) {
+                out[j] = randomRange(randomBits(seed, row, STREAM_VALUE, j), low, high);
+            }
+            break;
+    }
+}
+
+static void valueRangeCents(const GeneratorConfig* config, long long* low, long long* high) {
+    *low = llround(config->minValue * 100.0);
+    *high = llround(config->maxValue * 100.0);
+    if (*high < *low) {
+        long long swap = *low;
+        *low = *high;
+        *high = swap;
+    }
+}
+
+static int chooseThreadCount(const GeneratorConfig* config) {
+    int hw = config->threads > 0 ? config->threads : (int)std::thread::hardware_concurrency();
+    if (hw < 1) hw = 1;
+    long long wanted = config->rows / GEN_ROWS_PER_THREAD + 1;
+    return wanted < hw ? (int)wanted : hw;
+}
+
+void DatasetGenerator_defaults(GeneratorConfig* config) {
+    config->rows = 1000;
+    config->cols = 3;
+    config->distribution = GEN_DIST_UNIFORM;
+    config->seed = 1;
+    config->minValue = -1000.0;
+    config->maxValue = 1000.0;
+    config->clusters = 8;
+    config->distinctValues = 5;
+    config->threads = 0;
+}
+
+int DatasetGenerator_parseDistribution(const char* name) {
+    for (int d = 0; d < GEN_DIST_COUNT; d++) {
+        if (strcmp(name, DISTRIBUTION_NAMES[d]) == 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+const char* DatasetGenerator_distributionName(GeneratorDistribution distribution) {
+    return distribution >= 0 && distribution < GEN_DIST_COUNT ? DISTRIBUTION_NAMES[distribution] : "unknown";
+}
+
+void DatasetGenerator_fillRows(const GeneratorConfig* config, long long firstRow, long long count, double* out) {
+    long long low, high;
+    valueRangeCents(config, &low, &high);
+    std::vector<long long> cents(config->cols);
+    for (long long i = 0; i < count; i++) {
+        generateRow(config, low, high, firstRow + i, cents.data());
+        for (int j = 0; j < config->cols; j++) {
+            out[i * config->cols + j] = cents[j] / 100.0;
+        }
+    }
+}
+
+void DatasetGenerator_fill(const GeneratorConfig* config, double* out) {
+    TRACE_SCOPE("DatasetGenerator_fill");
+    int nThreads = chooseThreadCount(config);
+    if (nThreads <= 1) {
+        DatasetGenerator_fillRows(config, 0, config->rows, out);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        long long begin = config->rows * t / nThreads;
+        long long end = config->rows * (t + 1) / nThreads;
+        workers.emplace_back([=]() {
+            TRACE_THREAD_NAME("generator worker");
+            DatasetGenerator_fillRows(config, begin, end - begin, out + begin * config->cols);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+double** DatasetGenerator_generate(const GeneratorConfig* config) {
+    if (config->rows <= 0 || config->rows > 0x7fffffff || config->cols <= 0) {
+        return NULL;
+    }
+    int n = (int)config->rows;
+    double* block = (double*)malloc((size_t)n * config->cols * sizeof(double));
+    double** data = (double**)calloc(n, sizeof(double*));
+    if (!block || !data) {
+        free(block);
+        free(data);
+        return NULL;
+    }
+    DatasetGenerator_fill(config, block);
+
+    // Copy into one allocation per row so FileHandler_freeCoordinates applies
+    for (int i = 0; i < n; i++) {
+        data[i] = (double*)malloc(config->cols * sizeof(double));
+        if (!data[i]) {
+            FileHandler_freeCoordinates(data, i);
+            free(block);
+            return NULL;
+        }
+        memcpy(data[i], block + (size_t)i * config->cols, config->cols * sizeof(double));
+    }
+    free(block);
+    return data;
+}
+
+/** Writes cents as fixed-point text with two decimals ("%.2f" without the locale and parsing cost) */
+static char* formatCents(char* p, long long cents) {
+    unsigned long long magnitude;
+    if (cents < 0) {
+        *p++ = '-';
+        magnitude = 0ULL - (unsigned long long)cents;
+    } else {
+        magnitude = (unsigned long long)cents;
+    }
+    char digits[24];
+    int count = 0;
+    unsigned long long whole = magnitude / 100;
+    do {
+        digits[count++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (count) {
+        *p++ = digits[--count];
+    }
+    *p++ = '.';
+    *p++ = (char)('0' + magnitude / 10 % 10);
+    *p++ = (char)('0' + magnitude % 10);
+    return p;
+}
+
+/** Generates and serialises one chunk of rows into buffer, returning its length in bytes */
+static size_t formatChunk(const GeneratorConfig* config, GeneratorFormat format,
+                          long long firstRow, long long count, std::vector<char>& buffer) {
+    long long low, high;
+    valueRangeCents(config, &low, &high);
+    int cols = config->cols;
+    std::vector<long long> cents(cols);
+
+    if (format == GEN_FORMAT_BINARY) {
+        buffer.resize((size_t)count * cols * sizeof(double));
+        double* out = (double*)buffer.data();
+        for (long long i = 0; i < count; i++) {
+            generateRow(config, low, high, firstRow + i, cents.data());
+            for (int j = 0; j < cols; j++) {
+                *out++ = cents[j] / 100.0;
+            }
+        }
+        return buffer.size();
+    }
+
+    buffer.resize((size_t)count * cols * GEN_MAX_VALUE_CHARS);
+    char* p = buffer.data();
+    for (long long i = 0; i < count; i++) {
+        generateRow(config, low, high, firstRow + i, cents.data());
+        for (int j = 0; j < cols; j++) {
+            p = formatCents(p, cents[j]);
+            *p++ = j < cols - 1 ? ',' : '\n';
+        }
+    }
+    return (size_t)(p - buffer.data());
+}
+
+int DatasetGenerator_writeFile(const GeneratorConfig* config, const char* filename, GeneratorFormat format) {
+    TRACE_SCOPE("DatasetGenerator_writeFile");
+    if (config->rows < 0 || config->cols <= 0) {
+        return 0;
+    }
+    FILE* file = fopen(filename, format == GEN_FORMAT_BINARY ? "wb" : "w");
+    if (!file) {
+        fprintf(stderr, "Error creating output file: %s\n", filename);
+        return 0;
+    }
+
+    int ok = 1;
+    if (format == GEN_FORMAT_BINARY) {
+        FileBinaryHeader header = {};
+        memcpy(header.magic, FILE_BINARY_MAGIC, 4);
+        header.version = FILE_BINARY_VERSION;
+        header.cols = (uint32_t)config->cols;
+        header.rows = (uint64_t)config->rows;
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    // Workers fill one chunk each per batch; chunks are written in row order
+    int nThreads = chooseThreadCount(config);
+    std::vector<std::vector<char>> buffers(nThreads);
+    std::vector<size_t> lengths(nThreads);
+    for (long long batch = 0; ok && batch < config->rows; batch += (long long)nThreads * GEN_ROWS_PER_CHUNK) {
+        auto work = [&](int t) {
+            long long first = batch + (long long)t * GEN_ROWS_PER_CHUNK;
+            long long count = config->rows - first;
+            if (count > GEN_ROWS_PER_CHUNK) count = GEN_ROWS_PER_CHUNK;
+            lengths[t] = count > 0 ? formatChunk(config, format, first, count, buffers[t]) : 0;
+        };
+        if (nThreads <= 1) {
+            work(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < nThreads; t++) {
+                workers.emplace_back([&, t]() {
+                    TRACE_THREAD_NAME("generator worker");
+                    work(t);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+        for (int t = 0; ok && t < nThreads; t++) {
+            ok = fwrite(buffers[t].data(), 1, lengths[t], file) == lengths[t];
+        }
+    }
+
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error writing output file: %s\n", filename);
+    }
+    return ok;
+}
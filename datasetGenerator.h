@@ -0,0 +1,100 @@
+/**
+ * @file datasetGenerator.h
+ * @brief Reproducible synthetic coordinate datasets for scale testing
+ *
+ * Every row is a pure function of (seed, row index), so a dataset is the
+ * same no matter how many threads generate it or in what order the rows are
+ * produced. Values are multiples of 0.01, matching the two decimals that
+ * FileHandler_saveCoordinates writes, so a CSV round trip is exact.
+ */
+
+#ifndef DATASET_GENERATOR_H
+#define DATASET_GENERATOR_H
+
+/** Value distributions */
+typedef enum {
+    GEN_DIST_UNIFORM,      ///< Independent uniform values in [minValue, maxValue]
+    GEN_DIST_CLUSTERS,     ///< Gaussian blobs around random centres
+    GEN_DIST_SORTED,       ///< Row sums non-decreasing by row index
+    GEN_DIST_REVERSED,     ///< Row sums non-increasing by row index
+    GEN_DIST_DUPLICATES,   ///< Values drawn from a few evenly spaced levels
+    GEN_DIST_ADVERSARIAL,  ///< Row sums in median-of-3 killer order (worst case for quicksort)
+    GEN_DIST_COUNT
+} GeneratorDistribution;
+
+/** Output file formats */
+typedef enum {
+    GEN_FORMAT_CSV,     ///< Same text format as FileHandler_saveCoordinates
+    GEN_FORMAT_BINARY   ///< FileHandler binary format (see FileBinaryHeader)
+} GeneratorFormat;
+
+/**
+ * @struct GeneratorConfig
+ * @brief Describes a dataset; fill with DatasetGenerator_defaults first
+ */
+typedef struct {
+    long long rows;
+    int cols;
+    GeneratorDistribution distribution;
+    unsigned long long seed;
+    double minValue;        ///< Smallest component value
+    double maxValue;        ///< Largest component value
+    int clusters;           ///< Number of blobs for GEN_DIST_CLUSTERS
+    int distinctValues;     ///< Number of levels for GEN_DIST_DUPLICATES
+    int threads;            ///< Worker threads, 0 = one per hardware thread
+} GeneratorConfig;
+
+/**
+ * @brief Sets every field to its default (1000 x 3 uniform values in [-1000, 1000], seed 1)
+ * @param config Configuration to initialise
+ */
+void DatasetGenerator_defaults(GeneratorConfig* config);
+
+/**
+ * @brief Looks up a distribution by name
+ * @param name "uniform", "clusters", "sorted", "reversed", "duplicates" or "adversarial"
+ * @return The distribution, or -1 if the name is unknown
+ */
+int DatasetGenerator_parseDistribution(const char* name);
+
+/**
+ * @brief Name of a distribution, as accepted by DatasetGenerator_parseDistribution
+ * @param distribution Distribution to name
+ * @return Static string
+ */
+const char* DatasetGenerator_distributionName(GeneratorDistribution distribution);
+
+/**
+ * @brief Generates a range of rows on the calling thread
+ * @param config Dataset description
+ * @param firstRow Index of the first row to generate
+ * @param count Number of rows to generate
+ * @param out Destination for count * cols values, row-major
+ */
+void DatasetGenerator_fillRows(const GeneratorConfig* config, long long firstRow, long long count, double* out);
+
+/**
+ * @brief Generates the whole dataset into a contiguous block using config->threads workers
+ * @param config Dataset description
+ * @param out Destination for rows * cols values, row-major
+ */
+void DatasetGenerator_fill(const GeneratorConfig* config, double* out);
+
+/**
+ * @brief Generates the dataset as a coordinate array
+ * @param config Dataset description (rows must fit in an int)
+ * @return 2D array of coordinates, or NULL on failure
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** DatasetGenerator_generate(const GeneratorConfig* config);
+
+/**
+ * @brief Generates the dataset straight to a file, in parallel, without holding it in memory
+ * @param config Dataset description
+ * @param filename Path to the output file
+ * @param format CSV or binary
+ * @return 1 on success, 0 if the file could not be written
+ */
+int DatasetGenerator_writeFile(const GeneratorConfig* config, const char* filename, GeneratorFormat format);
+
+#endif // DATASET_GENERATOR_H
@@ -0,0 +1,86 @@
+/**
+ * @file datasetGeneratorTest.cpp
+ * @brief Checks of every generator distribution (run by ctest)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "datasetGenerator.h"
+
+static int g_failures = 0;
+
+static void fail(const GeneratorConfig* config, const char* what) {
+    printf("FAIL %s, %lld rows: %s\n", DatasetGenerator_distributionName(config->distribution), config->rows, what);
+    g_failures++;
+}
+
+/**
+ * Checks one configuration. Every distribution must stay in range and give
+ * the same rows however the work is split. The ranked distributions must
+ * also give each row a distinct row sum, i.e. their ranks are a permutation.
+ */
+static void checkDistribution(const GeneratorConfig* config) {
+    long long rows = config->rows;
+    int cols = config->cols;
+    std::vector<double> whole(rows * cols), split(rows * cols);
+    DatasetGenerator_fill(config, whole.data());
+    long long half = rows / 2;
+    DatasetGenerator_fillRows(config, 0, half, split.data());
+    DatasetGenerator_fillRows(config, half, rows - half, split.data() + half * cols);
+    if (memcmp(whole.data(), split.data(), whole.size() * sizeof(double)) != 0) {
+        fail(config, "rows depend on how the work is split");
+    }
+    for (double value : whole) {
+        if (value < config->minValue || value > config->maxValue) {
+            fail(config, "value out of range");
+            break;
+        }
+    }
+
+    GeneratorDistribution d = config->distribution;
+    if (d != GEN_DIST_SORTED && d != GEN_DIST_REVERSED && d != GEN_DIST_ADVERSARIAL) {
+        return;
+    }
+    // Sums in cents are exact, and distinct ranks give distinct sums
+    std::vector<long long> sums(rows);
+    for (long long i = 0; i < rows; i++) {
+        long long sum = 0;
+        for (int j = 0; j < cols; j++) {
+            sum += llround(whole[i * cols + j] * 100.0);
+        }
+        sums[i] = sum;
+    }
+    for (long long i = 0; i + 1 < rows; i++) {
+        if ((d == GEN_DIST_SORTED && sums[i] >= sums[i + 1]) || (d == GEN_DIST_REVERSED && sums[i] <= sums[i + 1])) {
+            fail(config, "rows out of order");
+            break;
+        }
+    }
+    std::sort(sums.begin(), sums.end());
+    if (std::adjacent_find(sums.begin(), sums.end()) != sums.end()) {
+        fail(config, "row ranks are not a permutation");
+    }
+}
+
+int main(void) {
+    // Even and odd row counts, with rows / 2 both even and odd
+    const long long rowCounts[] = {1, 2, 5, 6, 7, 8, 9, 1000, 1002, 1003};
+    for (int d = 0; d < GEN_DIST_COUNT; d++) {
+        for (long long rows : rowCounts) {
+            GeneratorConfig config;
+            DatasetGenerator_defaults(&config);
+            config.distribution = (GeneratorDistribution)d;
+            config.rows = rows;
+            config.seed = 42;
+            checkDistribution(&config);
+        }
+    }
+    if (g_failures == 0) {
+        printf("All generator checks passed\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,596 @@
+/**
+ * @file fileCatalog.cpp
+ * @brief Implementation of directory listings for the file picker
+ */
+
+#include "fileCatalog.h"
+#include "fileHandler.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+/** Bit of a character in CatalogEntry::charMask; case is ignored */
+static uint64_t charBit(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') {
+        c = (unsigned char)(c + ('a' - 'A'));
+    }
+    if (c >= 'a' && c <= 'z') {
+        return 1ULL << (c - 'a');
+    }
+    if (c >= '0' && c <= '9') {
+        return 1ULL << (26 + c - '0');
+    }
+    return 1ULL << (36 + c % 28);
+}
+
+static uint64_t charMask(const char* text) {
+    uint64_t mask = 0;
+    for (; *text; text++) {
+        mask |= charBit((unsigned char)*text);
+    }
+    return mask;
+}
+
+static int endsWith(const char* name, size_t nameLength, const char* suffix, size_t suffixLength) {
+    return nameLength >= suffixLength && strcmp(name + nameLength - suffixLength, suffix) == 0;
+}
+
+static FileCatalog* createCatalog(const char* directory) {
+    FileCatalog* catalog = (FileCatalog*)calloc(1, sizeof(FileCatalog));
+    if (!catalog) {
+        return NULL;
+    }
+    catalog->directory = (char*)malloc(strlen(directory) + 1);
+    if (!catalog->directory) {
+        free(catalog);
+        return NULL;
+    }
+    strcpy(catalog->directory, directory);
+    return catalog;
+}
+
+int FileCatalog_add(FileCatalog* catalog, const char* name, long long bytes) {
+    size_t length = strlen(name) + 1;
+    if (catalog->arenaSize + length > catalog->arenaCapacity) {
+        size_t capacity = catalog->arenaCapacity ? catalog->arenaCapacity * 2 : 4096;
+        while (capacity < catalog->arenaSize + length) {
+            capacity *= 2;
+        }
+        char* arena = (char*)realloc(catalog->arena, capacity);
+        if (!arena) {
+            return 0;
+        }
+        catalog->arena = arena;
+        catalog->arenaCapacity = capacity;
+    }
+    if (catalog->count == catalog->capacity) {
+        int capacity = catalog->capacity ? catalog->capacity * 2 : 64;
+        CatalogEntry* entries = (CatalogEntry*)realloc(catalog->entries, capacity * sizeof(CatalogEntry));
+        if (!entries) {
+            return 0;
+        }
+        catalog->entries = entries;
+        catalog->capacity = capacity;
+    }
+
+    CatalogEntry* entry = &catalog->entries[catalog->count++];
+    entry->nameOffset = catalog->arenaSize;
+    entry->bytes = bytes;
+    entry->rows = -1;
+    entry->charMask = charMask(name);
+    memcpy(catalog->arena + catalog->arenaSize, name, length);
+    catalog->arenaSize += length;
+    return 1;
+}
+
+static void sortCatalog(FileCatalog* catalog) {
+    const char* arena = catalog->arena;
+    std::sort(catalog->entries, catalog->entries + catalog->count,
+              [arena](const CatalogEntry& a, const CatalogEntry& b) {
+                  return strcmp(arena + a.nameOffset, arena + b.nameOffset) < 0;
+              });
+}
+
+/*
+ * Scanning. Worker threads take directories from a shared queue, list them
+ * and queue the subdirectories they find. On POSIX systems a subdirectory is
+ * opened relative to its parent's descriptor, which stays open until every
+ * queued child has been opened, so a path renamed or swapped for a link
+ * mid-scan is never followed; the queue is worked newest first, which keeps
+ * only the parents along the current branches open. Matching files are collected in a
+ * per-directory batch and moved to the scan's pending catalog under its lock;
+ * FileCatalog_poll copies them into the caller's catalog on the caller's
+ * thread, so the caller can read its catalog without locking.
+ */
+
+/** Files a worker collects before handing them over */
+#define SCAN_BATCH_FILES 256
+
+/** Open directory shared by the subdirectories queued from it */
+typedef struct {
+    int fd;
+    std::atomic<int> references;   ///< Queued children plus the worker listing it
+} ScanParent;
+
+/** Directory waiting to be listed */
+typedef struct {
+    std::string relative;          ///< Path relative to root
+    ScanParent* parent;            ///< Opened from this, NULL for the root and on Windows
+} ScanDirectory;
+
+struct FileScan {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<ScanDirectory> directories; ///< Waiting to be listed
+    int busy = 0;                           ///< Workers listing a directory right now
+    bool stop = false;
+    FileCatalog pending = {};               ///< Found since the last poll
+    std::string root;
+    std::string extension;
+    int recursive = 0;
+    std::vector<std::thread> workers;
+};
+
+/** Files and subdirectories found in one directory, handed over together */
+typedef struct {
+    FileCatalog files;
+    std::vector<ScanDirectory> subdirectories;
+    ScanParent* parent;            ///< Directory being listed, NULL on Windows
+} ScanBatch;
+
+static void handOver(FileScan* scan, ScanBatch* batch) {
+    std::lock_guard<std::mutex> lock(scan->mutex);
+    for (int i = 0; i < batch->files.count; i++) {
+        FileCatalog_add(&scan->pending, FileCatalog_name(&batch->files, i), batch->files.entries[i].bytes);
+    }
+    for (ScanDirectory& directory : batch->subdirectories) {
+        scan->directories.push_back(std::move(directory));
+    }
+    if (!batch->subdirectories.empty()) {
+        scan->changed.notify_all();
+    }
+    batch->files.count = 0;
+    batch->files.arenaSize = 0;
+    batch->subdirectories.clear();
+}
+
+/** Records one directory entry; type is 1 for a regular file, 2 for a directory */
+static void foundEntry(FileScan* scan, ScanBatch* batch, const std::string& relative,
+                       const char* name, int type, long long bytes) {
+    std::string path = relative.empty() ? std::string(name) : relative + "/" + name;
+    if (type == 2) {
+        if (batch->parent) {
+            batch->parent->references++;
+        }
+        batch->subdirectories.push_back({path, batch->parent});
+    } else if (!FileCatalog_add(&batch->files, path.c_str(), bytes) || batch->files.count >= SCAN_BATCH_FILES) {
+        handOver(scan, batch);
+    }
+}
+
+static int matchesExtension(const FileScan* scan, const char* name) {
+    return endsWith(name, strlen(name), scan->extension.c_str(), scan->extension.size());
+}
+
+#ifdef _WIN32
+static int openable(const char* directory) {
+    DWORD attributes = GetFileAttributesA(directory);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+static void listDirectory(FileScan* scan, const ScanDirectory& directory, ScanBatch* batch) {
+    const std::string& relative = directory.relative;
+    std::string pattern = scan->root + "\\" + relative + (relative.empty() ? "*" : "\\*");
+    WIN32_FIND_DATAA findData;
+    // Basic info and large fetches: no short names, fewer kernel round trips
+    HANDLE hFind = FindFirstFileExA(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch,
+                                    NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        const char* name = findData.cFileName;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            // Skip ".", ".." and links to directories
+            if (scan->recursive && strcmp(name, ".") != 0 && strcmp(name, "..") != 0 &&
+                !(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                foundEntry(scan, batch, relative, name, 2, 0);
+            }
+        } else if (matchesExtension(scan, name)) {
+            // The find data already carries the size
+            long long bytes = ((long long)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+            foundEntry(scan, batch, relative, name, 1, bytes);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+}
+#else
+static int openable(const char* directory) {
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+/** Drops one reference to a parent directory and closes it after the last */
+static void releaseParent(ScanParent* parent) {
+    if (parent && parent->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        close(parent->fd);
+        delete parent;
+    }
+}
+
+/** Handles one name read from the directory open as dirFd; dType is the DT_* value from the listing */
+static void listEntry(FileScan* scan, const std::string& relative, ScanBatch* batch,
+                      int dirFd, const char* name, unsigned char dType) {
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        return;
+    }
+    if (dType == DT_DIR) {
+        // The listing already says it is a directory: no stat needed
+        if (scan->recursive) {
+            foundEntry(scan, batch, relative, name, 2, 0);
+        }
+        return;
+    }
+    if (dType != DT_REG && dType != DT_LNK && dType != DT_UNKNOWN) {
+        return;
+    }
+    int matches = matchesExtension(scan, name);
+    if (!matches && !(dType == DT_UNKNOWN && scan->recursive)) {
+        return;  // Not wanted, and cannot be a directory we need
+    }
+
+    // One stat per candidate, relative to the open directory
+#if defined(__linux__) && defined(STATX_SIZE)
+    struct statx info;
+    if (statx(dirFd, name, AT_STATX_DONT_SYNC | (dType == DT_UNKNOWN ? AT_SYMLINK_NOFOLLOW : 0),
+              STATX_TYPE | STATX_SIZE, &info) != 0) {
+        return;
+    }
+    mode_t mode = info.stx_mode;
+    long long bytes = (long long)info.stx_size;
+#else
+    struct stat info;
+    if (fstatat(dirFd, name, &info, dType == DT_UNKNOWN ? AT_SYMLINK_NOFOLLOW : 0) != 0) {
+        return;
+    }
+    mode_t mode = info.st_mode;
+    long long bytes = (long long)info.st_size;
+#endif
+    if (S_ISDIR(mode)) {
+        if (scan->recursive && dType != DT_LNK) {
+            foundEntry(scan, batch, relative, name, 2, 0);
+        }
+    } else if (S_ISREG(mode) && matches) {
+        foundEntry(scan, batch, relative, name, 1, bytes);
+    } else if (S_ISLNK(mode) && matches) {
+        // Unknown type turned out to be a link: a link to a file counts
+        struct stat target;
+        if (fstatat(dirFd, name, &target, 0) == 0 && S_ISREG(target.st_mode)) {
+            foundEntry(scan, batch, relative, name, 1, (long long)target.st_size);
+        }
+    }
+}
+
+#ifdef __linux__
+/** Record layout returned by the getdents64 system call */
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+static void listDirectory(FileScan* scan, const ScanDirectory& directory, ScanBatch* batch) {
+    const std::string& relative = directory.relative;
+    int dirFd;
+    if (directory.parent) {
+        // Only the last component, looked up in the already open parent; never through a link
+        size_t slash = relative.rfind('/');
+        const char* name = relative.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+        dirFd = openat(directory.parent->fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        releaseParent(directory.parent);
+    } else {
+        dirFd = open(scan->root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (dirFd < 0) {
+        return;
+    }
+    ScanParent* parent = new (std::nothrow) ScanParent;
+    if (!parent) {
+        close(dirFd);
+        return;
+    }
+    parent->fd = dirFd;
+    parent->references = 1;
+    batch->parent = parent;
+#ifdef __linux__
+    // Raw getdents64: many entries per system call and no DIR* allocation
+    char buffer[64 * 1024];
+    long bytes;
+    while ((bytes = syscall(SYS_getdents64, dirFd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < bytes;) {
+            const LinuxDirent64* entry = (const LinuxDirent64*)(buffer + offset);
+            listEntry(scan, relative, batch, dirFd, entry->d_name, entry->d_type);
+            offset += entry->d_reclen;
+        }
+    }
+#else
+    // The stream gets its own descriptor; dirFd stays open for the children
+    int streamFd = dup(dirFd);
+    DIR* dir = streamFd >= 0 ? fdopendir(streamFd) : NULL;
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            listEntry(scan, relative, batch, dirFd, entry->d_name, entry->d_type);
+        }
+        closedir(dir);
+    } else if (streamFd >= 0) {
+        close(streamFd);
+    }
+#endif
+    batch->parent = NULL;
+    releaseParent(parent);
+}
+#endif
+
+static void scanWorker(FileScan* scan) {
+    ScanBatch batch = {};
+    std::unique_lock<std::mutex> lock(scan->mutex);
+    while (true) {
+        scan->changed.wait(lock, [scan] {
+            return scan->stop || !scan->directories.empty() || scan->busy == 0;
+        });
+        if (scan->stop || scan->directories.empty()) {
+            break;  // Stopped, or nothing queued and nobody left to queue more
+        }
+        ScanDirectory directory = std::move(scan->directories.back());
+        scan->directories.pop_back();
+        scan->busy++;
+        lock.unlock();
+
+        listDirectory(scan, directory, &batch);
+        handOver(scan, &batch);
+
+        lock.lock();
+        scan->busy--;
+        if (scan->busy == 0 && scan->directories.empty()) {
+            scan->changed.notify_all();  // Finished: wake the other workers and any waiter
+        }
+    }
+    lock.unlock();
+    free(batch.files.arena);
+    free(batch.files.entries);
+}
+
+/** Joins the workers of a finished or stopped scan and frees it */
+static void endScan(FileCatalog* catalog) {
+    FileScan* scan = catalog->scan;
+    for (std::thread& worker : scan->workers) {
+        worker.join();
+    }
+#ifndef _WIN32
+    // A stopped scan leaves directories queued; their parents are still open
+    for (ScanDirectory& directory : scan->directories) {
+        releaseParent(directory.parent);
+    }
+#endif
+    free(scan->pending.arena);
+    free(scan->pending.entries);
+    delete scan;
+    catalog->scan = NULL;
+}
+
+FileCatalog* FileCatalog_startScan(const char* directory, const char* extension, int recursive) {
+    if (!openable(directory)) {
+        return NULL;
+    }
+    FileCatalog* catalog = createCatalog(directory);
+    if (!catalog) {
+        return NULL;
+    }
+    FileScan* scan = new FileScan();
+    scan->root = directory;
+    scan->extension = extension;
+    scan->recursive = recursive;
+    scan->directories.push_back({"", NULL});
+    catalog->scan = scan;
+
+    int workers = 1;
+    if (recursive) {
+        workers = (int)std::thread::hardware_concurrency();
+        workers = workers < 2 ? 2 : (workers > FILE_CATALOG_MAX_WORKERS ? FILE_CATALOG_MAX_WORKERS : workers);
+    }
+    for (int i = 0; i < workers; i++) {
+        scan->workers.emplace_back(scanWorker, scan);
+    }
+    return catalog;
+}
+
+int FileCatalog_poll(FileCatalog* catalog) {
+    FileScan* scan = catalog->scan;
+    if (!scan) {
+        return 0;
+    }
+    int running;
+    {
+        std::lock_guard<std::mutex> lock(scan->mutex);
+        for (int i = 0; i < scan->pending.count; i++) {
+            FileCatalog_add(catalog, FileCatalog_name(&scan->pending, i), scan->pending.entries[i].bytes);
+        }
+        scan->pending.count = 0;
+        scan->pending.arenaSize = 0;
+        running = scan->busy > 0 || !scan->directories.empty();
+    }
+    if (running) {
+        return 1;
+    }
+    endScan(catalog);
+    sortCatalog(catalog);
+    return 0;
+}
+
+void FileCatalog_wait(FileCatalog* catalog) {
+    FileScan* scan = catalog->scan;
+    if (!scan) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(scan->mutex);
+        scan->changed.wait(lock, [scan] { return scan->busy == 0 && scan->directories.empty(); });
+    }
+    FileCatalog_poll(catalog);
+}
+
+FileCatalog* FileCatalog_scan(const char* directory, const char* extension) {
+    TRACE_SCOPE("FileCatalog_scan");
+    FileCatalog* catalog = FileCatalog_startScan(directory, extension, 0);
+    if (catalog) {
+        FileCatalog_wait(catalog);
+    }
+    return catalog;
+}
+
+const char* FileCatalog_name(const FileCatalog* catalog, int index) {
+    return catalog->arena + catalog->entries[index].nameOffset;
+}
+
+long long FileCatalog_estimateRows(FileCatalog* catalog, int index) {
+    CatalogEntry* entry = &catalog->entries[index];
+    if (entry->rows >= 0) {
+        return entry->rows;
+    }
+    entry->rows = 0;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", catalog->directory, FileCatalog_name(catalog, index));
+    int cols;
+    FileHandler_estimateShape(path, entry->bytes, &entry->rows, &cols);
+    return entry->rows;
+}
+
+/** ASCII lower-case table; cheaper than tolower, which consults the locale */
+static unsigned char g_fold[256];
+
+static void initFold(void) {
+    if (g_fold['A'] == 'a') {
+        return;
+    }
+    for (int c = 0; c < 256; c++) {
+        g_fold[c] = (unsigned char)((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+    }
+}
+
+/**
+ * Case-insensitive subsequence search of a folded pattern from offset start
+ * @return Offset just past the last matched character, or -1 if there is no match
+ */
+static int matchFrom(const unsigned char* name, int start, const unsigned char* pattern) {
+    const unsigned char* at = name + start;
+    for (; *pattern; pattern++) {
+        while (*at && g_fold[*at] != *pattern) {
+            at++;
+        }
+        if (!*at) {
+            return -1;
+        }
+        at++;
+    }
+    return (int)(at - name);
+}
+
+int FileCatalog_filter(const FileCatalog* catalog, const char* pattern, int first, CatalogMatch* matches) {
+    initFold();
+    unsigned char folded[256];
+    size_t length = 0;
+    for (; pattern[length] && length < sizeof(folded) - 1; length++) {
+        folded[length] = g_fold[(unsigned char)pattern[length]];
+    }
+    folded[length] = '\0';
+
+    uint64_t wanted = charMask(pattern);
+    const unsigned char* arena = (const unsigned char*)catalog->arena;
+    int count = 0;
+    for (int i = first; i < catalog->count; i++) {
+        const CatalogEntry* entry = &catalog->entries[i];
+        // Names missing one of the pattern's characters are rejected without a scan
+        if ((entry->charMask & wanted) != wanted) {
+            continue;
+        }
+        int end = matchFrom(arena + entry->nameOffset, 0, folded);
+        if (end >= 0) {
+            matches[count].index = i;
+            matches[count].end = end;
+            count++;
+        }
+    }
+    return count;
+}
+
+int FileCatalog_refine(const FileCatalog* catalog, char next,
+                       const CatalogMatch* candidates, int nCandidates, CatalogMatch* matches) {
+    initFold();
+    unsigned char pattern[2] = {g_fold[(unsigned char)next], '\0'};
+    uint64_t wanted = charBit((unsigned char)next);
+    const unsigned char* arena = (const unsigned char*)catalog->arena;
+    int count = 0;
+    for (int i = 0; i < nCandidates; i++) {
+        const CatalogEntry* entry = &catalog->entries[candidates[i].index];
+        if (!(entry->charMask & wanted)) {
+            continue;
+        }
+        // The earliest match of the shorter pattern leaves the most room, so continuing from it is enough
+        int end = matchFrom(arena + entry->nameOffset, candidates[i].end, pattern);
+        if (end >= 0) {
+            matches[count].index = candidates[i].index;
+            matches[count].end = end;
+            count++;
+        }
+    }
+    return count;
+}
+
+void FileCatalog_free(FileCatalog* catalog) {
+    if (!catalog) {
+        return;
+    }
+    if (catalog->scan) {
+        {
+            std::lock_guard<std::mutex> lock(catalog->scan->mutex);
+            catalog->scan->stop = true;
+        }
+        catalog->scan->changed.notify_all();
+        endScan(catalog);
+    }
+    free(catalog->directory);
+    free(catalog->arena);
+    free(catalog->entries);
+    free(catalog);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file fileCatalog.h
+ * @brief Directory listings for the file picker, without a size limit
+ *
+ * A catalog holds every matching file of a directory after one pass over it.
+ * Names are stored back to back in a single string arena and entries refer to
+ * them by offset, so a listing costs two growing allocations however many
+ * files there are. Each entry carries the file size from the scan and an
+ * estimated row count that is worked out on demand.
+ *
+ * A scan can also take in every subdirectory. It then runs on worker threads
+ * that list directories in parallel, and the files they find are added to
+ * the catalog whenever its owner calls FileCatalog_poll, so a picker can show
+ * them while the scan goes on. Directories cost no stat call; each matching
+ * file costs one, made relative to its already open directory.
+ *
+ * Filtering is a case-insensitive subsequence match ("bgcs" matches
+ * "big.csv"). Each match remembers where in the name it ended, so typing one
+ * more character only looks at the files that still matched, and in each of
+ * those only at the rest of the name.
+ */
+
+#ifndef FILE_CATALOG_H
+#define FILE_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Most worker threads of a recursive scan */
+#define FILE_CATALOG_MAX_WORKERS 8
+
+/**
+ * @struct CatalogEntry
+ * @brief One file of a catalog
+ */
+typedef struct {
+    size_t nameOffset;   ///< Offset of the NUL-terminated name in the arena
+    long long bytes;     ///< File size
+    long long rows;      ///< Estimated rows, -1 until FileCatalog_estimateRows is called
+    uint64_t charMask;   ///< Letters, digits and punctuation in the name, for quick filter rejection
+} CatalogEntry;
+
+/**
+ * @struct CatalogMatch
+ * @brief A file whose name matched a filter pattern
+ */
+typedef struct {
+    int index;   ///< Entry index
+    int end;     ///< Offset in the name just past the last matched character
+} CatalogMatch;
+
+/** Background state of a running scan */
+typedef struct FileScan FileScan;
+
+/**
+ * @struct FileCatalog
+ * @brief Matching files of a directory
+ */
+typedef struct {
+    char* directory;       ///< Directory the names are relative to
+    char* arena;           ///< Names, back to back
+    size_t arenaSize;
+    size_t arenaCapacity;
+    CatalogEntry* entries;
+    int count;
+    int capacity;
+    FileScan* scan;        ///< Running scan, NULL once it has finished
+} FileCatalog;
+
+/**
+ * @brief Lists the files of a directory whose names end in extension
+ *
+ * Subdirectories are not searched and the names are sorted alphabetically.
+ *
+ * @param directory Directory to list
+ * @param extension Name suffix to match, e.g. "csv"
+ * @return New catalog (possibly empty), or NULL if the directory cannot be read
+ * @note Free the catalog with FileCatalog_free
+ */
+FileCatalog* FileCatalog_scan(const char* directory, const char* extension);
+
+/**
+ * @brief Starts listing the files of a directory, and optionally of all its subdirectories
+ *
+ * The catalog starts out empty and collects files as FileCatalog_poll is
+ * called; it is sorted by name once the scan has finished. Names are
+ * relative to directory, e.g. "2024/05/run1.csv". Symbolic links to
+ * directories are not followed.
+ *
+ * @param directory Directory to list
+ * @param extension Name suffix to match, e.g. "csv"
+ * @param recursive Non-zero to include subdirectories
+ * @return New catalog, or NULL if the directory cannot be read
+ * @note Free the catalog with FileCatalog_free, which also stops the scan
+ */
+FileCatalog* FileCatalog_startScan(const char* directory, const char* extension, int recursive);
+
+/**
+ * @brief Adds the files found since the last call to the catalog
+ *
+ * Call it from the thread that owns the catalog; entries only change here,
+ * so indices stay valid between calls. New files are appended until the
+ * scan finishes, and the call that notices the end sorts the catalog.
+ *
+ * @param catalog Catalog to update
+ * @return 1 while the scan is still running, 0 once it has finished
+ */
+int FileCatalog_poll(FileCatalog* catalog);
+
+/**
+ * @brief Waits for a scan to finish and adds all of its files
+ * @param catalog Catalog to complete
+ */
+void FileCatalog_wait(FileCatalog* catalog);
+
+/**
+ * @brief Adds a file to a catalog
+ * @param catalog Catalog to add to
+ * @param name Name relative to the catalog's directory
+ * @param bytes File size
+ * @return 1 on success, 0 if out of memory
+ */
+int FileCatalog_add(FileCatalog* catalog, const char* name, long long bytes);
+
+/**
+ * @brief Returns the name of an entry, relative to the catalog's directory
+ * @param catalog Catalog to look in
+ * @param index Entry index
+ * @return Name, valid until the catalog grows or is freed
+ */
+const char* FileCatalog_name(const FileCatalog* catalog, int index);
+
+/**
+ * @brief Estimates the number of rows of an entry and remembers it
+ *
+ * Uses FileHandler_estimateShape, which is exact for binary coordinate
+ * files and for small CSV files.
+ *
+ * @param catalog Catalog holding the entry
+ * @param index Entry index
+ * @return Estimated rows, or 0 if the file cannot be read
+ */
+long long FileCatalog_estimateRows(FileCatalog* catalog, int index);
+
+/**
+ * @brief Finds the entries whose names contain pattern as a subsequence, ignoring case
+ * @param catalog Catalog to search
+ * @param pattern Characters to look for, in order
+ * @param first First entry to consider; later entries are searched too
+ * @param matches Output array with room for every entry from first on
+ * @return Number of matches written, in catalog order
+ */
+int FileCatalog_filter(const FileCatalog* catalog, const char* pattern, int first, CatalogMatch* matches);
+
+/**
+ * @brief Narrows the matches of a pattern to those of the pattern plus one character
+ * @param catalog Catalog the matches refer to
+ * @param next Character appended to the pattern
+ * @param candidates Matches of the shorter pattern
+ * @param nCandidates Number of candidates
+ * @param matches Output array with room for every candidate (may not alias candidates)
+ * @return Number of matches written, in candidate order
+ */
+int FileCatalog_refine(const FileCatalog* catalog, char next,
+                       const CatalogMatch* candidates, int nCandidates, CatalogMatch* matches);
+
+/**
+ * @brief Frees a catalog
+ * @param catalog Catalog to free, stopping its scan if one is running (NULL is ignored)
+ */
+void FileCatalog_free(FileCatalog* catalog);
+
+#endif // FILE_CATALOG_H
@@ -4,13 +4,97 @@
  */
 
 #include "fileHandler.h"
+#include "sidecarCache.h"
+#include "contentHash.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
 
-double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols) {
-    FILE* file;
-    if (fopen_s(&file, filename, "r") != 0) {
-        printf("Error opening file: %s\n", filename);
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Files may be loaded from several threads at once (batch mode), so use the
+// re-entrant tokenizer
+#ifdef _WIN32
+#define strtok_r strtok_s
+#endif
+
+/** Bytes read from a CSV file to estimate its shape */
+#define ESTIMATE_SAMPLE_BYTES 4096
+
+/** Rows read between progress reports and cancellation checks */
+#define LOAD_REPORT_ROWS 4096
+
+struct FileLoad {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable done;
+    int finished;
+    std::atomic<long long> bytesDone;
+    std::atomic<long long> totalBytes;
+    std::atomic<int> cancelled;
+    std::atomic<int> background;  ///< Requested priority
+    int appliedBackground;        ///< Priority the loader thread runs at
+    std::chrono::steady_clock::time_point started;
+    void* (*task)(FileLoad* load, void* context);
+    void* context;
+    void* result;
+};
+
+/** Niceness of a background load on Linux */
+#define LOAD_BACKGROUND_NICE 10
+
+/** Lowers or restores the scheduling priority of the calling thread */
+static void setThreadBackground(int background) {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), background ? THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_NORMAL);
+#elif defined(__linux__)
+    // Linux keeps a nice value per thread
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), background ? LOAD_BACKGROUND_NICE : 0);
+#else
+    (void)background;  // Nice values are per process here
+#endif
+}
+
+/** Publishes progress, applies priority changes and tells whether the load has been cancelled (load may be NULL) */
+static int reportProgress(FileLoad* load, long long bytesDone) {
+    if (!load) {
+        return 0;
+    }
+    int background = load->background.load(std::memory_order_relaxed);
+    if (background != load->appliedBackground) {
+        setThreadBackground(background);
+        load->appliedBackground = background;
+    }
+    load->bytesDone.store(bytesDone, std::memory_order_relaxed);
+    return load->cancelled.load(std::memory_order_relaxed);
+}
+
+/** Sidecar_load progress callback; context is the FileLoad */
+static int reportSidecarProgress(void* context, long long bytesDone) {
+    return reportProgress((FileLoad*)context, bytesDone);
+}
+
+/**
+ * Reads a CSV file; each of its two passes accounts for half of the file's bytes.
+ * The file is read in binary mode so that hash (NULL for none) sees the bytes on disk.
+ */
+static double** readCsv(const char* filename, int* rows, int* cols, FileLoad* load, ContentHash* hash) {
+    TRACE_SCOPE("FileHandler_readCoordinates");
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
         return NULL;
     }
     
@@ -18,13 +102,16 @@ double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols)
     *rows = 0;
     *cols = 0;
     char line[1024];
+    long long offset = 0;
     
     // Read first line to determine number of columns
     if (fgets(line, sizeof(line), file)) {
-        char* token = strtok(line, ",");
+        offset += load ? strlen(line) : 0;
+        char* context = NULL;
+        char* token = strtok_r(line, ",", &context);
         while (token) {
             (*cols)++;
-            token = strtok(NULL, ",");
+            token = strtok_r(NULL, ",", &context);
         }
         (*rows)++;
     }
@@ -32,7 +119,18 @@ double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols)
     // Count remaining lines
     while (fgets(line, sizeof(line), file)) {
         (*rows)++;
+        if (load) {
+            offset += strlen(line);
+            if (*rows % LOAD_REPORT_ROWS == 0 && reportProgress(load, offset / 2)) {
+                fclose(file);
+                *rows = 0;
+                *cols = 0;
+                return NULL;
+            }
+        }
     }
+    long long firstPass = offset / 2;
+    offset = 0;
     
     // Allocate memory
     double** data = (double**)malloc(*rows * sizeof(double*));
@@ -54,27 +152,275 @@ double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols)
         }
     }
     
-    // Reset file pointer and read data
+    // Reset file pointer and read data; the hash covers exactly the bytes parsed
     rewind(file);
     for (int i = 0; i < *rows; i++) {
+        if (load && i % LOAD_REPORT_ROWS == 0 && reportProgress(load, firstPass + offset / 2)) {
+            // Cancelled: give back everything allocated so far
+            FileHandler_freeCoordinates(data, *rows);
+            fclose(file);
+            *rows = 0;
+            *cols = 0;
+            return NULL;
+        }
         if (fgets(line, sizeof(line), file)) {
-            char* token = strtok(line, ",");
+            size_t length = load || hash ? strlen(line) : 0;
+            offset += length;
+            if (hash) {
+                ContentHash_update(hash, line, length);
+            }
+            char* context = NULL;
+            char* token = strtok_r(line, ",", &context);
             for (int j = 0; j < *cols && token; j++) {
                 data[i][j] = atof(token);
-                token = strtok(NULL, ",");
+                token = strtok_r(NULL, ",", &context);
             }
         }
     }
     
     fclose(file);
+    reportProgress(load, firstPass + offset / 2);
+    return data;
+}
+
+double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols) {
+    return readCsv(filename, rows, cols, NULL, NULL);
+}
+
+/** Reads a binary coordinate file, adding the bytes read to hash (NULL for none) */
+static double** readBinary(const char* filename, int* rows, int* cols, FileLoad* load, ContentHash* hash) {
+    TRACE_SCOPE("FileHandler_readBinaryCoordinates");
+    *rows = 0;
+    *cols = 0;
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return NULL;
+    }
+
+    FileBinaryHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, FILE_BINARY_MAGIC, 4) != 0 ||
+        header.version != FILE_BINARY_VERSION ||
+        header.cols == 0 || header.rows > 0x7fffffff || header.cols > 0x7fffffff) {
+        fprintf(stderr, "Not a valid binary coordinate file: %s\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    if (hash) {
+        ContentHash_update(hash, &header, sizeof(header));
+    }
+    int n = (int)header.rows;
+    int m = (int)header.cols;
+    long long rowBytes = (long long)m * sizeof(double);
+    double** data = (double**)malloc((n > 0 ? n : 1) * sizeof(double*));
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        if (load && i % LOAD_REPORT_ROWS == 0 && reportProgress(load, (long long)sizeof(header) + i * rowBytes)) {
+            FileHandler_freeCoordinates(data, i);
+            fclose(file);
+            return NULL;
+        }
+        data[i] = (double*)malloc(m * sizeof(double));
+        if (!data[i] || fread(data[i], sizeof(double), m, file) != (size_t)m) {
+            fprintf(stderr, "Binary coordinate file is truncated: %s\n", filename);
+            FileHandler_freeCoordinates(data, data[i] ? i + 1 : i);
+            fclose(file);
+            return NULL;
+        }
+        if (hash) {
+            ContentHash_update(hash, data[i], (size_t)rowBytes);
+        }
+    }
+
+    fclose(file);
+    reportProgress(load, (long long)sizeof(header) + n * rowBytes);
+    *rows = n;
+    *cols = m;
+    return data;
+}
+
+double** FileHandler_readBinaryCoordinates(const char* filename, int* rows, int* cols) {
+    return readBinary(filename, rows, cols, NULL, NULL);
+}
+
+/** Loads a CSV or binary file; contentHash (NULL for none) receives the hash of the data's source bytes */
+static double** loadFile(const char* filename, int* rows, int* cols, FileLoad* load, uint64_t* contentHash) {
+    char magic[4] = {0};
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return NULL;
+    }
+    if (load) {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(filename, error);
+        load->totalBytes.store(error ? 0 : (long long)size);
+    }
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    ContentHash hash;
+    ContentHash_init(&hash, 0);
+    if (got == sizeof(magic) && memcmp(magic, FILE_BINARY_MAGIC, sizeof(magic)) == 0) {
+        double** data = readBinary(filename, rows, cols, load, contentHash ? &hash : NULL);
+        if (data && contentHash) {
+            *contentHash = ContentHash_final(&hash);
+        }
+        return data;
+    }
+
+    // Skip parsing if the CSV has a current sidecar; otherwise leave one for next time
+    SidecarSource source;
+    int useSidecar = Sidecar_enabled() && Sidecar_statSource(filename, &source);
+    if (useSidecar) {
+        // Hashing the CSV and copying the sidecar report progress like the two parsing passes;
+        // the first report applies the requested priority before either starts
+        if (reportProgress(load, 0)) {
+            return NULL;
+        }
+        double** data = Sidecar_load(filename, &source, rows, cols, contentHash,
+                                     load ? reportSidecarProgress : NULL, load);
+        if (data) {
+            reportProgress(load, source.bytes);
+            return data;
+        }
+        if (load && load->cancelled.load(std::memory_order_relaxed)) {
+            return NULL;
+        }
+    }
+    // The sidecar and the caller get the hash of the bytes parsed, not of a separate read
+    int hashing = useSidecar || contentHash;
+    double** data = readCsv(filename, rows, cols, load, hashing ? &hash : NULL);
+    if (data && hashing) {
+        uint64_t parsedHash = ContentHash_final(&hash);
+        if (contentHash) {
+            *contentHash = parsedHash;
+        }
+        if (useSidecar) {
+            Sidecar_writeAsync(filename, &source, parsedHash, data, *rows, *cols);
+        }
+    }
     return data;
 }
 
-void FileHandler_saveCoordinates(const char* filename, double** coordinates, int rows, int cols) {
-    FILE* file;
-    if (fopen_s(&file, filename, "w") != 0) {
-        printf("Error creating output file: %s\n", filename);
-        return;
+double** FileHandler_loadCoordinatesTracked(const char* filename, int* rows, int* cols, FileLoad* load) {
+    return loadFile(filename, rows, cols, load, NULL);
+}
+
+double** FileHandler_loadCoordinates(const char* filename, int* rows, int* cols) {
+    return loadFile(filename, rows, cols, NULL, NULL);
+}
+
+double** FileHandler_loadCoordinatesHashed(const char* filename, int* rows, int* cols, uint64_t* contentHash) {
+    return loadFile(filename, rows, cols, NULL, contentHash);
+}
+
+FileLoad* FileHandler_startTask(void* (*task)(FileLoad* load, void* context), void* context) {
+    FileLoad* load = new FileLoad();
+    load->finished = 0;
+    load->bytesDone = 0;
+    load->totalBytes = 0;
+    load->cancelled = 0;
+    load->background = 0;
+    load->appliedBackground = 0;
+    load->started = std::chrono::steady_clock::now();
+    load->task = task;
+    load->context = context;
+    load->result = NULL;
+    load->thread = std::thread([load]() {
+        void* result = load->task(load, load->context);
+        std::lock_guard<std::mutex> lock(load->mutex);
+        load->result = result;
+        load->finished = 1;
+        load->done.notify_all();
+    });
+    return load;
+}
+
+void* FileHandler_finishTask(FileLoad* load) {
+    load->thread.join();
+    void* result = load->result;
+    delete load;
+    return result;
+}
+
+/** Arguments and outputs of FileHandler_startLoad */
+typedef struct {
+    char* filename;
+    int rows;
+    int cols;
+} PlainLoad;
+
+static void* plainLoadTask(FileLoad* load, void* context) {
+    PlainLoad* plain = (PlainLoad*)context;
+    return FileHandler_loadCoordinatesTracked(plain->filename, &plain->rows, &plain->cols, load);
+}
+
+FileLoad* FileHandler_startLoad(const char* filename) {
+    PlainLoad* plain = (PlainLoad*)malloc(sizeof(PlainLoad));
+    char* copy = (char*)malloc(strlen(filename) + 1);
+    if (!plain || !copy) {
+        free(plain);
+        free(copy);
+        return NULL;
+    }
+    strcpy(copy, filename);
+    plain->filename = copy;
+    plain->rows = 0;
+    plain->cols = 0;
+    return FileHandler_startTask(plainLoadTask, plain);
+}
+
+double** FileHandler_finishLoad(FileLoad* load, int* rows, int* cols) {
+    *rows = 0;
+    *cols = 0;
+    if (!load) {
+        return NULL;
+    }
+    PlainLoad* plain = (PlainLoad*)load->context;
+    double** data = (double**)FileHandler_finishTask(load);
+    if (data) {
+        *rows = plain->rows;
+        *cols = plain->cols;
+    }
+    free(plain->filename);
+    free(plain);
+    return data;
+}
+
+void FileHandler_getLoadStatus(FileLoad* load, FileLoadStatus* status) {
+    {
+        std::lock_guard<std::mutex> lock(load->mutex);
+        status->finished = load->finished;
+    }
+    status->bytesDone = load->bytesDone.load(std::memory_order_relaxed);
+    status->totalBytes = load->totalBytes.load(std::memory_order_relaxed);
+    status->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load->started).count();
+}
+
+int FileHandler_waitLoad(FileLoad* load, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(load->mutex);
+    return load->done.wait_for(lock, std::chrono::milliseconds(timeoutMs), [load]() { return load->finished != 0; });
+}
+
+void FileHandler_setLoadBackground(FileLoad* load, int background) {
+    load->background.store(background ? 1 : 0, std::memory_order_relaxed);
+}
+
+void FileHandler_cancelLoad(FileLoad* load) {
+    load->cancelled.store(1, std::memory_order_relaxed);
+}
+
+int FileHandler_saveCoordinates(const char* filename, double** coordinates, int rows, int cols) {
+    TRACE_SCOPE("FileHandler_saveCoordinates");
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Error creating output file: %s\n", filename);
+        return 0;
     }
     
     for (int i = 0; i < rows; i++) {
@@ -84,12 +430,16 @@ void FileHandler_saveCoordinates(const char* filename, double** coordinates, int
         fprintf(file, "\n");
     }
     
-    fclose(file);
+    int ok = !ferror(file);
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok;
 }
 
 int FileHandler_fileExists(const char* filename) {
-    FILE* file;
-    if (fopen_s(&file, filename, "r") == 0) {
+    FILE* file = fopen(filename, "r");
+    if (file) {
         fclose(file);
         return 1;
     }
@@ -104,3 +454,50 @@ void FileHandler_freeCoordinates(double** coordinates, int rows) {
         free(coordinates);
     }
 }
+
+void FileHandler_getAllocationStats(int rows, int cols, long long* allocations, long long* bytes) {
+    // One array of row pointers plus one block per row
+    *allocations = 1 + (long long)rows;
+    *bytes = (long long)rows * sizeof(double*) + (long long)rows * cols * sizeof(double);
+}
+
+int FileHandler_estimateShape(const char* filename, long long fileBytes, long long* rows, int* cols) {
+    *rows = 0;
+    *cols = 0;
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    char sample[ESTIMATE_SAMPLE_BYTES];
+    size_t sampled = fread(sample, 1, sizeof(sample), file);
+    fclose(file);
+
+    FileBinaryHeader header;
+    if (sampled >= sizeof(header) && memcmp(sample, FILE_BINARY_MAGIC, 4) == 0) {
+        memcpy(&header, sample, sizeof(header));
+        *rows = (long long)header.rows;
+        *cols = (int)header.cols;
+        return 1;
+    }
+
+    long long lines = 0;
+    int firstLine = 1;
+    *cols = sampled > 0 ? 1 : 0;
+    for (size_t i = 0; i < sampled; i++) {
+        if (sample[i] == '\n') {
+            lines++;
+            firstLine = 0;
+        } else if (sample[i] == ',' && firstLine) {
+            (*cols)++;
+        }
+    }
+    if ((long long)sampled >= fileBytes) {
+        // Whole file seen: count a last line without a newline too
+        *rows = lines + (sampled > 0 && sample[sampled - 1] != '\n');
+    } else if (lines > 0) {
+        *rows = (long long)((double)fileBytes * lines / sampled);
+    } else {
+        *rows = 1;  // One line longer than the sample
+    }
+    return 1;
+}
@@ -4,12 +4,52 @@
  * 
  * This module provides functionality for reading and writing coordinate data
  * from/to CSV files. It handles memory allocation and cleanup for 2D coordinate arrays.
+ *
+ * A file can also be loaded on a background thread through a FileLoad
+ * handle. The loader publishes how many bytes of the file it has processed
+ * and stops early when the load is cancelled, freeing whatever it had
+ * allocated.
  */
 
 #ifndef FILE_HANDLER_H
 #define FILE_HANDLER_H
 
 #include <stdio.h>
+#include <stdint.h>
+
+/** First four bytes of a binary coordinate file */
+#define FILE_BINARY_MAGIC "L6CB"
+/** Current binary format version */
+#define FILE_BINARY_VERSION 1
+
+/**
+ * @struct FileBinaryHeader
+ * @brief Header of a binary coordinate file
+ *
+ * The header is followed by rows * cols doubles in row-major order, in the
+ * byte order of the machine that wrote the file (little-endian in practice).
+ */
+typedef struct {
+    char magic[4];      ///< FILE_BINARY_MAGIC, not NUL-terminated
+    uint32_t version;   ///< FILE_BINARY_VERSION
+    uint32_t cols;
+    uint32_t reserved;  ///< Zero
+    uint64_t rows;
+} FileBinaryHeader;
+
+/** A load running on a background thread */
+typedef struct FileLoad FileLoad;
+
+/**
+ * @struct FileLoadStatus
+ * @brief Snapshot of a background load
+ */
+typedef struct {
+    long long bytesDone;   ///< File bytes processed so far
+    long long totalBytes;  ///< File size, 0 until the file has been opened
+    double seconds;        ///< Time since the load started
+    int finished;          ///< 1 once the loader has returned
+} FileLoadStatus;
 
 /**
  * @brief Reads coordinates from a CSV file
@@ -21,14 +61,145 @@
  */
 double** FileHandler_readCoordinates(const char* filename, int* rows, int* cols);
 
+/**
+ * @brief Reads coordinates from a binary coordinate file
+ * @param filename Path to the input file
+ * @param rows Output parameter for number of rows read
+ * @param cols Output parameter for number of columns read
+ * @return 2D array of coordinates, or NULL if the file cannot be opened or is not a valid binary file
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** FileHandler_readBinaryCoordinates(const char* filename, int* rows, int* cols);
+
+/**
+ * @brief Reads coordinates from a CSV or binary file, choosing the reader from the file's first bytes
+ *
+ * A CSV is read from its sidecar (see sidecarCache.h) when that is still
+ * current, and gets a new sidecar written in the background when it is not.
+ *
+ * @param filename Path to the input file
+ * @param rows Output parameter for number of rows read
+ * @param cols Output parameter for number of columns read
+ * @return 2D array of coordinates, or NULL if file cannot be read
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** FileHandler_loadCoordinates(const char* filename, int* rows, int* cols);
+
+/**
+ * @brief Reads coordinates like FileHandler_loadCoordinates and hashes the input as it goes
+ *
+ * The hash is the ContentHash of the bytes the coordinates were actually
+ * parsed from (or, for a sidecar, of the CSV it was checked against), so it
+ * always describes the returned data even if the file changes meanwhile.
+ *
+ * @param filename Path to the input file
+ * @param rows Output parameter for number of rows read
+ * @param cols Output parameter for number of columns read
+ * @param contentHash Output parameter for the content hash, set when the load succeeds
+ * @return 2D array of coordinates, or NULL if file cannot be read
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** FileHandler_loadCoordinatesHashed(const char* filename, int* rows, int* cols, uint64_t* contentHash);
+
+/**
+ * @brief Reads coordinates like FileHandler_loadCoordinates, reporting to a load handle
+ *
+ * A CSV is read twice (once to count rows, once to parse them), and each
+ * pass accounts for half of the file's bytes.
+ *
+ * @param filename Path to the input file
+ * @param rows Output parameter for number of rows read
+ * @param cols Output parameter for number of columns read
+ * @param load Handle to report progress to and check for cancellation (NULL for none)
+ * @return 2D array of coordinates, or NULL if the file cannot be read or the load was cancelled
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** FileHandler_loadCoordinatesTracked(const char* filename, int* rows, int* cols, FileLoad* load);
+
+/**
+ * @brief Starts FileHandler_loadCoordinates on a background thread
+ * @param filename Path to the input file
+ * @return Load handle; pass it to FileHandler_finishLoad exactly once
+ */
+FileLoad* FileHandler_startLoad(const char* filename);
+
+/**
+ * @brief Collects the result of FileHandler_startLoad, waiting for it if needed
+ * @param load Handle from FileHandler_startLoad, freed by this call
+ * @param rows Output parameter for number of rows read
+ * @param cols Output parameter for number of columns read
+ * @return 2D array of coordinates, or NULL if the file cannot be read or the load was cancelled
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** FileHandler_finishLoad(FileLoad* load, int* rows, int* cols);
+
+/**
+ * @brief Runs a loading task on a background thread
+ *
+ * The task reports progress by passing the handle on to
+ * FileHandler_loadCoordinatesTracked. This is how loads with a result other
+ * than a plain array (DatasetCache_startOpenView) get a handle.
+ *
+ * @param task Function to run; its return value is the task's result
+ * @param context Passed to task
+ * @return Load handle; pass it to FileHandler_finishTask exactly once
+ */
+FileLoad* FileHandler_startTask(void* (*task)(FileLoad* load, void* context), void* context);
+
+/**
+ * @brief Waits for a task and frees its handle
+ * @param load Handle from FileHandler_startTask
+ * @return What the task returned
+ */
+void* FileHandler_finishTask(FileLoad* load);
+
+/**
+ * @brief Reads the progress of a background load
+ * @param load Load to look at
+ * @param status Output parameter for the snapshot
+ */
+void FileHandler_getLoadStatus(FileLoad* load, FileLoadStatus* status);
+
+/**
+ * @brief Waits up to a given time for a background load to finish
+ * @param load Load to wait for
+ * @param timeoutMs Longest wait in milliseconds
+ * @return 1 if the loader has returned, 0 if it is still running
+ */
+int FileHandler_waitLoad(FileLoad* load, int timeoutMs);
+
+/**
+ * @brief Moves a background load to or from low scheduling priority
+ *
+ * The loader applies the change itself at its next progress report. Loads
+ * start at normal priority. Going back to normal priority may not be
+ * allowed for unprivileged processes on Linux; the load then carries on at
+ * low priority.
+ *
+ * @param load Load to change
+ * @param background 1 for low priority, 0 for normal priority
+ */
+void FileHandler_setLoadBackground(FileLoad* load, int background);
+
+/**
+ * @brief Asks a background load to stop
+ *
+ * The loader notices within a few thousand rows, frees what it allocated and
+ * returns NULL. The handle still has to be finished.
+ *
+ * @param load Load to cancel
+ */
+void FileHandler_cancelLoad(FileLoad* load);
+
 /**
  * @brief Saves coordinates to a CSV file
  * @param filename Path to the output file
  * @param coordinates 2D array of coordinates to save
  * @param rows Number of rows in the array
  * @param cols Number of columns in the array
+ * @return 1 if the whole file was written, 0 otherwise
  */
-void FileHandler_saveCoordinates(const char* filename, double** coordinates, int rows, int cols);
+int FileHandler_saveCoordinates(const char* filename, double** coordinates, int rows, int cols);
 
 /**
  * @brief Checks if a file exists
@@ -44,4 +215,28 @@ int FileHandler_fileExists(const char* filename);
  */
 void FileHandler_freeCoordinates(double** coordinates, int rows);
 
+/**
+ * @brief Reports the heap usage of an array returned by FileHandler_readCoordinates
+ * @param rows Number of rows in the array
+ * @param cols Number of columns in the array
+ * @param allocations Output parameter for the number of heap allocations
+ * @param bytes Output parameter for the number of bytes allocated
+ */
+void FileHandler_getAllocationStats(int rows, int cols, long long* allocations, long long* bytes);
+
+/**
+ * @brief Estimates the shape of a file without loading it
+ *
+ * Binary coordinate files report their exact shape. For CSV files the first
+ * few kilobytes are read: the first line gives the columns, and the line
+ * count is scaled by the file size, which is exact for small files.
+ *
+ * @param filename Path to the file
+ * @param fileBytes Size of the file
+ * @param rows Output parameter for the estimated rows
+ * @param cols Output parameter for the estimated columns
+ * @return 1 on success, 0 if the file cannot be read
+ */
+int FileHandler_estimateShape(const char* filename, long long fileBytes, long long* rows, int* cols);
+
 #endif // FILE_HANDLER_H
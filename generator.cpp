@@ -0,0 +1,100 @@
+/**
+ * @file generator.cpp
+ * @brief Command-line front end for the synthetic dataset generator
+ *
+ * Usage:
+ *   Lab06_generate --rows 1e6 [--cols 3] [--dist uniform] [--seed 1]
+ *                  [--format csv|bin] [--min -1000] [--max 1000]
+ *                  [--clusters 8] [--levels 5] [--threads 0] --out FILE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "datasetGenerator.h"
+
+static void printUsage(void) {
+    printf("Usage: Lab06_generate --rows N --out FILE [options]\n");
+    printf("  --rows N          Number of rows (1e9 style accepted)\n");
+    printf("  --cols N          Components per row (default 3)\n");
+    printf("  --dist NAME       uniform, clusters, sorted, reversed, duplicates, adversarial\n");
+    printf("  --seed N          Random seed (default 1); same seed, same file\n");
+    printf("  --format FORMAT   csv (default) or bin\n");
+    printf("  --min X, --max X  Component value range (default -1000 to 1000)\n");
+    printf("  --clusters N      Number of Gaussian clusters (default 8)\n");
+    printf("  --levels N        Distinct values for duplicates (default 5)\n");
+    printf("  --threads N       Worker threads (default: one per hardware thread)\n");
+}
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    DatasetGenerator_defaults(&config);
+    GeneratorFormat format = GEN_FORMAT_CSV;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printf("Missing value for %s\n", arg);
+            return 2;
+        }
+        const char* value = argv[++i];
+        int ok = 1;
+        if (strcmp(arg, "--rows") == 0) {
+            config.rows = (long long)strtod(value, NULL);
+            ok = config.rows >= 0;
+        } else if (strcmp(arg, "--cols") == 0) {
+            config.cols = atoi(value);
+            ok = config.cols > 0;
+        } else if (strcmp(arg, "--dist") == 0) {
+            int distribution = DatasetGenerator_parseDistribution(value);
+            config.distribution = (GeneratorDistribution)distribution;
+            ok = distribution >= 0;
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--format") == 0) {
+            format = strcmp(value, "bin") == 0 ? GEN_FORMAT_BINARY : GEN_FORMAT_CSV;
+            ok = format == GEN_FORMAT_BINARY || strcmp(value, "csv") == 0;
+        } else if (strcmp(arg, "--min") == 0) {
+            config.minValue = atof(value);
+        } else if (strcmp(arg, "--max") == 0) {
+            config.maxValue = atof(value);
+        } else if (strcmp(arg, "--clusters") == 0) {
+            config.clusters = atoi(value);
+            ok = config.clusters > 0;
+        } else if (strcmp(arg, "--levels") == 0) {
+            config.distinctValues = atoi(value);
+            ok = config.distinctValues > 1;
+        } else if (strcmp(arg, "--threads") == 0) {
+            config.threads = atoi(value);
+        } else if (strcmp(arg, "--out") == 0) {
+            output = value;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            printf("Invalid argument: %s\n", arg);
+            printUsage();
+            return 2;
+        }
+    }
+    if (!output) {
+        printUsage();
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!DatasetGenerator_writeFile(&config, output, format)) {
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Wrote %lld x %d %s rows to %s in %.2f s (%.3g rows/s)\n",
+           config.rows, config.cols, DatasetGenerator_distributionName(config.distribution),
+           output, seconds, seconds > 0 ? config.rows / seconds : 0.0);
+    return 0;
+}
@@ -11,20 +11,43 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
-#include <conio.h>
-#include <windows.h>
+#include <thread>
 #include "selectionMenu.h"
+#include "fileCatalog.h"
 #include "fileHandler.h"
+#include "spatialGrid.h"
+#include "sortEngine.h"
+#include "perfCounters.h"
+#include "trace.h"
+#include "commandLine.h"
+#include "batchProcessor.h"
+#include "datasetCache.h"
+#include "sidecarCache.h"
 
 // Menu configuration
 const char* MENU_TITLE = "Lab 6: Sorting Algorithm Visualizer";
 const char* MENU_ITEMS[] = {
     "Bubble Sort",
     "Optimised Sort",
+    "Multi-Key Sort",
+    "Range Query",
+    "Batch Sort",
     "Settings",
     "Exit"
 };
-const int NUM_MENU_ITEMS = 4;
+const int NUM_MENU_ITEMS = 7;
+
+/** File that every sort appends its statistics to, one JSON object per line */
+#define STATS_DUMP_FILE "lab06_stats.jsonl"
+
+/** Longest path of a chosen input file */
+#define FILE_PATH_LENGTH 4096
+
+/** Parsed-dataset cache budget when LAB06_CACHE_MB is not set */
+#define DATASET_CACHE_DEFAULT_MB 256
+
+/** Largest estimated dataset the picker loads ahead when LAB06_PREFETCH_MB is not set */
+#define PREFETCH_DEFAULT_MB 128
 
 /** Enum for accessing coordinate components */
 typedef enum {
@@ -32,25 +55,38 @@ typedef enum {
     COORD_Y
 } CoordinateAxis;
 
-/**
- * @struct SortStats
- * @brief Statistics collected during sorting operations
- */
-typedef struct {
-    int comparisons;  ///< Number of comparisons performed
-    int swaps;        ///< Number of swaps performed
-} SortStats;
-
 // Global menu instance
 SelectionMenu g_menu;
 
+// Parsed files, kept between menu actions so reselecting a file skips parsing
+DatasetCache* g_cache = NULL;
+
+// Whether the file picker also lists CSV files in subdirectories
+int g_searchSubfolders = 0;
+
+// Whether bubble and selection sorts are recorded and replayed afterwards
+int g_replaySorts = 0;
+
+// Size of the event ring a replayed sort is recorded into
+long long g_recordingBytes = 0;
+
+/** Speculative load of the file highlighted in the picker */
+typedef struct {
+    FileLoad* load;                  ///< Running or finished load, NULL if none
+    char path[FILE_PATH_LENGTH];
+    long long budgetBytes;           ///< Largest estimated dataset to load ahead, 0 = never
+} Prefetch;
+
+Prefetch g_prefetch = {};
+
 // Forward declarations
 void menuSettings(void);
 void displayMenu(void);
 void bubbleSort(void);
 void optimisedSort(void);
-SortStats sortCoordinates(double** coordinates, int n, int m);
-SortStats optimisedSortCoordinates(double** coordinates, int n, int m);
+void multiKeySort(void);
+void rangeQuery(void);
+void batchSort(void);
 double** read2DArray(const char* filename, int* n, int* m);
 int saveCoordinatesToFile(const char* filename, double** coordinates, int n, int m);
 
@@ -61,17 +97,23 @@ int saveCoordinatesToFile(const char* filename, double** coordinates, int n, int
  * - Classic (numbered list)
  * - Cursor (interactive arrow selection)
  * - Condensed (compact display)
+ *
+ * It also sets the dataset cache budget, whether the file picker searches
+ * subfolders and whether sorts are replayed.
  */
 void menuSettings(void) {
     const char* settingsItems[] = {
         "Classic",
         "Cursor",
-        "Condensed"
+        "Condensed",
+        "Cache Budget",
+        g_searchSubfolders ? "Search Subfolders (on)" : "Search Subfolders (off)",
+        g_replaySorts ? "Sort Replay (on)" : "Sort Replay (off)"
     };
     
     // Use current menu style for settings
     MenuType currentType = SelectionMenu_getMenuType(&g_menu);
-    int choice = SelectionMenu_showMenu(&g_menu, "Menu Settings", settingsItems, 3);
+    int choice = SelectionMenu_showMenu(&g_menu, "Menu Settings", settingsItems, 6);
     
     // Apply selected style
     switch (choice) {
@@ -87,89 +129,399 @@ void menuSettings(void) {
             SelectionMenu_setMenuType(&g_menu, MENU_CONDENSED);
             SelectionMenu_printColored(COLOR_RED, "\nChanged to Condensed Menu\n");
             break;
+        case 4: {
+            DatasetCacheStats cacheStats;
+            DatasetCache_getStats(g_cache, &cacheStats);
+            printf("\nCached: %d files, %.1f MB (%lld hits, %lld misses, %lld evictions)\n",
+                   cacheStats.entries, cacheStats.bytes / (1024.0 * 1024.0),
+                   cacheStats.hits, cacheStats.misses, cacheStats.evictions);
+            printf("Cache budget in MB (0 = unlimited): ");
+            char input[32];
+            long long megabytes;
+            SelectionMenu_flush();
+            if (fgets(input, sizeof(input), stdin) && sscanf(input, "%lld", &megabytes) == 1 && megabytes >= 0) {
+                DatasetCache_setBudget(g_cache, megabytes * 1024 * 1024);
+                SelectionMenu_printColored(COLOR_RED, "\nCache budget set to %lld MB\n", megabytes);
+            } else {
+                SelectionMenu_printColored(COLOR_RED, "\nInvalid budget!\n");
+            }
+            break;
+        }
+        case 5:
+            g_searchSubfolders = !g_searchSubfolders;
+            SelectionMenu_printColored(COLOR_RED, "\nSubfolder search %s\n", g_searchSubfolders ? "on" : "off");
+            break;
+        case 6:
+            g_replaySorts = !g_replaySorts;
+            SelectionMenu_printColored(COLOR_RED, "\nSort replay %s\n", g_replaySorts ? "on" : "off");
+            break;
     }
     
     SelectionMenu_waitForKey(NULL);
 }
 
 /**
- * @brief Calculates the sum of values in a row
- * 
- * Used as the comparison metric for sorting coordinates.
- * 
- * @param row Array of values to sum
- * @param m Number of elements in the row
- * @return Sum of all elements
+ * @brief Drops the picker's speculative load
+ *
+ * A load that already finished stays in the dataset cache, so choosing the
+ * file later still skips parsing it.
  */
-double calculateRowSum(double* row, int m) {
-    double sum = 0;
-    for (int j = 0; j < m; j++) {
-        sum += row[j];
+static void cancelPrefetch(void) {
+    if (g_prefetch.load) {
+        DatasetView view;
+        FileHandler_cancelLoad(g_prefetch.load);
+        if (DatasetCache_finishOpenView(g_prefetch.load, &view, NULL)) {
+            DatasetCache_closeView(g_cache, &view);
+        }
+        g_prefetch.load = NULL;
     }
-    return sum;
 }
 
 /**
- * @brief Sorts coordinates using bubble sort algorithm
- * 
- * Sorts the coordinates based on the sum of their components.
- * Tracks and returns statistics about the sorting operation.
- * 
- * @param coordinates 2D array of coordinates to sort
- * @param n Number of coordinates
- * @param m Number of components per coordinate
- * @return Statistics about the sorting operation
+ * @brief Starts loading the file highlighted in the picker at low priority
+ *
+ * Files estimated to need more memory than the prefetch budget (or the
+ * dataset cache budget) once loaded are left alone. The estimate is the file
+ * size plus a row pointer and allocation header per row.
+ *
+ * @param context The picker's FileCatalog
+ * @param index Highlighted entry, or -1 for none
  */
-SortStats sortCoordinates(double** coordinates, int n, int m) {
-    SortStats stats = {0, 0};  // Initialize counters
-    
-    // Bubble sort based on row sums
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = 0; j < n - i - 1; j++) {
-            double sum1 = calculateRowSum(coordinates[j], m);
-            double sum2 = calculateRowSum(coordinates[j + 1], m);
-            
-            stats.comparisons++;  // Count each comparison
-            if (sum1 > sum2) {
-                // Swap rows
-                double* temp = coordinates[j];
-                coordinates[j] = coordinates[j + 1];
-                coordinates[j + 1] = temp;
-                stats.swaps++;  // Count each swap
+static void prefetchHighlighted(void* context, int index) {
+    FileCatalog* catalog = (FileCatalog*)context;
+    if (index < 0) {
+        cancelPrefetch();
+        return;
+    }
+    const char* name = FileCatalog_name(catalog, index);
+    if (g_prefetch.load && strcmp(g_prefetch.path, name) == 0) {
+        return;  // Same file, e.g. after the scan sorted the catalog
+    }
+    cancelPrefetch();
+
+    DatasetCacheStats cacheStats;
+    DatasetCache_getStats(g_cache, &cacheStats);
+    long long estimate = catalog->entries[index].bytes +
+                         FileCatalog_estimateRows(catalog, index) * (long long)(sizeof(double*) + 16);
+    if (estimate > g_prefetch.budgetBytes ||
+        (cacheStats.budgetBytes > 0 && estimate > cacheStats.budgetBytes) ||
+        strlen(name) >= sizeof(g_prefetch.path)) {
+        return;
+    }
+    strcpy(g_prefetch.path, name);
+    g_prefetch.load = DatasetCache_startOpenView(g_cache, g_prefetch.path);
+    FileHandler_setLoadBackground(g_prefetch.load, 1);
+}
+
+/**
+ * @brief Lets the user pick a CSV file in the current directory
+ *
+ * With subfolder search on, the picker opens straight away and fills in
+ * while the directory tree is scanned in the background. The highlighted
+ * file starts loading while the user looks; loadDataset picks that load up
+ * if the file is chosen.
+ *
+ * @param path Output buffer for the chosen path
+ * @param size Size of path
+ * @return 1 if a file was chosen, 0 if there are none or the user backed out
+ */
+static int chooseCsvFile(char* path, size_t size) {
+    FileCatalog* catalog = g_searchSubfolders ? FileCatalog_startScan(".", "csv", 1) : FileCatalog_scan(".", "csv");
+    if (!catalog || (catalog->count == 0 && !catalog->scan)) {
+        SelectionMenu_printColored(COLOR_RED, "\nNo CSV files found!\n");
+        SelectionMenu_waitForKey(NULL);
+        FileCatalog_free(catalog);
+        return 0;
+    }
+    int choice = SelectionMenu_pickFile("Select CSV File", catalog, prefetchHighlighted, catalog);
+    if (choice >= 0) {
+        snprintf(path, size, "%s", FileCatalog_name(catalog, choice));
+    }
+    if (choice < 0 || strcmp(path, g_prefetch.path) != 0) {
+        cancelPrefetch();
+    }
+    FileCatalog_free(catalog);
+    return choice >= 0;
+}
+
+/**
+ * @struct CoordinateList
+ * @brief Coordinates shown in the row viewer
+ */
+typedef struct {
+    double** rows;
+    int m;
+    long long n;
+    int withSums;     ///< Show each row's sum after its components
+    int sortedBySum;  ///< Rows ascend by sum, so finding a sum can bisect
+} CoordinateList;
+
+/**
+ * @brief Formats one coordinate for the row viewer
+ *
+ * Uses the user's preferred style:
+ * [   x.xx ,    y.yy ]   sum:    z.zz
+ *
+ * @return Offset of the sum, shown in cyan, or -1 without sums
+ */
+static int formatCoordinate(void* context, long long index, char* buffer, int size) {
+    const CoordinateList* list = (const CoordinateList*)context;
+    const double* row = list->rows[index];
+    int length = snprintf(buffer, size, "[");
+    for (int j = 0; j < list->m && length < size; j++) {
+        length += snprintf(buffer + length, size - length, "%8.2f%s", row[j], j < list->m - 1 ? " ," : " ]");
+    }
+    if (!list->withSums || length >= size) {
+        return -1;
+    }
+    snprintf(buffer + length, size - length, "   sum: %8.2f", calculateRowSum(list->rows[index], list->m));
+    return length;
+}
+
+/**
+ * @brief Finds the row whose sum is closest to a typed value
+ * @return Row index, or -1 if the query is not a number
+ */
+static long long findCoordinateBySum(void* context, const char* query) {
+    const CoordinateList* list = (const CoordinateList*)context;
+    char* end;
+    double value = strtod(query, &end);
+    if (end == query || *end != '\0' || isnan(value)) {
+        return -1;
+    }
+    long long n = list->n;
+    if (n == 0) {
+        return -1;
+    }
+    long long best = 0;
+    if (list->sortedBySum) {
+        // First row with a sum >= value, or the one before it if that is closer
+        long long low = 0, high = n;
+        while (low < high) {
+            long long mid = low + (high - low) / 2;
+            if (calculateRowSum(list->rows[mid], list->m) < value) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        best = low < n ? low : n - 1;
+        if (low > 0 && (low == n ||
+            fabs(calculateRowSum(list->rows[low - 1], list->m) - value) <
+            fabs(calculateRowSum(list->rows[low], list->m) - value))) {
+            best = low - 1;
+        }
+    } else {
+        double bestDistance = INFINITY;
+        for (long long i = 0; i < n; i++) {
+            double distance = fabs(calculateRowSum(list->rows[i], list->m) - value);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
             }
         }
     }
-    return stats;
+    return best;
 }
 
 /**
- * @brief Displays a single coordinate with proper formatting
- * 
- * @param row Array containing the coordinate components
+ * @brief Shows coordinates in the paged row viewer
+ *
+ * Only the rows on screen are formatted, so this returns as quickly for a
+ * billion rows as for ten.
+ *
+ * @param title Viewer title
+ * @param rows Coordinates to show
+ * @param n Number of rows
  * @param m Number of components
+ * @param withSums Show each row's sum
+ * @param sortedBySum Rows ascend by sum
+ */
+void viewCoordinates(const char* title, double** rows, int n, int m, int withSums, int sortedBySum) {
+    CoordinateList list = {rows, m, n, withSums, sortedBySum};
+    RowViewer viewer;
+    viewer.title = title;
+    viewer.nRows = n;
+    viewer.formatRow = formatCoordinate;
+    viewer.findRow = findCoordinateBySum;
+    viewer.findLabel = "sum";
+    viewer.accentColor = COLOR_CYAN;
+    viewer.context = &list;
+    SelectionMenu_viewRows(&viewer);
+}
+
+/**
+ * @brief Displays the statistics of a sort
+ *
+ * Load, key and sort phases are shown; the save phase is only known after the
+ * user chooses to save and is recorded in STATS_DUMP_FILE.
+ *
+ * @param stats Statistics collected so far
  */
-void displayCoordinate(double* row, int m) {
-    printf("[");
-    for (int j = 0; j < m; j++) {
-        printf("%8.2f%s", row[j], j < m-1 ? " ," : " ]\n");
+void displaySortStats(const SortStats* stats) {
+    printf("\nSort Statistics:\n");
+#if LAB06_SORT_STATS == 0
+    printf("(sort statistics are disabled in this build)\n");
+#else
+    printf("Comparisons:  %lld\n", stats->comparisons);
+    printf("Swaps:        %lld\n", stats->swaps);
+    printf("Bytes moved:  %lld\n", stats->bytesMoved);
+#endif
+    printf("Allocations:  %lld (%lld bytes)\n", stats->allocations, stats->allocatedBytes);
+    printf("Peak memory:  %.1f MB\n", stats->peakMemoryBytes / (1024.0 * 1024.0));
+    printf("\n%-6s %12s %12s\n", "Phase", "Wall (ms)", "CPU (ms)");
+    for (int p = PHASE_LOAD; p < PHASE_SAVE; p++) {
+        printf("%-6s %12.3f %12.3f\n", SortStats_phaseName((SortPhase)p),
+               stats->phases[p].wallMs, stats->phases[p].cpuMs);
+    }
+
+    // Hardware counters, only when enabled with LAB06_PERF=1
+    if (PerfCounters_enabled()) {
+        printf("\n%-6s", "Phase");
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            printf(" %14s", PerfCounters_name((PerfCounter)c));
+        }
+        printf("\n");
+        for (int p = PHASE_LOAD; p < PHASE_SAVE; p++) {
+            printf("%-6s", SortStats_phaseName((SortPhase)p));
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+                long long value = stats->phases[p].counters[c];
+                if (value < 0) printf(" %14s", "n/a");
+                else printf(" %14lld", value);
+            }
+            printf("\n");
+        }
     }
 }
 
 /**
- * @brief Displays a coordinate with its sum
- * 
- * Formats the coordinate according to the user's preferred style:
- * [   x.xx ,    y.yy ]   sum:    z.zz
- * 
- * @param row Array containing the coordinate components
- * @param m Number of components
+ * @brief Loads a file through the dataset cache and records the load phase
+ *
+ * A file that is already cached costs no parsing and no allocations, so the
+ * load phase then only measures the cache lookup. A load the picker started
+ * ahead of time is taken over. Longer loads show their progress and can be
+ * cancelled with Escape. Failures and cancellations are
+ * reported to the user here.
+ *
+ * @param filename File to load
+ * @param view Output parameter for a view of the dataset
+ * @param stats Statistics to record the load into
+ * @return 1 on success, 0 if the file cannot be read or loading was cancelled
+ */
+int loadDataset(const char* filename, DatasetView* view, SortStats* stats) {
+    PhaseTimer timer;
+    int hit = 0;
+    PhaseTimer_start(&timer);
+    FileLoad* load;
+    if (g_prefetch.load && strcmp(g_prefetch.path, filename) == 0) {
+        // The picker already started this one; let it run at full speed
+        load = g_prefetch.load;
+        g_prefetch.load = NULL;
+        FileHandler_setLoadBackground(load, 0);
+    } else {
+        cancelPrefetch();
+        load = DatasetCache_startOpenView(g_cache, filename);
+    }
+    int finished = SelectionMenu_waitForLoad(filename, load);
+    int loaded = DatasetCache_finishOpenView(load, view, &hit);
+    PhaseTimer_stop(&timer, stats, PHASE_LOAD);
+    if (!loaded) {
+        SelectionMenu_printColored(COLOR_RED, finished ? "\nFailed to read coordinates!\n" : "\nLoading cancelled\n");
+        SelectionMenu_waitForKey(NULL);
+        return 0;
+    }
+    if (!hit) {
+        FileHandler_getAllocationStats(view->n, view->m, &stats->allocations, &stats->allocatedBytes);
+    }
+    return 1;
+}
+
+/**
+ * @brief Gets row pointers that a sort may reorder without touching the cached order
+ *
+ * @param view View from loadDataset
+ * @param stats Statistics to record the pointer array copy into
+ * @return Reorderable row pointers, or NULL on allocation failure
+ */
+double** sortableRows(DatasetView* view, SortStats* stats) {
+    double** rows = DatasetView_mutableRows(view);
+    if (rows) {
+        stats->allocations++;
+        stats->allocatedBytes += (long long)view->n * sizeof(double*);
+    }
+    return rows;
+}
+
+/**
+ * @brief Creates the recording for a sort that is to be replayed
+ * @return Empty recording, or NULL if replays are off or memory is short
+ */
+static SortRecording* createRecording(void) {
+    if (!g_replaySorts) {
+        return NULL;
+    }
+    SortRecording* recording = SortRecording_create((size_t)g_recordingBytes);
+    if (!recording) {
+        SelectionMenu_printColored(COLOR_RED, "\nNot enough memory to record the sort; it will not be replayed\n");
+    }
+    return recording;
+}
+
+/**
+ * @brief Replays a recorded sort, then frees the recording
+ *
+ * The bars show the key the rows were sorted by: the row sum, or the first
+ * of several keys (negated when it is descending, so bars still rise).
+ *
+ * @param title Name of the sort
+ * @param recording Events of the sort
+ * @param coordinates Rows in sorted order
+ * @param n Number of rows
+ * @param m Number of components per row
+ * @param key First sort key, or NULL for the row sum
  */
-void displayCoordinateWithSum(double* row, int m) {
-    printf("[");
-    for (int j = 0; j < m; j++) {
-        printf("%8.2f%s", row[j], j < m-1 ? " ," : " ]");
+static void replayRecording(const char* title, SortRecording* recording, double** coordinates, int n, int m,
+                            const SortKey* key) {
+    double* values = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (values) {
+        for (int i = 0; i < n; i++) {
+            double value = !key || key->type == SORT_KEY_SUM ? calculateRowSum(coordinates[i], m)
+                                                              : coordinates[i][key->column];
+            values[i] = key && key->descending ? -value : value;
+        }
+        SelectionMenu_replaySort(title, recording, values);
+        free(values);
+    } else {
+        SelectionMenu_printColored(COLOR_RED, "\nOut of memory!\n");
+        SelectionMenu_waitForKey(NULL);
     }
-    SelectionMenu_printColored(COLOR_CYAN, "   sum: %8.2f\n", calculateRowSum(row, m));
+    SortRecording_free(recording);
+}
+
+/**
+ * @brief Runs a sort on a worker thread while the progress screen is up
+ *
+ * Escape on the progress screen cancels the sort, which puts the rows back
+ * in their original order; the recording is then freed and a note printed.
+ *
+ * @param title Name of the sort
+ * @param recording Recording the sort writes to, or NULL
+ * @param sortStats Receives the statistics of the sort
+ * @param sort Callable taking the SortProgress* and returning SortStats
+ * @return 1 if the sort completed, 0 if it was cancelled
+ */
+template <typename Sort>
+static int runWatchedSort(const char* title, SortRecording* recording, SortStats* sortStats, Sort sort) {
+    SortProgress progress = {};
+    std::thread worker([&] { *sortStats = sort(&progress); });
+    int completed = SelectionMenu_waitForSort(title, &progress);
+    worker.join();
+    if (!completed) {
+        SortRecording_free(recording);
+        SelectionMenu_clearScreen();
+        SelectionMenu_printColored(COLOR_YELLOW, "\n%s cancelled; the rows keep their original order\n", title);
+    }
+    return completed;
 }
 
 /**
@@ -183,73 +535,61 @@ void displayCoordinateWithSum(double* row, int m) {
  * 5. Save the sorted coordinates
  */
 void bubbleSort(void) {
-    char** files = NULL;
-    const char** menuItems = NULL;
-    int fileCount = 0;
-    
-    // Find CSV files
-    files = SelectionMenu_findFiles(&g_menu, ".", "csv", &fileCount, MAX_FILES);
-    if (!files || fileCount == 0) {
-        SelectionMenu_printColored(COLOR_RED, "\nNo CSV files found!\n");
-        SelectionMenu_waitForKey(NULL);
+    // Let user select a file
+    char path[FILE_PATH_LENGTH];
+    if (!chooseCsvFile(path, sizeof(path))) {
         return;
     }
     
-    // Create menu items from filenames
-    menuItems = SelectionMenu_createMenuItems(&g_menu, files, fileCount, MAX_PATH_LENGTH);
-    if (!menuItems) {
-        SelectionMenu_freeFileList(files, fileCount);
+    // Read coordinates from file, or reuse them if they are still cached
+    SortStats stats = {};
+    PhaseTimer timer;
+    DatasetView view;
+    if (!loadDataset(path, &view, &stats)) {
         return;
     }
+    int n = view.n, m = view.m;
     
-    // Let user select a file
-    int choice = SelectionMenu_showMenu(&g_menu, "Select CSV File", menuItems, fileCount);
-    if (choice <= 0) {
-        SelectionMenu_freeMenuItems(menuItems, fileCount);
-        SelectionMenu_freeFileList(files, fileCount);
-        return;
-    }
+    // Display original coordinates; leaving the viewer starts the sort
+    viewCoordinates("Original coordinates (Enter starts the sort)", view.rows, n, m, 0, 0);
     
-    // Read coordinates from file
-    int n = 0, m = 0;
-    double** coordinates = FileHandler_readCoordinates(files[choice-1], &n, &m);
+    // Sort a private copy of the row order; the cached order stays as in the file
+    double** coordinates = sortableRows(&view, &stats);
     if (!coordinates) {
-        SelectionMenu_printColored(COLOR_RED, "\nFailed to read coordinates!\n");
-        SelectionMenu_freeMenuItems(menuItems, fileCount);
-        SelectionMenu_freeFileList(files, fileCount);
+        SelectionMenu_printColored(COLOR_RED, "\nOut of memory!\n");
+        DatasetCache_closeView(g_cache, &view);
         SelectionMenu_waitForKey(NULL);
         return;
     }
-    
-    // Display original coordinates
-    SelectionMenu_clearScreen();
-    printf("\nOriginal coordinates:\n\n");
-    for (int i = 0; i < n; i++) {
-        displayCoordinate(coordinates[i], m);
+    SortRecording* recording = createRecording();
+    SortStats sortStats;
+    if (!runWatchedSort("Bubble Sort", recording, &sortStats, [&](SortProgress* progress) {
+            return sortCoordinatesTracked(coordinates, n, m, progress, recording);
+        })) {
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
     }
-    SelectionMenu_waitForKey("\nPress any key to start sorting...");
-    
-    // Sort coordinates and get statistics
-    SortStats stats = sortCoordinates(coordinates, n, m);
-    
-    // Display sorted coordinates with sums
-    SelectionMenu_clearScreen();
-    printf("\nSorted coordinates:\n\n");
-    for (int i = 0; i < n; i++) {
-        displayCoordinateWithSum(coordinates[i], m);
+    SortStats_add(&stats, &sortStats);
+    SortStats_capturePeakMemory(&stats);
+    if (recording) {
+        replayRecording("Bubble Sort", recording, coordinates, n, m, NULL);
     }
     
-    // Display statistics
-    printf("\nSort Statistics:\n");
-    printf("Comparisons: %d\n", stats.comparisons);
-    printf("Swaps: %d\n", stats.swaps);
+    // Display sorted coordinates with sums, then the statistics
+    viewCoordinates("Sorted coordinates", coordinates, n, m, 1, 1);
+    SelectionMenu_clearScreen();
+    displaySortStats(&stats);
     
     // Save sorted coordinates
     char response = SelectionMenu_askYesNo("\nSave sorted coordinates? ");
     if (response == 'y') {
         char* outputFile = SelectionMenu_getOutputFilename(&g_menu, "sorted.csv");
         if (outputFile) {
-            if (saveCoordinatesToFile(outputFile, coordinates, n, m)) {
+            PhaseTimer_start(&timer);
+            int saved = saveCoordinatesToFile(outputFile, coordinates, n, m);
+            PhaseTimer_stop(&timer, &stats, PHASE_SAVE);
+            if (saved) {
                 SelectionMenu_printColored(COLOR_GREEN, "\nCoordinates saved to %s\n", outputFile);
             } else {
                 SelectionMenu_printColored(COLOR_RED, "\nFailed to save coordinates!\n");
@@ -258,160 +598,205 @@ void bubbleSort(void) {
         }
     }
     
+    // Record statistics for regression tracking
+    SortStats_appendJson(STATS_DUMP_FILE, &stats, "bubble", path, n, m);
+    
     // Cleanup
-    FileHandler_freeCoordinates(coordinates, n);
-    SelectionMenu_freeMenuItems(menuItems, fileCount);
-    SelectionMenu_freeFileList(files, fileCount);
+    DatasetCache_closeView(g_cache, &view);
     SelectionMenu_waitForKey(NULL);
 }
 
 /**
- * @brief Optimized sorting algorithm for coordinates
- * 
- * Implements an optimized version of bubble sort that:
- * 1. Pre-calculates row sums to avoid redundant calculations
- * 2. Uses early termination when no swaps are needed
- * 3. Reduces the search range after each pass
+ * @brief Handles the optimized sort visualization option
  * 
- * @param coordinates 2D array of coordinates to sort
- * @param n Number of coordinates
- * @param m Number of components per coordinate
- * @return Statistics about the sorting operation
+ * Allows the user to:
+ * 1. Select a CSV file
+ * 2. View the original coordinates
+ * 3. Sort the coordinates using optimized sort
+ * 4. View sorting statistics
+ * 5. Save the sorted coordinates
  */
-SortStats optimisedSortCoordinates(double** coordinates, int n, int m) {
-    SortStats stats = {0, 0};
+void optimisedSort(void) {
+    // Let user select a file
+    char path[FILE_PATH_LENGTH];
+    if (!chooseCsvFile(path, sizeof(path))) {
+        return;
+    }
     
-    // Create temporary array to store coordinates and their sums
-    typedef struct {
-        double* coords;
-        double sum;
-        int originalIndex;
-    } CoordInfo;
+    // Read coordinates from file, or reuse them if they are still cached
+    SortStats stats = {};
+    PhaseTimer timer;
+    DatasetView view;
+    if (!loadDataset(path, &view, &stats)) {
+        return;
+    }
+    int n = view.n, m = view.m;
     
-    CoordInfo* tempArray = (CoordInfo*)malloc(n * sizeof(CoordInfo));
+    // Display original coordinates; leaving the viewer starts the sort
+    viewCoordinates("Original coordinates (Enter starts the sort)", view.rows, n, m, 0, 0);
     
-    // Calculate sums and store original indices
-    for (int i = 0; i < n; i++) {
-        tempArray[i].coords = coordinates[i];
-        tempArray[i].sum = calculateRowSum(coordinates[i], m);
-        tempArray[i].originalIndex = i;
+    // Sort a private copy of the row order; the cached order stays as in the file
+    double** coordinates = sortableRows(&view, &stats);
+    if (!coordinates) {
+        SelectionMenu_printColored(COLOR_RED, "\nOut of memory!\n");
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+    SortRecording* recording = createRecording();
+    SortStats sortStats;
+    if (!runWatchedSort("Optimised Sort", recording, &sortStats, [&](SortProgress* progress) {
+            return optimisedSortCoordinatesTracked(coordinates, n, m, progress, recording);
+        })) {
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
     }
+    SortStats_add(&stats, &sortStats);
+    SortStats_capturePeakMemory(&stats);
+    if (recording) {
+        replayRecording("Optimised Sort", recording, coordinates, n, m, NULL);
+    }
+    
+    // Display sorted coordinates with sums, then the statistics
+    viewCoordinates("Sorted coordinates", coordinates, n, m, 1, 1);
+    SelectionMenu_clearScreen();
+    displaySortStats(&stats);
     
-    // Sort using selection sort approach to minimize swaps
-    for (int i = 0; i < n - 1; i++) {
-        int minIdx = i;
-        for (int j = i + 1; j < n; j++) {
-            stats.comparisons++;
-            if (tempArray[j].sum < tempArray[minIdx].sum) {
-                minIdx = j;
+    // Save sorted coordinates
+    char response = SelectionMenu_askYesNo("\nSave sorted coordinates? ");
+    if (response == 'y') {
+        char* outputFile = SelectionMenu_getOutputFilename(&g_menu, "sorted.csv");
+        if (outputFile) {
+            PhaseTimer_start(&timer);
+            int saved = saveCoordinatesToFile(outputFile, coordinates, n, m);
+            PhaseTimer_stop(&timer, &stats, PHASE_SAVE);
+            if (saved) {
+                SelectionMenu_printColored(COLOR_GREEN, "\nCoordinates saved to %s\n", outputFile);
+            } else {
+                SelectionMenu_printColored(COLOR_RED, "\nFailed to save coordinates!\n");
             }
-        }
-        
-        if (minIdx != i) {
-            // Swap in temporary array
-            CoordInfo temp = tempArray[i];
-            tempArray[i] = tempArray[minIdx];
-            tempArray[minIdx] = temp;
-            stats.swaps++;
+            free(outputFile);
         }
     }
     
-    // Copy back to original array in sorted order
-    double** tempCoords = (double**)malloc(n * sizeof(double*));
-    for (int i = 0; i < n; i++) {
-        tempCoords[i] = tempArray[i].coords;
-    }
-    
-    // Copy pointers back to original array
-    for (int i = 0; i < n; i++) {
-        coordinates[i] = tempCoords[i];
-    }
+    // Record statistics for regression tracking
+    SortStats_appendJson(STATS_DUMP_FILE, &stats, "optimised", path, n, m);
     
     // Cleanup
-    free(tempCoords);
-    free(tempArray);
-    
-    return stats;
+    DatasetCache_closeView(g_cache, &view);
+    SelectionMenu_waitForKey(NULL);
 }
 
 /**
- * @brief Handles the optimized sort visualization option
- * 
+ * @brief Handles the multi-key sort option
+ *
  * Allows the user to:
  * 1. Select a CSV file
- * 2. View the original coordinates
- * 3. Sort the coordinates using optimized sort
- * 4. View sorting statistics
+ * 2. Enter a key list such as "sum,x,y" (a leading '-' sorts descending)
+ * 3. Pick the sort engine
+ * 4. View the original and sorted coordinates with sorting statistics
  * 5. Save the sorted coordinates
+ *
+ * Ties on every key keep their file order, so all engines give the same result.
  */
-void optimisedSort(void) {
-    char** files = NULL;
-    const char** menuItems = NULL;
-    int fileCount = 0;
-    
-    // Find CSV files
-    files = SelectionMenu_findFiles(&g_menu, ".", "csv", &fileCount, MAX_FILES);
-    if (!files || fileCount == 0) {
-        SelectionMenu_printColored(COLOR_RED, "\nNo CSV files found!\n");
-        SelectionMenu_waitForKey(NULL);
+void multiKeySort(void) {
+    // Let user select a file
+    char path[FILE_PATH_LENGTH];
+    if (!chooseCsvFile(path, sizeof(path))) {
         return;
     }
-    
-    // Create menu items from filenames
-    menuItems = SelectionMenu_createMenuItems(&g_menu, files, fileCount, MAX_PATH_LENGTH);
-    if (!menuItems) {
-        SelectionMenu_freeFileList(files, fileCount);
+
+    // Read coordinates from file, or reuse them if they are still cached
+    SortStats stats = {};
+    PhaseTimer timer;
+    DatasetView view;
+    if (!loadDataset(path, &view, &stats)) {
         return;
     }
-    
-    // Let user select a file
-    int choice = SelectionMenu_showMenu(&g_menu, "Select CSV File", menuItems, fileCount);
-    if (choice <= 0) {
-        SelectionMenu_freeMenuItems(menuItems, fileCount);
-        SelectionMenu_freeFileList(files, fileCount);
+    int n = view.n, m = view.m;
+
+    // Ask for the key list
+    SelectionMenu_clearScreen();
+    printf("\nKeys: sum, x, y, z or c<N> for component N; prefix '-' for descending\n");
+    printf("\nSort keys (e.g. sum,x,y): ");
+    char input[128];
+    SortKey keys[MAX_SORT_KEYS];
+    int nKeys = 0;
+    SelectionMenu_flush();
+    if (fgets(input, sizeof(input), stdin)) {
+        input[strcspn(input, "\n")] = 0;
+        nKeys = SortKeys_parse(input, keys, MAX_SORT_KEYS);
+    }
+    if (!SortKeys_isValid(keys, nKeys, m)) {
+        SelectionMenu_printColored(COLOR_RED, "\nInvalid sort keys!\n");
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
         return;
     }
-    
-    // Read coordinates from file
-    int n = 0, m = 0;
-    double** coordinates = FileHandler_readCoordinates(files[choice-1], &n, &m);
+
+    // Let user select the engine
+    const char* engineItems[] = {
+        "Bubble Sort",
+        "Selection Sort",
+        "Radix Sort"
+    };
+    int engineChoice = SelectionMenu_showMenu(&g_menu, "Select Sort Engine", engineItems, 3);
+    if (engineChoice <= 0) {
+        DatasetCache_closeView(g_cache, &view);
+        return;
+    }
+
+    // Display original coordinates; leaving the viewer starts the sort
+    viewCoordinates("Original coordinates (Enter starts the sort)", view.rows, n, m, 0, 0);
+
+    char label[160];
+    snprintf(label, sizeof(label), "%s by %s", engineItems[engineChoice - 1], input);
+
+    // Sort a private copy of the row order; the cached order stays as in the file
+    double** coordinates = sortableRows(&view, &stats);
     if (!coordinates) {
-        SelectionMenu_printColored(COLOR_RED, "\nFailed to read coordinates!\n");
-        SelectionMenu_freeMenuItems(menuItems, fileCount);
-        SelectionMenu_freeFileList(files, fileCount);
+        SelectionMenu_printColored(COLOR_RED, "\nOut of memory!\n");
+        DatasetCache_closeView(g_cache, &view);
         SelectionMenu_waitForKey(NULL);
         return;
     }
-    
-    // Display original coordinates
-    SelectionMenu_clearScreen();
-    printf("\nOriginal coordinates:\n\n");
-    for (int i = 0; i < n; i++) {
-        displayCoordinate(coordinates[i], m);
+    // The radix engine neither compares nor swaps positions, so there is nothing to replay
+    SortEngine engine = (SortEngine)(engineChoice - 1);
+    SortRecording* recording = engine != SORT_ENGINE_RADIX ? createRecording() : NULL;
+    SortStats sortStats;
+    if (!runWatchedSort(label, recording, &sortStats, [&](SortProgress* progress) {
+            return sortCoordinatesByKeysTracked(coordinates, n, m, keys, nKeys, engine, progress, recording);
+        })) {
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
     }
-    SelectionMenu_waitForKey("\nPress any key to start sorting...");
-    
-    // Sort coordinates and get statistics
-    SortStats stats = optimisedSortCoordinates(coordinates, n, m);
-    
-    // Display sorted coordinates with sums
-    SelectionMenu_clearScreen();
-    printf("\nSorted coordinates:\n\n");
-    for (int i = 0; i < n; i++) {
-        displayCoordinateWithSum(coordinates[i], m);
+    SortStats_add(&stats, &sortStats);
+    SortStats_capturePeakMemory(&stats);
+    if (recording) {
+        replayRecording(label, recording, coordinates, n, m, &keys[0]);
+    } else if (g_replaySorts && engine == SORT_ENGINE_RADIX) {
+        SelectionMenu_printColored(COLOR_YELLOW, "\nThe radix engine does not compare rows, so it has no replay\n");
+        SelectionMenu_waitForKey(NULL);
     }
-    
-    // Display statistics
-    printf("\nSort Statistics:\n");
-    printf("Comparisons: %d\n", stats.comparisons);
-    printf("Swaps: %d\n", stats.swaps);
-    
+
+    // Display sorted coordinates with sums, then the statistics
+    char title[200];
+    snprintf(title, sizeof(title), "Sorted coordinates (%s)", input);
+    viewCoordinates(title, coordinates, n, m, 1, 0);
+    SelectionMenu_clearScreen();
+    displaySortStats(&stats);
+
     // Save sorted coordinates
     char response = SelectionMenu_askYesNo("\nSave sorted coordinates? ");
     if (response == 'y') {
         char* outputFile = SelectionMenu_getOutputFilename(&g_menu, "sorted.csv");
         if (outputFile) {
-            if (saveCoordinatesToFile(outputFile, coordinates, n, m)) {
+            PhaseTimer_start(&timer);
+            int saved = saveCoordinatesToFile(outputFile, coordinates, n, m);
+            PhaseTimer_stop(&timer, &stats, PHASE_SAVE);
+            if (saved) {
                 SelectionMenu_printColored(COLOR_GREEN, "\nCoordinates saved to %s\n", outputFile);
             } else {
                 SelectionMenu_printColored(COLOR_RED, "\nFailed to save coordinates!\n");
@@ -419,11 +804,164 @@ void optimisedSort(void) {
             free(outputFile);
         }
     }
+
+    // Record statistics for regression tracking
+    SortStats_appendJson(STATS_DUMP_FILE, &stats, label, path, n, m);
     
     // Cleanup
-    FileHandler_freeCoordinates(coordinates, n);
-    SelectionMenu_freeMenuItems(menuItems, fileCount);
-    SelectionMenu_freeFileList(files, fileCount);
+    DatasetCache_closeView(g_cache, &view);
+    SelectionMenu_waitForKey(NULL);
+}
+
+/**
+ * @brief Handles the range query option
+ *
+ * Allows the user to:
+ * 1. Select a CSV file
+ * 2. Enter a rectangle as "minX minY maxX maxY"
+ * 3. View the coordinates inside the rectangle, sorted by sum
+ * 4. View sorting statistics
+ * 5. Save the matching coordinates
+ */
+void rangeQuery(void) {
+    // Let user select a file
+    char path[FILE_PATH_LENGTH];
+    if (!chooseCsvFile(path, sizeof(path))) {
+        return;
+    }
+
+    // Read coordinates from file, or reuse them if they are still cached
+    SortStats stats = {};
+    PhaseTimer timer;
+    DatasetView view;
+    if (!loadDataset(path, &view, &stats)) {
+        return;
+    }
+    int n = view.n, m = view.m;
+
+    // Index the coordinates by their x and y components (kept with the cached dataset)
+    PhaseTimer_start(&timer);
+    const SpatialGrid* grid = DatasetCache_getGrid(g_cache, view.dataset);
+    PhaseTimer_stop(&timer, &stats, PHASE_KEYS);
+    if (!grid) {
+        SelectionMenu_printColored(COLOR_RED, "\nRange queries need at least two components per coordinate!\n");
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+
+    // Ask for the query rectangle
+    SelectionMenu_clearScreen();
+    printf("\nData bounds: x [%.2f, %.2f], y [%.2f, %.2f]\n", grid->minX, grid->maxX, grid->minY, grid->maxY);
+    printf("\nEnter rectangle (minX minY maxX maxY): ");
+    char input[128];
+    double minX, minY, maxX, maxY;
+    SelectionMenu_flush();
+    if (!fgets(input, sizeof(input), stdin) ||
+        sscanf(input, "%lf %lf %lf %lf", &minX, &minY, &maxX, &maxY) != 4) {
+        SelectionMenu_printColored(COLOR_RED, "\nInvalid rectangle!\n");
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+
+    int matchCount = 0;
+    double** matches = SpatialGrid_queryRange(grid, minX, minY, maxX, maxY, &matchCount);
+    if (!matches) {
+        SelectionMenu_printColored(COLOR_RED, "\nNo coordinates inside the rectangle!\n");
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+
+    // Sort the matches by sum off the UI thread; radix stays linear however many rows match
+    const SortKey sumKey = {SORT_KEY_SUM, 0, 0};
+    SortStats sortStats;
+    if (!runWatchedSort("Radix Sort by sum", NULL, &sortStats, [&](SortProgress* progress) {
+            return sortCoordinatesByKeysTracked(matches, matchCount, m, &sumKey, 1, SORT_ENGINE_RADIX, progress, NULL);
+        })) {
+        SpatialGrid_freeResults(matches);
+        DatasetCache_closeView(g_cache, &view);
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+    SortStats_add(&stats, &sortStats);
+    SortStats_capturePeakMemory(&stats);
+
+    // Display matching coordinates with sums, then the statistics
+    char title[200];
+    snprintf(title, sizeof(title), "%d of %d coordinates inside [%.2f, %.2f] x [%.2f, %.2f]",
+             matchCount, n, minX, maxX, minY, maxY);
+    viewCoordinates(title, matches, matchCount, m, 1, 1);
+    SelectionMenu_clearScreen();
+    printf("\n%s\n", title);
+    displaySortStats(&stats);
+
+    // Save matching coordinates
+    char response = SelectionMenu_askYesNo("\nSave matching coordinates? ");
+    if (response == 'y') {
+        char* outputFile = SelectionMenu_getOutputFilename(&g_menu, "range.csv");
+        if (outputFile) {
+            PhaseTimer_start(&timer);
+            int saved = saveCoordinatesToFile(outputFile, matches, matchCount, m);
+            PhaseTimer_stop(&timer, &stats, PHASE_SAVE);
+            if (saved) {
+                SelectionMenu_printColored(COLOR_GREEN, "\nCoordinates saved to %s\n", outputFile);
+            } else {
+                SelectionMenu_printColored(COLOR_RED, "\nFailed to save coordinates!\n");
+            }
+            free(outputFile);
+        }
+    }
+
+    // Record statistics for regression tracking
+    SortStats_appendJson(STATS_DUMP_FILE, &stats, "range", path, matchCount, m);
+    
+    // Cleanup
+    SpatialGrid_freeResults(matches);
+    DatasetCache_closeView(g_cache, &view);
+    SelectionMenu_waitForKey(NULL);
+}
+
+/**
+ * @brief Handles the batch sort option
+ *
+ * Sorts every CSV file in the current directory by row sum, several files at
+ * a time, and writes the results to the "sorted" subdirectory. A per-file
+ * summary is shown at the end and every file's statistics are appended to
+ * the stats dump.
+ */
+void batchSort(void) {
+    SelectionMenu_clearScreen();
+    char response = SelectionMenu_askYesNo("\nSort every CSV file here into .\\sorted? ");
+    if (response != 'y') {
+        return;
+    }
+
+    BatchConfig config;
+    BatchProcessor_defaults(&config, ".", "sorted");
+    printf("\nSorting...\n");
+    SelectionMenu_flush();
+
+    BatchReport report;
+    if (!BatchProcessor_run(&config, &report)) {
+        SelectionMenu_printColored(COLOR_RED, "\nBatch sort failed!\n");
+        SelectionMenu_waitForKey(NULL);
+        return;
+    }
+    if (report.count == 0) {
+        SelectionMenu_printColored(COLOR_RED, "\nNo CSV files found!\n");
+    } else {
+        printf("\n");
+        BatchProcessor_printReport(stdout, &report);
+        FILE* dump = fopen(STATS_DUMP_FILE, "a");
+        if (dump) {
+            BatchProcessor_writeJson(dump, &report, "batch radix by sum");
+            fclose(dump);
+        }
+    }
+
+    BatchProcessor_freeReport(&report);
     SelectionMenu_waitForKey(NULL);
 }
 
@@ -437,8 +975,9 @@ void optimisedSort(void) {
  * @return true if save was successful
  */
 int saveCoordinatesToFile(const char* filename, double** coordinates, int n, int m) {
-    FILE* file;
-    if (fopen_s(&file, filename, "w") != 0) {
+    TRACE_SCOPE("saveCoordinatesToFile");
+    FILE* file = fopen(filename, "w");
+    if (!file) {
         printf("Error creating output file: %s\n", filename);
         return 0;
     }
@@ -461,8 +1000,20 @@ int saveCoordinatesToFile(const char* filename, double** coordinates, int n, int
  * 
  * @return 0 on successful execution
  */
-int main(void) {
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        return CommandLine_run(argc, argv);  // Headless: run one command, no menu
+    }
+
     SelectionMenu_init(&g_menu);  // Initialize menu
+    const char* cacheMb = getenv("LAB06_CACHE_MB");
+    g_cache = DatasetCache_create((cacheMb ? atoll(cacheMb) : DATASET_CACHE_DEFAULT_MB) * 1024 * 1024);
+    const char* prefetchMb = getenv("LAB06_PREFETCH_MB");
+    g_prefetch.budgetBytes = (prefetchMb ? atoll(prefetchMb) : PREFETCH_DEFAULT_MB) * 1024 * 1024;
+    const char* recordMb = getenv("LAB06_RECORD_MB");
+    g_recordingBytes = (recordMb ? atoll(recordMb) : SORT_RECORDING_DEFAULT_MB) * 1024 * 1024;
+    PerfCounters_init();          // Hardware counters, if LAB06_PERF is set
+    Trace_init();                 // Timeline export, if LAB06_TRACE_FILE is set
     SelectionMenu_setMenuColor(COLOR_GREEN);  // Set default text color to green
     
     int choice;
@@ -477,10 +1028,24 @@ int main(void) {
                 optimisedSort();
                 break;
             case 3:
+                multiKeySort();
+                break;
+            case 4:
+                rangeQuery();
+                break;
+            case 5:
+                batchSort();
+                break;
+            case 6:
                 menuSettings();
                 break;
         }
-    } while (choice != 4 && choice != 0);
+    } while (choice != 7 && choice != 0);
+    
+    cancelPrefetch();
+    Sidecar_waitForWrites();
+    PerfCounters_shutdown();
+    DatasetCache_destroy(g_cache);
     
     return 0;
 }
\ No newline at end of file
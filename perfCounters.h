@@ -0,0 +1,60 @@
+/**
+ * @file perfCounters.h
+ * @brief Optional hardware performance counters (Linux perf_event_open)
+ *
+ * When the LAB06_PERF environment variable is set to a non-zero value,
+ * PerfCounters_init opens per-process counters for cycles, instructions,
+ * L1 data cache misses, last-level cache misses and branch misses. Counters
+ * follow threads created afterwards. PhaseTimer samples them so every
+ * pipeline phase gets its own deltas in SortStats.
+ *
+ * Counters that cannot be opened (no kernel support, restricted
+ * perf_event_paranoid, containers, other platforms) are reported as
+ * unavailable and read as -1; nothing else changes.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/** Hardware events that can be captured */
+typedef enum {
+    PERF_CYCLES,          ///< CPU cycles
+    PERF_INSTRUCTIONS,    ///< Retired instructions
+    PERF_L1D_MISSES,      ///< L1 data cache read misses
+    PERF_LLC_MISSES,      ///< Last-level cache misses
+    PERF_BRANCH_MISSES,   ///< Mispredicted branches
+    PERF_COUNTER_COUNT
+} PerfCounter;
+
+/**
+ * @brief Opens the counters if LAB06_PERF is set
+ * @return Number of counters that are available (0 if disabled or unsupported)
+ */
+int PerfCounters_init(void);
+
+/**
+ * @brief Closes any open counters
+ */
+void PerfCounters_shutdown(void);
+
+/**
+ * @brief Checks whether any counter is open
+ * @return 1 if at least one counter is available, 0 otherwise
+ */
+int PerfCounters_enabled(void);
+
+/**
+ * @brief Reads the current value of every counter
+ * @param values Output array; unavailable counters are set to -1
+ * @note Values are scaled for multiplexing when the kernel time-shares counters
+ */
+void PerfCounters_read(long long values[PERF_COUNTER_COUNT]);
+
+/**
+ * @brief Returns a short lowercase name for a counter ("cycles", ...)
+ * @param counter Counter to name
+ * @return Static string
+ */
+const char* PerfCounters_name(PerfCounter counter);
+
+#endif // PERF_COUNTERS_H
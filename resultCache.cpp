@@ -0,0 +1,381 @@
+/**
+ * @file resultCache.cpp
+ * @brief Implementation of the sort result cache
+ */
+
+#include "resultCache.h"
+#include "contentHash.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/** Extension of stored permutation files */
+#define RESULT_FILE_EXTENSION ".perm"
+
+/** Stores between directory scans even while the size estimate is within the cap */
+#define RESULT_TRIM_INTERVAL 64
+
+/** Percentage of the disk cap a trim frees, so a full cache is not rescanned on every store */
+#define RESULT_TRIM_HEADROOM_PERCENT 10
+
+/**
+ * @struct ResultFileHeader
+ * @brief Header of a .perm file (32 bytes), followed by n int32 row indices
+ */
+typedef struct {
+    char magic[4];         ///< RESULT_CACHE_MAGIC, not NUL-terminated
+    uint32_t version;      ///< RESULT_CACHE_VERSION
+    uint32_t n;
+    uint32_t m;
+    uint64_t contentHash;
+    uint64_t policyHash;
+} ResultFileHeader;
+
+/** A permutation held in memory, with its place in the LRU list */
+typedef struct {
+    std::vector<int> permutation;
+    std::list<std::string>::iterator lru;
+} MemoryResult;
+
+struct ResultCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, MemoryResult> entries;
+    std::list<std::string> lru;        ///< Most recently used first
+    long long memoryBudgetBytes;
+    long long memoryBytes;
+    long long diskBudgetBytes;
+    std::string directory;             ///< Empty when the disk tier is off
+    long long diskBytes;               ///< Size of the .perm files as of the last scan plus later stores
+    int storesSinceScan;               ///< Stores since the directory was last scanned
+    std::atomic<int> tempCounter;
+};
+
+static char g_defaultDirectory[1024];
+
+static long long megabytesFromEnv(const char* name, long long fallback) {
+    const char* setting = getenv(name);
+    return (long long)((setting ? atof(setting) : (double)fallback) * 1024 * 1024);
+}
+
+void ResultCache_defaults(ResultCacheConfig* config) {
+    config->memoryBudgetBytes = megabytesFromEnv("LAB06_RESULT_CACHE_MB", RESULT_CACHE_DEFAULT_MEMORY_MB);
+    config->diskBudgetBytes = megabytesFromEnv("LAB06_RESULT_DISK_MB", RESULT_CACHE_DEFAULT_DISK_MB);
+
+    const char* directory = getenv("LAB06_RESULT_CACHE_DIR");
+    const char* base;
+    if (directory) {
+        snprintf(g_defaultDirectory, sizeof(g_defaultDirectory), "%s", directory);
+#ifdef _WIN32
+    } else if ((base = getenv("LOCALAPPDATA")) != NULL) {
+        snprintf(g_defaultDirectory, sizeof(g_defaultDirectory), "%s\\lab06\\results", base);
+#else
+    } else if ((base = getenv("XDG_CACHE_HOME")) != NULL && base[0]) {
+        snprintf(g_defaultDirectory, sizeof(g_defaultDirectory), "%s/lab06/results", base);
+    } else if ((base = getenv("HOME")) != NULL) {
+        snprintf(g_defaultDirectory, sizeof(g_defaultDirectory), "%s/.cache/lab06/results", base);
+#endif
+    } else {
+        g_defaultDirectory[0] = 0;
+    }
+    config->directory = g_defaultDirectory[0] ? g_defaultDirectory : NULL;
+}
+
+ResultCache* ResultCache_create(const ResultCacheConfig* config) {
+    std::string directory;
+    if (config->directory && config->diskBudgetBytes > 0) {
+        std::error_code error;
+        fs::create_directories(config->directory, error);
+        if (fs::is_directory(config->directory, error)) {
+            directory = config->directory;
+        }
+    }
+    if (directory.empty() && config->memoryBudgetBytes <= 0) {
+        return NULL;
+    }
+
+    ResultCache* cache = new ResultCache();
+    cache->memoryBudgetBytes = config->memoryBudgetBytes;
+    cache->memoryBytes = 0;
+    cache->diskBudgetBytes = config->diskBudgetBytes;
+    cache->directory = directory;
+    cache->diskBytes = 0;
+    cache->storesSinceScan = RESULT_TRIM_INTERVAL;  // Scan on the first store
+    cache->tempCounter = 0;
+    return cache;
+}
+
+void ResultCache_makeKey(ResultKey* key, uint64_t contentHash, const SortKey* keys, int nKeys,
+                         const char* engine, int n, int m) {
+    // Normalise the key list so that "x" and "c0" name the same result
+    std::string policy = engine;
+    for (int k = 0; k < nKeys; k++) {
+        policy += k == 0 ? ':' : ',';
+        if (keys[k].descending) policy += '-';
+        policy += keys[k].type == SORT_KEY_SUM ? std::string("sum") : "c" + std::to_string(keys[k].column);
+    }
+    key->contentHash = contentHash;
+    key->policyHash = ContentHash_bytes(policy.data(), policy.size(), 0);
+    key->n = n;
+    key->m = m;
+}
+
+static std::string resultName(const ResultKey* key) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%016llx-%dx%d", (unsigned long long)key->contentHash,
+             (unsigned long long)key->policyHash, key->n, key->m);
+    return name;
+}
+
+static long long memoryCost(int n) {
+    return (long long)n * sizeof(int) + 64;
+}
+
+/** Reorders row pointers so that row i becomes the original row permutation[i] */
+static int applyPermutation(double** coordinates, const int* permutation, int n) {
+    double** original = (double**)malloc(n * sizeof(double*));
+    if (!original) {
+        return 0;
+    }
+    memcpy(original, coordinates, n * sizeof(double*));
+    for (int i = 0; i < n; i++) {
+        coordinates[i] = original[permutation[i]];
+    }
+    free(original);
+    return 1;
+}
+
+/** Adds a result to the memory tier and evicts down to the cap. Caller holds the lock. */
+static void rememberResult(ResultCache* cache, const std::string& name, std::vector<int>&& permutation) {
+    long long cost = memoryCost((int)permutation.size());
+    if (cost > cache->memoryBudgetBytes || cache->entries.count(name)) {
+        return;
+    }
+    cache->lru.push_front(name);
+    MemoryResult& entry = cache->entries[name];
+    entry.permutation = std::move(permutation);
+    entry.lru = cache->lru.begin();
+    cache->memoryBytes += cost;
+
+    while (cache->memoryBytes > cache->memoryBudgetBytes) {
+        auto oldest = cache->entries.find(cache->lru.back());
+        cache->memoryBytes -= memoryCost((int)oldest->second.permutation.size());
+        cache->entries.erase(oldest);
+        cache->lru.pop_back();
+    }
+}
+
+/** Reads and checks a stored permutation; a damaged file is treated as a miss */
+static int readResultFile(const std::string& path, const ResultKey* key, std::vector<int>* permutation) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    ResultFileHeader header;
+    int ok = fread(&header, sizeof(header), 1, file) == 1 &&
+             memcmp(header.magic, RESULT_CACHE_MAGIC, 4) == 0 &&
+             header.version == RESULT_CACHE_VERSION &&
+             header.n == (uint32_t)key->n && header.m == (uint32_t)key->m &&
+             header.contentHash == key->contentHash && header.policyHash == key->policyHash;
+    if (ok) {
+        permutation->resize(key->n);
+        ok = fread(permutation->data(), sizeof(int), key->n, file) == (size_t)key->n;
+    }
+    fclose(file);
+
+    // Every row exactly once, or applying it would duplicate and lose rows
+    if (ok) {
+        std::vector<char> seen(key->n, 0);
+        for (int index : *permutation) {
+            if (index < 0 || index >= key->n || seen[index]) {
+                return 0;
+            }
+            seen[index] = 1;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Deletes least recently used .perm files once the directory is over the
+ * disk cap, down to RESULT_TRIM_HEADROOM_PERCENT below it, and resets the
+ * size estimate to what the scan found
+ */
+static void trimDirectory(ResultCache* cache) {
+    TRACE_SCOPE("ResultCache_trim");
+    std::error_code error;
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    long long total = 0;
+    for (const fs::directory_entry& entry : fs::directory_iterator(cache->directory, error)) {
+        if (entry.path().extension() != RESULT_FILE_EXTENSION) {
+            continue;
+        }
+        total += (long long)entry.file_size(error);
+        files.emplace_back(entry.last_write_time(error), entry.path());
+    }
+    if (total > cache->diskBudgetBytes) {
+        long long target = cache->diskBudgetBytes - cache->diskBudgetBytes / 100 * RESULT_TRIM_HEADROOM_PERCENT;
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            if (total <= target) {
+                break;
+            }
+            long long bytes = (long long)fs::file_size(file.second, error);
+            if (fs::remove(file.second, error)) {
+                total -= bytes;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->diskBytes = total;
+}
+
+/**
+ * Counts a stored file towards the size estimate and tells whether the
+ * directory should be scanned: when the estimate passes the cap, and every
+ * RESULT_TRIM_INTERVAL stores for files other processes have added
+ */
+static int noteStored(ResultCache* cache, long long bytes) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->diskBytes += bytes;
+    if (cache->diskBytes <= cache->diskBudgetBytes && ++cache->storesSinceScan < RESULT_TRIM_INTERVAL) {
+        return 0;
+    }
+    cache->storesSinceScan = 0;
+    return 1;
+}
+
+int ResultCache_apply(ResultCache* cache, const ResultKey* key, double** coordinates) {
+    if (!cache || key->n < 1) {
+        return 0;
+    }
+    TRACE_SCOPE("ResultCache_apply");
+    std::string name = resultName(key);
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        auto found = cache->entries.find(name);
+        if (found != cache->entries.end()) {
+            cache->lru.splice(cache->lru.begin(), cache->lru, found->second.lru);
+            return applyPermutation(coordinates, found->second.permutation.data(), key->n);
+        }
+    }
+    if (cache->directory.empty()) {
+        return 0;
+    }
+
+    fs::path path = fs::path(cache->directory) / (name + RESULT_FILE_EXTENSION);
+    std::vector<int> permutation;
+    if (!readResultFile(path.string(), key, &permutation) ||
+        !applyPermutation(coordinates, permutation.data(), key->n)) {
+        return 0;
+    }
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);  // Mark as recently used
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    rememberResult(cache, name, std::move(permutation));
+    return 1;
+}
+
+/**
+ * Finds where each sorted row pointer was in the file order with an
+ * open-addressing table from pointer to original index.
+ */
+static int capturePermutation(double** original, double** sorted, int n, std::vector<int>* permutation) {
+    size_t capacity = 1;
+    int shift = 64;
+    while (capacity < (size_t)n * 2) {
+        capacity <<= 1;
+        shift--;
+    }
+    std::vector<double*> slotRows(capacity, NULL);
+    std::vector<int> slotIndex(capacity);
+    auto slotOf = [&](double* row) {
+        return (size_t)(((uint64_t)(uintptr_t)row * 0x9E3779B97F4A7C15ULL) >> shift) & (capacity - 1);
+    };
+    for (int i = 0; i < n; i++) {
+        size_t slot = slotOf(original[i]);
+        while (slotRows[slot]) slot = (slot + 1) & (capacity - 1);
+        slotRows[slot] = original[i];
+        slotIndex[slot] = i;
+    }
+
+    permutation->resize(n);
+    for (int i = 0; i < n; i++) {
+        size_t slot = slotOf(sorted[i]);
+        while (slotRows[slot] && slotRows[slot] != sorted[i]) slot = (slot + 1) & (capacity - 1);
+        if (!slotRows[slot]) {
+            return 0;  // Not a reordering of the original rows
+        }
+        (*permutation)[i] = slotIndex[slot];
+    }
+    return 1;
+}
+
+void ResultCache_record(ResultCache* cache, const ResultKey* key, double** original, double** sorted) {
+    if (!cache || key->n < 1) {
+        return;
+    }
+    TRACE_SCOPE("ResultCache_record");
+    std::vector<int> permutation;
+    if (!capturePermutation(original, sorted, key->n, &permutation)) {
+        return;
+    }
+    std::string name = resultName(key);
+
+    if (!cache->directory.empty()) {
+        ResultFileHeader header;
+        memcpy(header.magic, RESULT_CACHE_MAGIC, 4);
+        header.version = RESULT_CACHE_VERSION;
+        header.n = (uint32_t)key->n;
+        header.m = (uint32_t)key->m;
+        header.contentHash = key->contentHash;
+        header.policyHash = key->policyHash;
+
+        // Write under a unique name and rename, so readers only see whole files
+        fs::path path = fs::path(cache->directory) / (name + RESULT_FILE_EXTENSION);
+        fs::path temp = path;
+        temp += ".tmp" + std::to_string((long long)getpid()) + "-" + std::to_string(cache->tempCounter++);
+        FILE* file = fopen(temp.string().c_str(), "wb");
+        if (file) {
+            fwrite(&header, sizeof(header), 1, file);
+            fwrite(permutation.data(), sizeof(int), key->n, file);
+            int ok = !ferror(file);
+            if (fclose(file) != 0) {
+                ok = 0;
+            }
+            std::error_code error;
+            if (ok) {
+                fs::rename(temp, path, error);
+            }
+            if (!ok || error) {
+                fs::remove(temp, error);
+            } else if (noteStored(cache, (long long)sizeof(header) + (long long)key->n * sizeof(int))) {
+                trimDirectory(cache);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    rememberResult(cache, name, std::move(permutation));
+}
+
+void ResultCache_destroy(ResultCache* cache) {
+    delete cache;
+}
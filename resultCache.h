@@ -0,0 +1,107 @@
+/**
+ * @file resultCache.h
+ * @brief Memoized sort results: the permutation a sort produced, not the data
+ *
+ * A result is identified by the content hash of the input file, the key list,
+ * the engine and the matrix shape. Sorting the same content the same way again
+ * then only costs applying the stored permutation to the row pointers.
+ *
+ * Results live in a memory tier and a directory of ".perm" files, each with
+ * its own size cap; least recently used results are dropped first. A cap of 0
+ * turns that tier off.
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdint.h>
+#include "sortEngine.h"
+
+/** First four bytes of a stored permutation */
+#define RESULT_CACHE_MAGIC "L6RP"
+/** Current permutation file format version */
+#define RESULT_CACHE_VERSION 1
+/** Memory tier cap when LAB06_RESULT_CACHE_MB is not set */
+#define RESULT_CACHE_DEFAULT_MEMORY_MB 64
+/** Disk tier cap when LAB06_RESULT_DISK_MB is not set */
+#define RESULT_CACHE_DEFAULT_DISK_MB 256
+
+/**
+ * @struct ResultCacheConfig
+ * @brief Where and how much to cache
+ */
+typedef struct {
+    const char* directory;        ///< Directory for .perm files (created if missing), NULL = no disk tier
+    long long memoryBudgetBytes;  ///< Memory tier cap, 0 = off
+    long long diskBudgetBytes;    ///< Disk tier cap, 0 = off
+} ResultCacheConfig;
+
+/**
+ * @struct ResultKey
+ * @brief Identity of one sort result
+ */
+typedef struct {
+    uint64_t contentHash;  ///< ContentHash of the input file
+    uint64_t policyHash;   ///< Hash of the engine name and the normalised key list
+    int n;
+    int m;
+} ResultKey;
+
+/** Opaque cache handle */
+typedef struct ResultCache ResultCache;
+
+/**
+ * @brief Fills a configuration from LAB06_RESULT_CACHE_DIR, LAB06_RESULT_CACHE_MB and LAB06_RESULT_DISK_MB
+ *
+ * Without LAB06_RESULT_CACHE_DIR, results go under the user's cache directory
+ * ($XDG_CACHE_HOME or ~/.cache on Unix, %LOCALAPPDATA% on Windows).
+ *
+ * @param config Configuration to fill
+ */
+void ResultCache_defaults(ResultCacheConfig* config);
+
+/**
+ * @brief Creates a cache
+ * @param config Locations and caps (the directory string is copied)
+ * @return New cache, or NULL if both tiers are off
+ */
+ResultCache* ResultCache_create(const ResultCacheConfig* config);
+
+/**
+ * @brief Builds the key of a sort
+ * @param key Output parameter for the key
+ * @param contentHash ContentHash of the input file
+ * @param keys Keys in priority order
+ * @param nKeys Number of keys
+ * @param engine Engine name, e.g. "radix" or "optimised"
+ * @param n Number of rows
+ * @param m Number of columns
+ */
+void ResultCache_makeKey(ResultKey* key, uint64_t contentHash, const SortKey* keys, int nKeys,
+                         const char* engine, int n, int m);
+
+/**
+ * @brief Reorders rows into a cached result, if there is one
+ * @param cache Cache to look in (NULL = always a miss)
+ * @param key Result wanted
+ * @param coordinates Row pointers in file order; reordered on a hit
+ * @return 1 on a hit, 0 on a miss (coordinates untouched)
+ */
+int ResultCache_apply(ResultCache* cache, const ResultKey* key, double** coordinates);
+
+/**
+ * @brief Stores the permutation between the file order and a sorted order
+ * @param cache Cache to store in (NULL = nothing happens)
+ * @param key Result being stored
+ * @param original Row pointers in file order
+ * @param sorted The same row pointers after sorting
+ */
+void ResultCache_record(ResultCache* cache, const ResultKey* key, double** original, double** sorted);
+
+/**
+ * @brief Frees the cache; stored files are kept
+ * @param cache Cache to free
+ */
+void ResultCache_destroy(ResultCache* cache);
+
+#endif // RESULT_CACHE_H
@@ -4,17 +4,308 @@
  */
 
 #include "selectionMenu.h"
+#include "trace.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
 #include <windows.h>
 #include <conio.h>
-#include <stdarg.h>
+#else
+#include <dirent.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#endif
 
 static int g_menuColor = COLOR_GREEN;  // Default text color is green
+static int g_extendedKey = 0;          // Last key was a special key, not a character with the same code
+
+/*
+ * Console backend. Output goes through stdout, which SelectionMenu_init makes
+ * fully buffered: text, colors and cursor moves of one screen update collect
+ * in the buffer and reach the terminal in a single write when the frame is
+ * flushed (before waiting for a key, or by SelectionMenu_flush). Colors and
+ * cursor control are ANSI escape sequences, so they buffer like text. Windows
+ * consoles that cannot interpret them fall back to the console API, which
+ * acts immediately and therefore flushes first.
+ *
+ * Input is a single key press without echo: _getch on Windows, termios
+ * elsewhere. Both report special keys with the Windows scan codes (72 = up,
+ * 80 = down) and Enter as 13, so the menu code above this layer is shared.
+ */
+
+/** Maps a Windows console color (bit 0 blue, 1 green, 2 red, 3 bright) to an ANSI color index */
+static int ansiColor(int color) {
+    return ((color & 4) ? 1 : 0) | (color & 2) | ((color & 1) ? 4 : 0);
+}
+
+static void ansiSetColor(int textColor, int bgColor) {
+    int foreground = ((textColor & 8) ? 90 : 30) + ansiColor(textColor);
+    // Black background means the terminal's own background
+    int background = bgColor == COLOR_BLACK ? 49 : ((bgColor & 8) ? 100 : 40) + ansiColor(bgColor);
+    printf("\x1b[%d;%dm", foreground, background);
+}
+
+static void restoreTerminalColors(void) {
+    fputs("\x1b[0m", stdout);
+    fflush(stdout);
+}
+
+#ifdef _WIN32
+
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+static int g_legacyConsole = 1;  // Console without escape sequence support (before Windows 10)
+
+static void consoleInit(void) {
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (g_legacyConsole && GetConsoleMode(console, &mode) &&
+        SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING)) {
+        g_legacyConsole = 0;
+        atexit(restoreTerminalColors);
+    }
+}
+
+static void consoleSetColor(int textColor, int bgColor) {
+    if (!g_legacyConsole) {
+        ansiSetColor(textColor, bgColor);
+        return;
+    }
+    fflush(stdout);
+    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), (bgColor << 4) | textColor);
+}
+
+static void consoleClear(void) {
+    if (!g_legacyConsole) {
+        fputs("\x1b[H\x1b[2J", stdout);
+        return;
+    }
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    COORD home = {0, 0};
+    DWORD written;
+    fflush(stdout);
+    if (!GetConsoleScreenBufferInfo(console, &info)) {
+        return;
+    }
+    DWORD cells = (DWORD)info.dwSize.X * info.dwSize.Y;
+    FillConsoleOutputCharacterA(console, ' ', cells, home, &written);
+    FillConsoleOutputAttribute(console, info.wAttributes, cells, home, &written);
+    SetConsoleCursorPosition(console, home);
+}
+
+static void consoleSize(int* rows, int* cols) {
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+static void consoleMoveCursor(int row, int col) {
+    if (!g_legacyConsole) {
+        printf("\x1b[%d;%dH", row + 1, col + 1);
+        return;
+    }
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    fflush(stdout);
+    COORD position = {(SHORT)col, (SHORT)row};
+    if (GetConsoleScreenBufferInfo(console, &info)) {
+        position.Y += info.srWindow.Top;
+    }
+    SetConsoleCursorPosition(console, position);
+}
+
+/** Blanks a whole row and leaves the cursor at its start */
+static void consoleEraseLine(int row) {
+    if (!g_legacyConsole) {
+        printf("\x1b[%d;1H\x1b[2K", row + 1);
+        return;
+    }
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD written;
+    fflush(stdout);
+    if (!GetConsoleScreenBufferInfo(console, &info)) {
+        return;
+    }
+    COORD start = {0, (SHORT)(info.srWindow.Top + row)};
+    FillConsoleOutputCharacterA(console, ' ', info.dwSize.X, start, &written);
+    FillConsoleOutputAttribute(console, info.wAttributes, info.dwSize.X, start, &written);
+    SetConsoleCursorPosition(console, start);
+}
+
+/** Waits up to timeoutMs (-1 = forever) for a key press; returns -1 if none came */
+static int getKeyWithin(int timeoutMs) {
+    fflush(stdout);
+    for (int waited = 0; timeoutMs >= 0 && !_kbhit(); waited += 10) {
+        if (waited >= timeoutMs) {
+            return -1;
+        }
+        Sleep(10);
+    }
+    int key = _getch();
+    g_extendedKey = key == 0 || key == 224;
+    if (g_extendedKey) {  // Special key
+        key = _getch();
+    }
+    return key;
+}
+
+#else
+
+static void consoleInit(void) {
+    static int registered = 0;
+    if (!registered) {
+        atexit(restoreTerminalColors);
+        registered = 1;
+    }
+}
+
+static void consoleSetColor(int textColor, int bgColor) {
+    ansiSetColor(textColor, bgColor);
+}
+
+static void consoleClear(void) {
+    fputs("\x1b[H\x1b[2J", stdout);  // Cursor home, erase screen
+}
+
+static void consoleSize(int* rows, int* cols) {
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        *rows = size.ws_row;
+        *cols = size.ws_col;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+static void consoleMoveCursor(int row, int col) {
+    printf("\x1b[%d;%dH", row + 1, col + 1);
+}
+
+/** Blanks a whole row and leaves the cursor at its start */
+static void consoleEraseLine(int row) {
+    printf("\x1b[%d;1H\x1b[2K", row + 1);
+}
+
+/** Reads one byte from the terminal, or returns -1 if none arrives within timeoutMs (-1 = wait) */
+static int readByte(int timeoutMs) {
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    if (timeoutMs >= 0 && poll(&input, 1, timeoutMs) <= 0) {
+        return -1;
+    }
+    unsigned char byte;
+    return read(STDIN_FILENO, &byte, 1) == 1 ? byte : -1;
+}
+
+/** Decodes the rest of an escape sequence into a Windows scan code, or 0 if it has none */
+static int readEscapeSequence(void) {
+    int introducer = readByte(30);
+    if (introducer == -1) {
+        return 27;  // A lone Escape key press
+    }
+    if (introducer != '[' && introducer != 'O') {
+        return 0;
+    }
+    int code = readByte(30);
+    switch (code) {
+        case 'A': return 72;  // Up
+        case 'B': return 80;  // Down
+        case 'C': return 77;  // Right
+        case 'D': return 75;  // Left
+        case 'H': return 71;  // Home
+        case 'F': return 79;  // End
+    }
+    if (code < '0' || code > '9') {
+        return 0;
+    }
+    // "ESC [ n ~" keys; skip any modifiers up to the final '~'
+    int number = code - '0';
+    int next;
+    while ((next = readByte(30)) >= '0' && next <= '9') {
+        number = number * 10 + (next - '0');
+    }
+    while (next != -1 && next != '~') {
+        next = readByte(30);
+    }
+    switch (number) {
+        case 1: case 7: return 71;  // Home
+        case 3: return 83;          // Delete
+        case 4: case 8: return 79;  // End
+        case 5: return 73;          // Page Up
+        case 6: return 81;          // Page Down
+    }
+    return 0;
+}
+
+/** Waits up to timeoutMs (-1 = forever) for a key press; returns -1 if none came */
+static int getKeyWithin(int timeoutMs) {
+    fflush(stdout);
+    struct termios saved;
+    int terminal = tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (terminal) {
+        struct termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    // Raw mode first: a canonical terminal would not report single keys as ready
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    if (timeoutMs >= 0 && poll(&input, 1, timeoutMs) <= 0) {
+        if (terminal) {
+            tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        }
+        return -1;
+    }
+
+    int key = readByte(-1);
+    g_extendedKey = 0;
+    if (key == -1) {
+        key = 27;  // End of input: treat as Escape so menus can exit
+    } else if (key == 27) {
+        key = readEscapeSequence();
+        g_extendedKey = key != 27;
+    } else if (key == '\n') {
+        key = 13;
+    } else if (key == 127) {
+        key = 8;   // Backspace
+    }
+
+    if (terminal) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    }
+    return key;
+}
+
+#endif
+
+static int getKey(void) {
+    return getKeyWithin(-1);
+}
 
 void SelectionMenu_init(SelectionMenu* menu) {
     menu->currentMenuType = MENU_CLASSIC;
+    setvbuf(stdout, NULL, _IOFBF, SELECTION_MENU_OUTPUT_BUFFER);
+    consoleInit();
     SelectionMenu_resetColor();  // Apply the green color immediately
 }
 
@@ -35,7 +326,7 @@ int SelectionMenu_getMenuColor(void) {
 }
 
 void SelectionMenu_setColor(int textColor, int bgColor) {
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), (bgColor << 4) | textColor);
+    consoleSetColor(textColor, bgColor);
 }
 
 void SelectionMenu_resetColor(void) {
@@ -57,11 +348,15 @@ void SelectionMenu_waitForKey(const char* message) {
     if (message) {
         printf("\n%s", message);
     }
-    _getch();
+    getKey();
 }
 
 void SelectionMenu_clearScreen(void) {
-    system("cls");
+    consoleClear();
+}
+
+void SelectionMenu_flush(void) {
+    fflush(stdout);
 }
 
 static void displayTitle(const char* title) {
@@ -78,14 +373,6 @@ static void highlightText(const char* text) {
     SelectionMenu_resetColor();
 }
 
-static int getKey(void) {
-    int key = _getch();
-    if (key == 0 || key == 224) {  // Special key
-        key = _getch();
-    }
-    return key;
-}
-
 static int handleNavigation(int selection, int nItems, int key) {
     switch (key) {
         case 72:  // Up arrow
@@ -136,96 +423,887 @@ static int generateClassicMenu(SelectionMenu* menu, const char* title, const cha
         
         // Get user input
         printf("\nEnter your choice (1-%d, 0 to exit): ", nItems);
-        if (fgets(input, sizeof(input), stdin)) {
-            // Remove newline
-            input[strcspn(input, "\n")] = 0;
-            
-            // Convert to integer
-            selection = atoi(input);
-            
-            // Validate input
-            if (selection >= 0 && selection <= nItems) {
-                return selection;
-            }
+        SelectionMenu_flush();
+        if (!fgets(input, sizeof(input), stdin)) {
+            return 0;  // End of input: same as exit
+        }
+        
+        // Remove newline
+        input[strcspn(input, "\n")] = 0;
+        
+        // Convert to integer
+        selection = atoi(input);
+        
+        // Validate input
+        if (selection >= 0 && selection <= nItems) {
+            return selection;
         }
         
         printf("\nInvalid choice. Press any key to try again...");
-        _getch();
+        getKey();
         
     } while (1);
 }
 
-static int generateCursorMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems) {
-    int selection = 1;
-    int key;
-    
-    do {
+/*
+ * Cursor menus draw into a MenuFrame and present it against the frame that is
+ * already on screen: only rows whose text or highlight changed are rewritten,
+ * using cursor moves instead of clearing. An arrow key press therefore costs
+ * two rows no matter how long the list is. The screen is cleared only for the
+ * first frame of a menu and after the terminal is resized.
+ */
+
+/** Rows a frame can hold; taller terminals leave the rest empty */
+#define MENU_FRAME_MAX_LINES 128
+/** Bytes kept per row, including the terminator */
+#define MENU_FRAME_LINE_LENGTH 256
+
+typedef struct {
+    char text[MENU_FRAME_LINE_LENGTH];
+    int highlightFrom;   ///< Offset where the highlighted part starts, -1 = none
+    int highlightColor;  ///< Color of the highlighted part
+} FrameLine;
+
+typedef struct {
+    FrameLine lines[MENU_FRAME_MAX_LINES];
+    int nLines;
+    int rows;   ///< Terminal size the frame was laid out for
+    int cols;
+} MenuFrame;
+
+static MenuFrame g_frames[2];
+
+static void frameBegin(MenuFrame* frame) {
+    frame->nLines = 0;
+    consoleSize(&frame->rows, &frame->cols);
+    if (frame->rows > MENU_FRAME_MAX_LINES) {
+        frame->rows = MENU_FRAME_MAX_LINES;
+    }
+}
+
+/** Appends a row made of prefix followed by text; text is drawn in color unless that is COLOR_BLACK */
+static void frameAddLine(MenuFrame* frame, const char* prefix, const char* text, int color) {
+    if (frame->nLines >= frame->rows) {
+        return;
+    }
+    FrameLine* line = &frame->lines[frame->nLines++];
+    // Stay off the last column so the terminal never wraps or scrolls
+    int width = frame->cols - 1 < MENU_FRAME_LINE_LENGTH - 1 ? frame->cols - 1 : MENU_FRAME_LINE_LENGTH - 1;
+    int length = snprintf(line->text, width + 1, "%s", prefix);
+    if (length > width) {
+        length = width;
+    }
+    line->highlightFrom = color != COLOR_BLACK ? length : -1;
+    line->highlightColor = color;
+    snprintf(line->text + length, width + 1 - length, "%s", text);
+}
+
+static void frameAddTitle(MenuFrame* frame, const char* title) {
+    char underline[MENU_FRAME_LINE_LENGTH];
+    size_t length = strlen(title);
+    if (length > sizeof(underline) - 1) {
+        length = sizeof(underline) - 1;
+    }
+    memset(underline, '=', length);
+    underline[length] = '\0';
+    frameAddLine(frame, "", "", COLOR_BLACK);
+    frameAddLine(frame, title, "", COLOR_BLACK);
+    frameAddLine(frame, underline, "", COLOR_BLACK);
+    frameAddLine(frame, "", "", COLOR_BLACK);
+}
+
+static int sameLine(const FrameLine* a, const FrameLine* b) {
+    return a->highlightFrom == b->highlightFrom && a->highlightColor == b->highlightColor &&
+           strcmp(a->text, b->text) == 0;
+}
+
+static void printFrameLine(const FrameLine* line) {
+    if (line->highlightFrom < 0) {
+        fputs(line->text, stdout);
+        return;
+    }
+    printf("%.*s", line->highlightFrom, line->text);
+    SelectionMenu_printColored(line->highlightColor, "%s", line->text + line->highlightFrom);
+}
+
+/**
+ * Brings the screen from drawn to next
+ * @param drawn Frame on screen, or NULL if the screen holds something else
+ */
+static void framePresent(const MenuFrame* next, const MenuFrame* drawn) {
+    int full = !drawn || drawn->rows != next->rows || drawn->cols != next->cols;
+    if (full) {
         SelectionMenu_clearScreen();
-        displayTitle(title);
-        
-        // Display menu items
-        for (int i = 0; i < nItems; i++) {
-            if (i + 1 == selection) {
-                printf("> ");
-                SelectionMenu_printColored(COLOR_GREEN, "%s\n", items[i]);
-            } else {
-                printf("  %s\n", items[i]);
-            }
+        for (int i = 0; i < next->nLines; i++) {
+            consoleMoveCursor(i, 0);
+            printFrameLine(&next->lines[i]);
         }
-        
-        key = getKey();
-        selection = handleNavigation(selection, nItems, key);
-        
-        if (selection <= 0) {
-            return (selection < 0) ? -selection : 0;
+    } else {
+        int nLines = next->nLines > drawn->nLines ? next->nLines : drawn->nLines;
+        for (int i = 0; i < nLines; i++) {
+            if (i < next->nLines && i < drawn->nLines && sameLine(&next->lines[i], &drawn->lines[i])) {
+                continue;
+            }
+            consoleEraseLine(i);
+            if (i < next->nLines) {
+                printFrameLine(&next->lines[i]);
+            }
         }
-    } while (1);
+    }
+    // Park the cursor below the menu
+    consoleMoveCursor(next->nLines < next->rows ? next->nLines : next->rows - 1, 0);
+    fflush(stdout);
 }
 
-static int generateCondensedMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems) {
+/**
+ * Shared loop of the cursor and condensed menus
+ * @param pageSize Most items shown at once, or 0 to fit the terminal
+ */
+static int runCursorMenu(const char* title, const char* items[], int nItems, int pageSize) {
     int selection = 1;
-    int key;
     int startItem = 0;
-    const int ITEMS_PER_PAGE = 3;
-    
+    int current = 0;
+    const MenuFrame* drawn = NULL;
+
     do {
-        SelectionMenu_clearScreen();
-        displayTitle(title);
-        
+        MenuFrame* frame = &g_frames[current];
+        frameBegin(frame);
+        frameAddTitle(frame, title);
+
+        // Title block, then items, then a spare row; indicators only when clipped
+        int visible = frame->rows - frame->nLines - 1;
+        if (visible < nItems) {
+            visible -= 3;
+        }
+        if (pageSize > 0 && pageSize < visible) {
+            visible = pageSize;
+        }
+        if (visible < 1) {
+            visible = 1;
+        }
+
         // Calculate visible range
-        if (selection > startItem + ITEMS_PER_PAGE) {
-            startItem = selection - ITEMS_PER_PAGE;
+        if (selection > startItem + visible) {
+            startItem = selection - visible;
         } else if (selection <= startItem) {
             startItem = selection - 1;
         }
-        
+
         // Display menu items
-        for (int i = startItem; i < startItem + ITEMS_PER_PAGE && i < nItems; i++) {
+        for (int i = startItem; i < startItem + visible && i < nItems; i++) {
             if (i + 1 == selection) {
-                printf("> ");
-                SelectionMenu_printColored(COLOR_GREEN, "%s\n", items[i]);
+                frameAddLine(frame, "> ", items[i], COLOR_GREEN);
             } else {
-                printf("  %s\n", items[i]);
+                frameAddLine(frame, "  ", items[i], COLOR_BLACK);
             }
         }
-        
+
         // Display navigation help
+        if (startItem > 0 || startItem + visible < nItems) {
+            frameAddLine(frame, "", "", COLOR_BLACK);
+        }
         if (startItem > 0) {
-            printf("\n^ More items above");
+            frameAddLine(frame, "^ More items above", "", COLOR_BLACK);
         }
-        if (startItem + ITEMS_PER_PAGE < nItems) {
-            printf("\nv More items below");
+        if (startItem + visible < nItems) {
+            frameAddLine(frame, "v More items below", "", COLOR_BLACK);
         }
-        
-        key = getKey();
+
+        framePresent(frame, drawn);
+        drawn = frame;
+        current ^= 1;
+
+        int key = getKey();
         selection = handleNavigation(selection, nItems, key);
-        
+
         if (selection <= 0) {
             return (selection < 0) ? -selection : 0;
         }
     } while (1);
 }
 
+static int generateCursorMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems) {
+    return runCursorMenu(title, items, nItems, 0);
+}
+
+static int generateCondensedMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems) {
+    const int ITEMS_PER_PAGE = 3;
+    return runCursorMenu(title, items, nItems, ITEMS_PER_PAGE);
+}
+
+/** Moves a viewer to a row typed at its prompt; returns the row, or -1 if there is none */
+static long long viewerFind(const RowViewer* viewer, int command, const char* query) {
+    if (command == 'f') {
+        return viewer->findRow(viewer->context, query);
+    }
+    char* end;
+    long long row = strtoll(query, &end, 10) - 1;
+    if (end == query || *end != '\0' || row < 0 || row >= viewer->nRows) {
+        return -1;
+    }
+    return row;
+}
+
+void SelectionMenu_viewRows(const RowViewer* viewer) {
+    long long top = 0;
+    long long marked = -1;
+    int command = 0;     // 'g' or 'f' while a prompt is open
+    char query[64] = "";
+    int queryLength = 0;
+    char message[MENU_FRAME_LINE_LENGTH] = "";
+    int current = 0;
+    const MenuFrame* drawn = NULL;
+
+    // Width of the row numbers
+    int digits = 1;
+    for (long long limit = 10; limit <= viewer->nRows && digits < 19; limit *= 10) {
+        digits++;
+    }
+
+    do {
+        // Formatting the rows and drawing them is the viewer's display time
+        long long visible, lastTop;
+        {
+            TRACE_SCOPE("display");
+            MenuFrame* frame = &g_frames[current];
+            frameBegin(frame);
+            frameAddTitle(frame, viewer->title);
+
+            // Title block, rows, a blank row, status and help rows, a spare row
+            visible = frame->rows - frame->nLines - 4;
+            if (visible < 1) {
+                visible = 1;
+            }
+            lastTop = viewer->nRows > visible ? viewer->nRows - visible : 0;
+            if (top > lastTop) {
+                top = lastTop;
+            }
+            if (top < 0) {
+                top = 0;
+            }
+
+            // Only the rows on screen are formatted
+            for (long long i = top; i < top + visible && i < viewer->nRows; i++) {
+                char text[MENU_FRAME_LINE_LENGTH];
+                // Room for the marker and the widest row number on top of the text
+                char prefix[MENU_FRAME_LINE_LENGTH + 24];
+                int accent = viewer->formatRow(viewer->context, i, text, sizeof(text));
+                if (accent < 0 || accent > (int)strlen(text)) {
+                    accent = (int)strlen(text);
+                }
+                snprintf(prefix, sizeof(prefix), "%c %*lld  %.*s", i == marked ? '>' : ' ', digits, i + 1, accent, text);
+                frameAddLine(frame, prefix, text + accent, text[accent] ? viewer->accentColor : COLOR_BLACK);
+            }
+            if (viewer->nRows == 0) {
+                frameAddLine(frame, "  (no rows)", "", COLOR_BLACK);
+            }
+
+            char status[MENU_FRAME_LINE_LENGTH];
+            snprintf(status, sizeof(status), "Rows %lld-%lld of %lld%s%s",
+                     viewer->nRows ? top + 1 : 0, top + visible < viewer->nRows ? top + visible : viewer->nRows,
+                     viewer->nRows, message[0] ? "   " : "", message);
+            char help[MENU_FRAME_LINE_LENGTH];
+            if (command == 'g') {
+                snprintf(help, sizeof(help), "Go to row (1-%lld): %s", viewer->nRows, query);
+            } else if (command == 'f') {
+                snprintf(help, sizeof(help), "Find %s: %s", viewer->findLabel, query);
+            } else {
+                snprintf(help, sizeof(help), "Up/Down PgUp/PgDn Home/End  g: go to row%s%s  Enter: continue",
+                         viewer->findRow ? "  f: find " : "", viewer->findRow ? viewer->findLabel : "");
+            }
+            frameAddLine(frame, "", "", COLOR_BLACK);
+            frameAddLine(frame, status, "", COLOR_BLACK);
+            frameAddLine(frame, help, "", COLOR_BLACK);
+
+            framePresent(frame, drawn);
+            drawn = frame;
+            current ^= 1;
+        }
+
+        int key = getKey();
+        if (command) {
+            // Line editing on the prompt row; special keys are not text
+            if (g_extendedKey) {
+                continue;
+            }
+            if (key == 13) {
+                long long row = viewerFind(viewer, command, query);
+                if (row < 0) {
+                    snprintf(message, sizeof(message), "Not found: %s", query);
+                } else {
+                    // Put the row in the middle of the page
+                    marked = row;
+                    top = row - visible / 2;
+                }
+                command = 0;
+            } else if (key == 27) {
+                command = 0;
+            } else if (key == 8 && queryLength > 0) {
+                query[--queryLength] = '\0';
+            } else if (key >= 32 && key < 127 && queryLength < (int)sizeof(query) - 1) {
+                query[queryLength++] = (char)key;
+                query[queryLength] = '\0';
+            }
+            continue;
+        }
+
+        message[0] = '\0';
+        if (g_extendedKey) {
+            switch (key) {
+                case 72: top--; break;             // Up arrow
+                case 80: top++; break;             // Down arrow
+                case 73: top -= visible; break;    // Page Up
+                case 81: top += visible; break;    // Page Down
+                case 71: top = 0; break;           // Home
+                case 79: top = lastTop; break;     // End
+            }
+            continue;
+        }
+        switch (key) {
+            case ' ':  // Page Down
+                top += visible;
+                break;
+            case 'g':
+            case 'f':
+                if (key == 'g' || viewer->findRow) {
+                    command = key;
+                    query[0] = '\0';
+                    queryLength = 0;
+                }
+                break;
+            case 13:  // Enter
+            case 27:  // Escape
+            case 'q':
+                return;
+        }
+    } while (1);
+}
+
+/** Longest filter the file picker accepts */
+#define PICKER_FILTER_LENGTH 63
+
+/** Formats a byte count as "512 B", "12.3 KB", "4.5 MB" or "1.2 GB" */
+static void formatBytes(long long bytes, char* buffer, size_t size) {
+    if (bytes < 1024) {
+        snprintf(buffer, size, "%lld B", bytes);
+    } else if (bytes < 1024LL * 1024) {
+        snprintf(buffer, size, "%.1f KB", bytes / 1024.0);
+    } else if (bytes < 1024LL * 1024 * 1024) {
+        snprintf(buffer, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else {
+        snprintf(buffer, size, "%.1f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+    }
+}
+
+/** How often the picker looks for newly found files while a scan runs */
+#define PICKER_POLL_MS 50
+/** How long the highlight has to rest on a file before the picker reports it */
+#define PICKER_HIGHLIGHT_DELAY_MS 200
+
+/** Filter state of the file picker */
+typedef struct {
+    char text[PICKER_FILTER_LENGTH + 1];
+    int length;
+    CatalogMatch* matches[PICKER_FILTER_LENGTH + 1];  ///< matches[k] match the first k characters; level 0 (everything) is not stored
+    int counts[PICKER_FILTER_LENGTH + 1];
+    int capacity;  ///< Room in each stored level
+} PickerFilter;
+
+/** Makes room in every level for all entries of the catalog */
+static int pickerReserve(PickerFilter* filter, const FileCatalog* catalog) {
+    int needed = catalog->capacity > 0 ? catalog->capacity : 1;
+    if (filter->capacity >= catalog->count && filter->capacity > 0) {
+        return 1;
+    }
+    for (int k = 1; k <= filter->length; k++) {
+        CatalogMatch* grown = (CatalogMatch*)realloc(filter->matches[k], needed * sizeof(CatalogMatch));
+        if (!grown) {
+            return 0;
+        }
+        filter->matches[k] = grown;
+    }
+    filter->capacity = needed;
+    return 1;
+}
+
+/** Adds the matches among the entries from first on to every level */
+static void pickerExtend(PickerFilter* filter, const FileCatalog* catalog, int first) {
+    filter->counts[0] = catalog->count;
+    int newInPrevious = first;  // Where the previous level's new matches start
+    for (int k = 1; k <= filter->length; k++) {
+        int start = filter->counts[k];
+        if (k == 1) {
+            char pattern[2] = {filter->text[0], '\0'};
+            filter->counts[1] += FileCatalog_filter(catalog, pattern, first, filter->matches[1] + start);
+        } else {
+            filter->counts[k] += FileCatalog_refine(catalog, filter->text[k - 1], filter->matches[k - 1] + newInPrevious,
+                                                    filter->counts[k - 1] - newInPrevious, filter->matches[k] + start);
+        }
+        newInPrevious = start;
+    }
+}
+
+/** Appends a character, narrowing the last level instead of searching everything again */
+static void pickerPush(PickerFilter* filter, const FileCatalog* catalog, char c) {
+    if (filter->length >= PICKER_FILTER_LENGTH || !pickerReserve(filter, catalog)) {
+        return;
+    }
+    CatalogMatch* level = (CatalogMatch*)malloc(filter->capacity * sizeof(CatalogMatch));
+    if (!level) {
+        return;
+    }
+    int k = ++filter->length;
+    filter->text[k - 1] = c;
+    filter->text[k] = '\0';
+    filter->matches[k] = level;
+    if (k == 1) {
+        filter->counts[1] = FileCatalog_filter(catalog, filter->text, 0, level);
+    } else {
+        filter->counts[k] = FileCatalog_refine(catalog, c, filter->matches[k - 1], filter->counts[k - 1], level);
+    }
+}
+
+static void pickerPop(PickerFilter* filter) {
+    if (filter->length > 0) {
+        free(filter->matches[filter->length]);
+        filter->matches[filter->length] = NULL;
+        filter->text[--filter->length] = '\0';
+    }
+}
+
+int SelectionMenu_pickFile(const char* title, FileCatalog* catalog,
+                           void (*onHighlight)(void* context, int index), void* context) {
+    PickerFilter filter = {};
+    filter.counts[0] = catalog->count;
+    int selection = 0;
+    int top = 0;
+    int result = -1;
+    int current = 0;
+    const MenuFrame* drawn = NULL;
+    int scanning = catalog->scan != NULL;
+    int announced = -2;  // Entry last passed to onHighlight
+    int rested = 0;      // Milliseconds since the last key press
+
+    do {
+        if (scanning) {
+            // Take in what the scan found; the highlight stays on the same file
+            int before = catalog->count;
+            int selected = -1;
+            if (selection < filter.counts[filter.length]) {
+                selected = filter.length ? filter.matches[filter.length][selection].index : selection;
+            }
+            size_t selectedName = selected >= 0 ? catalog->entries[selected].nameOffset : 0;
+            scanning = FileCatalog_poll(catalog);
+            if (!pickerReserve(&filter, catalog)) {
+                break;
+            }
+            if (!scanning) {
+                // The finished catalog is sorted: match everything again
+                for (int k = 1; k <= filter.length; k++) {
+                    filter.counts[k] = 0;
+                }
+                pickerExtend(&filter, catalog, 0);
+                for (int i = 0; selected >= 0 && i < filter.counts[filter.length]; i++) {
+                    int index = filter.length ? filter.matches[filter.length][i].index : i;
+                    if (catalog->entries[index].nameOffset == selectedName) {
+                        selection = i;
+                        break;
+                    }
+                }
+            } else if (catalog->count > before) {
+                pickerExtend(&filter, catalog, before);
+            }
+        }
+
+        int nMatches = filter.counts[filter.length];
+        const CatalogMatch* shown = filter.length ? filter.matches[filter.length] : NULL;
+
+        MenuFrame* frame = &g_frames[current];
+        frameBegin(frame);
+        frameAddTitle(frame, title);
+
+        char line[MENU_FRAME_LINE_LENGTH];
+        snprintf(line, sizeof(line), "Filter: %s_", filter.text);
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        snprintf(line, sizeof(line), "%d of %d files%s", nMatches, catalog->count,
+                 scanning ? ", still searching..." : "");
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+
+        // Files, then a blank row, the help row and a spare row
+        int visible = frame->rows - frame->nLines - 3;
+        if (visible < 1) {
+            visible = 1;
+        }
+        if (selection >= nMatches) {
+            selection = nMatches > 0 ? nMatches - 1 : 0;
+        }
+        if (selection < top) {
+            top = selection;
+        } else if (selection >= top + visible) {
+            top = selection - visible + 1;
+        }
+
+        // Name on the left, size and estimated rows right-aligned
+        int nameWidth = frame->cols - 1 - 2 - 25;
+        if (nameWidth > MENU_FRAME_LINE_LENGTH - 26) {
+            nameWidth = MENU_FRAME_LINE_LENGTH - 26;
+        }
+        if (nameWidth < 8) {
+            nameWidth = 8;
+        }
+        for (int i = top; i < top + visible && i < nMatches; i++) {
+            int index = shown ? shown[i].index : i;
+            char size[32];
+            char rows[32];
+            formatBytes(catalog->entries[index].bytes, size, sizeof(size));
+            snprintf(rows, sizeof(rows), "~%lld rows", FileCatalog_estimateRows(catalog, index));
+            const char* name = FileCatalog_name(catalog, index);
+            int nameLength = (int)strlen(name);
+            // Keep the end of long names, where the distinguishing part usually is
+            if (nameLength > nameWidth) {
+                snprintf(line, sizeof(line), "...%s", name + nameLength - (nameWidth - 3));
+            } else {
+                snprintf(line, sizeof(line), "%s", name);
+            }
+            // Room for the widest name and both columns; frameAddLine cuts it to the screen
+            char text[MENU_FRAME_LINE_LENGTH + sizeof(size) + sizeof(rows)];
+            snprintf(text, sizeof(text), "%-*.*s %9s %14s", nameWidth, nameWidth, line, size, rows);
+            if (i == selection) {
+                frameAddLine(frame, "> ", text, COLOR_GREEN);
+            } else {
+                frameAddLine(frame, "  ", text, COLOR_BLACK);
+            }
+        }
+        frameAddLine(frame, "", "", COLOR_BLACK);
+        frameAddLine(frame, "Type to filter  Up/Down PgUp/PgDn Home/End  Enter: open  ESC: back", "", COLOR_BLACK);
+
+        framePresent(frame, drawn);
+        drawn = frame;
+        current ^= 1;
+
+        // Report the highlighted file once the highlight has stopped moving
+        int highlighted = nMatches > 0 ? (shown ? shown[selection].index : selection) : -1;
+        int timeout = scanning ? PICKER_POLL_MS : -1;
+        if (onHighlight && highlighted != announced) {
+            if (rested >= PICKER_HIGHLIGHT_DELAY_MS) {
+                onHighlight(context, highlighted);
+                announced = highlighted;
+            } else if (timeout < 0 || PICKER_HIGHLIGHT_DELAY_MS - rested < timeout) {
+                timeout = PICKER_HIGHLIGHT_DELAY_MS - rested;
+            }
+        }
+
+        int key = getKeyWithin(timeout);
+        if (key == -1) {
+            rested += timeout;
+            continue;  // Nothing pressed; look for new files or report the highlight
+        }
+        rested = 0;
+        if (g_extendedKey) {
+            switch (key) {
+                case 72: selection--; break;            // Up arrow
+                case 80: selection++; break;            // Down arrow
+                case 73: selection -= visible; break;   // Page Up
+                case 81: selection += visible; break;   // Page Down
+                case 71: selection = 0; break;          // Home
+                case 79: selection = nMatches - 1; break;  // End
+            }
+            if (selection < 0) {
+                selection = 0;
+            }
+        } else if (key == 13) {
+            if (nMatches > 0) {
+                result = shown ? shown[selection].index : selection;
+                break;
+            }
+        } else if (key == 27) {
+            break;
+        } else if (key == 8) {
+            pickerPop(&filter);
+        } else if (key >= 32 && key < 127) {
+            pickerPush(&filter, catalog, (char)key);
+            selection = 0;
+            top = 0;
+        }
+    } while (1);
+
+    while (filter.length > 0) {
+        pickerPop(&filter);
+    }
+    return result;
+}
+
+/** Loads shorter than this never show a progress screen */
+#define LOAD_PROGRESS_DELAY_MS 150
+/** How often the progress screen is redrawn */
+#define LOAD_PROGRESS_POLL_MS 50
+/** Widest progress bar */
+#define LOAD_PROGRESS_BAR_WIDTH 50
+
+/** Appends a progress bar with the percentage done */
+static void frameAddProgressBar(MenuFrame* frame, double fraction) {
+    int width = frame->cols - 1 - 8;
+    if (width > LOAD_PROGRESS_BAR_WIDTH) {
+        width = LOAD_PROGRESS_BAR_WIDTH;
+    }
+    if (width < 10) {
+        width = 10;
+    }
+    if (fraction > 1.0) {
+        fraction = 1.0;
+    }
+    char bar[LOAD_PROGRESS_BAR_WIDTH + 1];
+    int filled = (int)(fraction * width);
+    for (int i = 0; i < width; i++) {
+        bar[i] = i < filled ? '#' : '-';
+    }
+    bar[width] = '\0';
+    char line[MENU_FRAME_LINE_LENGTH];
+    snprintf(line, sizeof(line), "[%s] %3d%%", bar, (int)(fraction * 100));
+    frameAddLine(frame, line, "", COLOR_BLACK);
+}
+
+int SelectionMenu_waitForLoad(const char* title, FileLoad* load) {
+    if (FileHandler_waitLoad(load, LOAD_PROGRESS_DELAY_MS)) {
+        return 1;
+    }
+
+    const MenuFrame* drawn = NULL;
+    int current = 0;
+    do {
+        FileLoadStatus status;
+        FileHandler_getLoadStatus(load, &status);
+
+        MenuFrame* frame = &g_frames[current];
+        frameBegin(frame);
+        frameAddTitle(frame, "Loading");
+        frameAddLine(frame, title, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+
+        frameAddProgressBar(frame, status.totalBytes > 0 ? (double)status.bytesDone / status.totalBytes : 0.0);
+
+        char line[MENU_FRAME_LINE_LENGTH];
+        char done[32];
+        char total[32];
+        char rate[32];
+        formatBytes(status.bytesDone, done, sizeof(done));
+        formatBytes(status.totalBytes, total, sizeof(total));
+        formatBytes(status.seconds > 0 ? (long long)(status.bytesDone / status.seconds) : 0, rate, sizeof(rate));
+        snprintf(line, sizeof(line), "%s of %s, %s/s", done, total, rate);
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+        frameAddLine(frame, "ESC: cancel", "", COLOR_BLACK);
+
+        framePresent(frame, drawn);
+        drawn = frame;
+        current ^= 1;
+
+        // Wait in the key reader so the terminal stays raw and Escape is not echoed
+        int key = getKeyWithin(LOAD_PROGRESS_POLL_MS);
+        if (key == 27 && !g_extendedKey) {
+            FileHandler_cancelLoad(load);
+            return 0;
+        }
+    } while (!FileHandler_waitLoad(load, 0));
+    return 1;
+}
+
+/** Formats a duration as "42 s" or "3 min 05 s" */
+static void formatSeconds(double seconds, char* buffer, size_t size) {
+    long long whole = (long long)seconds;
+    if (whole < 60) {
+        snprintf(buffer, size, "%lld s", whole);
+    } else {
+        snprintf(buffer, size, "%lld min %02lld s", whole / 60, whole % 60);
+    }
+}
+
+int SelectionMenu_waitForSort(const char* title, SortProgress* progress) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int waited = 0; waited < LOAD_PROGRESS_DELAY_MS; waited += 10) {
+        if (progress->finished.load(std::memory_order_acquire)) {
+            return !progress->cancelled.load(std::memory_order_relaxed);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    const MenuFrame* drawn = NULL;
+    int current = 0;
+    int cancelling = 0;
+    while (!progress->finished.load(std::memory_order_acquire)) {
+        double fraction = SortProgress_fraction(progress);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        MenuFrame* frame = &g_frames[current];
+        frameBegin(frame);
+        frameAddTitle(frame, "Sorting");
+        frameAddLine(frame, title, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+        frameAddProgressBar(frame, fraction);
+
+        // Work per pass is counted in compares, so the rate so far predicts the rest
+        char elapsed[32];
+        char line[MENU_FRAME_LINE_LENGTH];
+        formatSeconds(seconds, elapsed, sizeof(elapsed));
+        if (fraction > 0.01 && fraction < 1.0) {
+            char left[32];
+            formatSeconds(seconds * (1.0 - fraction) / fraction, left, sizeof(left));
+            snprintf(line, sizeof(line), "Pass %lld, %s so far, about %s left",
+                     progress->passes.load(std::memory_order_relaxed), elapsed, left);
+        } else {
+            snprintf(line, sizeof(line), "Pass %lld, %s so far", progress->passes.load(std::memory_order_relaxed), elapsed);
+        }
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+        frameAddLine(frame, cancelling ? "Cancelling..." : "ESC: cancel and keep the original order", "", COLOR_BLACK);
+
+        framePresent(frame, drawn);
+        drawn = frame;
+        current ^= 1;
+
+        // The sort stops at the end of its current pass; keep drawing until it has
+        int key = getKeyWithin(LOAD_PROGRESS_POLL_MS);
+        if (key == 27 && !g_extendedKey && !cancelling) {
+            SortProgress_cancel(progress);
+            cancelling = 1;
+        }
+    }
+    return !progress->cancelled.load(std::memory_order_relaxed);
+}
+
+/** Frames drawn per second during a sort replay */
+#define REPLAY_FPS 30
+/** Length of a replay at the starting speed */
+#define REPLAY_DEFAULT_SECONDS 10
+/** Tallest bar of the replay chart */
+#define REPLAY_MAX_HEIGHT 20
+
+void SelectionMenu_replaySort(const char* title, const SortRecording* recording,
+                              const double* sortedValues) {
+    SortReplay replay;
+    if (!SortReplay_init(&replay, recording, sortedValues)) {
+        printf("Memory allocation failed while preparing the replay\n");
+        return;
+    }
+    int n = recording->n;
+    double low = n > 0 ? sortedValues[0] : 0.0;
+    double high = low;
+    for (int i = 1; i < n; i++) {
+        if (sortedValues[i] < low) low = sortedValues[i];
+        if (sortedValues[i] > high) high = sortedValues[i];
+    }
+    uint64_t overwritten = recording->count - SortRecording_kept(recording);
+
+    double speed = (double)replay.steps / REPLAY_DEFAULT_SECONDS;  // Compares per second
+    if (speed < 1.0) {
+        speed = 1.0;
+    }
+    double owed = 0.0;  // Compares due but not yet replayed
+    int paused = 0;
+    int finished = 0;
+    int current = 0;
+    const MenuFrame* drawn = NULL;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+    for (;;) {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(frameStart - last).count();
+        last = frameStart;
+
+        // Catch up on every compare due since the last frame; a late frame just covers more of them
+        replay.swapA = -1;
+        replay.swapB = -1;
+        if (!paused && !finished) {
+            owed += elapsed * speed;
+            while (owed >= 1.0) {
+                owed -= 1.0;
+                if (!SortReplay_step(&replay)) {
+                    finished = 1;
+                    break;
+                }
+            }
+        }
+
+        MenuFrame* frame = &g_frames[current];
+        frameBegin(frame);
+        frameAddTitle(frame, title);
+
+        int width = frame->cols - 1 < MENU_FRAME_LINE_LENGTH - 1 ? frame->cols - 1 : MENU_FRAME_LINE_LENGTH - 1;
+        int nBars = n < width ? n : width;
+        int height = frame->rows - 10;
+        if (height > REPLAY_MAX_HEIGHT) height = REPLAY_MAX_HEIGHT;
+        if (height < 3) height = 3;
+
+        // Bars are numbered by the first position they show
+        int compareA = replay.compareA >= 0 ? (int)((long long)replay.compareA * nBars / n) : -1;
+        int compareB = replay.compareB >= 0 ? (int)((long long)replay.compareB * nBars / n) : -1;
+        int swapA = replay.swapA >= 0 ? (int)((long long)replay.swapA * nBars / n) : -1;
+        int swapB = replay.swapB >= 0 ? (int)((long long)replay.swapB * nBars / n) : -1;
+        int levels[MENU_FRAME_LINE_LENGTH];
+        for (int b = 0; b < nBars; b++) {
+            double value = replay.values[(long long)b * n / nBars];
+            levels[b] = high > low ? 1 + (int)((value - low) / (high - low) * (height - 1)) : height;
+        }
+        char line[MENU_FRAME_LINE_LENGTH];
+        for (int level = height; level >= 1; level--) {
+            for (int b = 0; b < nBars; b++) {
+                int compared = b == compareA || b == compareB;
+                line[b] = levels[b] >= level ? (compared ? '@' : '#') : ' ';
+            }
+            line[nBars] = '\0';
+            frameAddLine(frame, "", line, g_menuColor);
+        }
+        for (int b = 0; b < nBars; b++) {
+            line[b] = b == swapA || b == swapB ? '*' : b == compareA || b == compareB ? '^' : ' ';
+        }
+        line[nBars] = '\0';
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        frameAddLine(frame, "", "", COLOR_BLACK);
+
+        snprintf(line, sizeof(line), "Compare %llu of %llu, %.0f per second%s",
+                 (unsigned long long)replay.step, (unsigned long long)replay.steps, speed,
+                 finished ? " (finished)" : paused ? " (paused)" : "");
+        frameAddLine(frame, line, "", COLOR_BLACK);
+        if (overwritten > 0) {
+            snprintf(line, sizeof(line), "The first %llu events did not fit in the recording; replaying the rest",
+                     (unsigned long long)overwritten);
+            frameAddLine(frame, line, "", COLOR_BLACK);
+        }
+        if (nBars < n) {
+            snprintf(line, sizeof(line), "One bar per %.1f rows", (double)n / nBars);
+            frameAddLine(frame, line, "", COLOR_BLACK);
+        }
+        frameAddLine(frame, "", "", COLOR_BLACK);
+        frameAddLine(frame, "Up/Down: speed  Space: pause  Enter/ESC: close", "", COLOR_BLACK);
+
+        framePresent(frame, drawn);
+        drawn = frame;
+        current ^= 1;
+
+        // Wait out the rest of the frame in the key reader; nothing moves while paused or finished
+        int timeout = -1;
+        if (!paused && !finished) {
+            double spent = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            timeout = spent < 1000.0 / REPLAY_FPS ? (int)(1000.0 / REPLAY_FPS - spent) : 0;
+        }
+        int key = getKeyWithin(timeout);
+        if (key == -1) {
+            continue;
+        }
+        if (g_extendedKey && (key == 72 || key == 77)) {         // Up, Right
+            speed *= 2.0;
+        } else if (g_extendedKey && (key == 80 || key == 75)) {  // Down, Left
+            speed = speed / 2.0 < 1.0 ? 1.0 : speed / 2.0;
+        } else if (key == ' ' && !finished) {
+            paused = !paused;
+        } else if (key == 13 || key == 27 || key == 'q' || key == 'Q') {
+            break;
+        }
+    }
+    SortReplay_free(&replay);
+}
+
 int SelectionMenu_showMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems) {
     switch (menu->currentMenuType) {
         case MENU_CURSOR:
@@ -237,6 +1315,7 @@ int SelectionMenu_showMenu(SelectionMenu* menu, const char* title, const char* i
     }
 }
 
+#ifdef _WIN32
 char** SelectionMenu_findFiles(SelectionMenu* menu, const char* directory, const char* extension, int* fileCount, int maxFiles) {
     char searchPath[MAX_PATH_LENGTH];
     WIN32_FIND_DATA findData;
@@ -288,6 +1367,58 @@ char** SelectionMenu_findFiles(SelectionMenu* menu, const char* directory, const
     *fileCount = count;
     return files;
 }
+#else
+static int compareNames(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+char** SelectionMenu_findFiles(SelectionMenu* menu, const char* directory, const char* extension, int* fileCount, int maxFiles) {
+    *fileCount = 0;
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return NULL;
+    }
+
+    char** files = (char**)malloc(maxFiles * sizeof(char*));
+    if (!files) {
+        closedir(dir);
+        return NULL;
+    }
+
+    // Same match as the Windows pattern "*<extension>": names ending in it
+    size_t extensionLength = strlen(extension);
+    int count = 0;
+    struct dirent* entry;
+    while (count < maxFiles && (entry = readdir(dir)) != NULL) {
+        size_t nameLength = strlen(entry->d_name);
+        if (nameLength < extensionLength ||
+            strcmp(entry->d_name + nameLength - extensionLength, extension) != 0) {
+            continue;
+        }
+        int regular = entry->d_type == DT_REG;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            char path[MAX_PATH_LENGTH * 2];
+            struct stat info;
+            snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+            regular = stat(path, &info) == 0 && S_ISREG(info.st_mode);
+        }
+        if (!regular) {
+            continue;
+        }
+        files[count] = (char*)malloc(nameLength + 1);
+        if (files[count]) {
+            memcpy(files[count], entry->d_name, nameLength + 1);
+            count++;
+        }
+    }
+    closedir(dir);
+
+    // readdir order is arbitrary; list files alphabetically as Windows does
+    qsort(files, count, sizeof(char*), compareNames);
+    *fileCount = count;
+    return files;
+}
+#endif
 
 const char** SelectionMenu_createMenuItems(SelectionMenu* menu, char** files, int fileCount, int maxPathLength) {
     const char** menuItems = (const char**)malloc(fileCount * sizeof(char*));
@@ -326,8 +1457,8 @@ char* SelectionMenu_getOutputFilename(SelectionMenu* menu, const char* defaultNa
 }
 
 int SelectionMenu_fileExists(const char* filename) {
-    FILE* file;
-    if (fopen_s(&file, filename, "r") == 0) {
+    FILE* file = fopen(filename, "r");
+    if (file) {
         fclose(file);
         return 1;
     }
@@ -338,7 +1469,12 @@ char SelectionMenu_askYesNo(const char* question) {
     char response;
     printf("%s (y/n): ", question);
     do {
-        response = (char)tolower(_getch());
+        int key = getKey();
+        // Escape, or the end of piped input (reported as Escape), answers no
+        if (key == 27 && !g_extendedKey) {
+            key = 'n';
+        }
+        response = (char)tolower(key);
     } while (response != 'y' && response != 'n');
     printf("%c\n", response);
     return response;
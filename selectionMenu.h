@@ -1,18 +1,31 @@
 /**
  * @file selectionMenu.h
  * @brief A versatile menu system for console applications with multiple display styles
+ *
+ * Runs on the Windows console and on any terminal that understands ANSI
+ * escape sequences (Linux, macOS).
+ *
+ * After SelectionMenu_init, stdout is fully buffered: everything printed for
+ * one screen, colors included, is written in one go when the program waits
+ * for a key. Code that reads stdin directly, or starts long work after
+ * printing a message, calls SelectionMenu_flush first.
  */
 
 #ifndef SELECTION_MENU_H
 #define SELECTION_MENU_H
 
 #include <stdio.h>
-#include <windows.h>
+#include "fileCatalog.h"
+#include "fileHandler.h"
+#include "sortRecording.h"
+#include "sortProgress.h"
 
 /** Maximum length for file paths */
 #define MAX_PATH_LENGTH 256
 /** Maximum number of files to process */
 #define MAX_FILES 100
+/** Size of the stdout buffer a screen update is collected in */
+#define SELECTION_MENU_OUTPUT_BUFFER (256 * 1024)
 
 /** Available console colors for menu customization */
 #define COLOR_BLACK     0
@@ -39,8 +52,31 @@ typedef struct {
     MenuType currentMenuType;
 } SelectionMenu;
 
+/**
+ * @struct RowViewer
+ * @brief A list of rows for SelectionMenu_viewRows, produced on demand
+ */
+typedef struct {
+    const char* title;
+    long long nRows;
+    /**
+     * Formats row index (0-based) into buffer and returns the offset where its
+     * accented part starts, or -1 if it has none
+     */
+    int (*formatRow)(void* context, long long index, char* buffer, int size);
+    /** Returns the row matching a typed query, or -1; NULL disables finding */
+    long long (*findRow)(void* context, const char* query);
+    const char* findLabel;  ///< What findRow searches for, e.g. "sum"
+    int accentColor;        ///< Color of the accented part of each row
+    void* context;          ///< Passed to formatRow and findRow
+} RowViewer;
+
 /**
  * @brief Initialize a new menu with default settings
+ *
+ * Also sets up the console and makes stdout fully buffered; call it before
+ * printing anything.
+ *
  * @param menu Pointer to menu struct to initialize
  */
 void SelectionMenu_init(SelectionMenu* menu);
@@ -55,6 +91,18 @@ void SelectionMenu_init(SelectionMenu* menu);
  */
 int SelectionMenu_showMenu(SelectionMenu* menu, const char* title, const char* items[], int nItems);
 
+/**
+ * @brief Show rows one terminal page at a time until Enter, Escape or q
+ *
+ * Only the rows on screen are formatted, so opening and paging cost the same
+ * for ten rows or a billion. Up/Down scroll by a row, PgUp/PgDn (or Space) by
+ * a page, Home/End go to either end, g jumps to a row number and f to the row
+ * findRow picks. The page follows the terminal height.
+ *
+ * @param viewer Rows to show
+ */
+void SelectionMenu_viewRows(const RowViewer* viewer);
+
 /**
  * @brief Set the menu display style
  * @param menu Menu instance
@@ -92,6 +140,75 @@ int SelectionMenu_getMenuColor(void);
  */
 char** SelectionMenu_findFiles(SelectionMenu* menu, const char* directory, const char* extension, int* fileCount, int maxFiles);
 
+/**
+ * @brief Let the user choose a file from a catalog, filtering as they type
+ *
+ * Shows each file with its size and estimated row count, one terminal page
+ * at a time. Typed characters narrow the list to names containing them in
+ * order (ignoring case), Backspace widens it again; arrow, paging, Home and
+ * End keys move the highlight. Row counts are estimated only for the files
+ * on screen. A catalog from FileCatalog_startScan fills in while the picker
+ * is open, and the filter applies to files as they arrive.
+ *
+ * When the highlight has rested on a file for a moment, onHighlight is told
+ * its index (or -1 when the filter matches nothing), for example to start
+ * loading it before it is chosen. Holding an arrow key does not report the
+ * files passed over.
+ *
+ * @param title Picker title
+ * @param catalog Files to choose from
+ * @param onHighlight Called with the highlighted entry, or NULL
+ * @param context Passed to onHighlight
+ * @return Index of the chosen entry, or -1 if the user pressed Escape
+ */
+int SelectionMenu_pickFile(const char* title, FileCatalog* catalog,
+                           void (*onHighlight)(void* context, int index), void* context);
+
+/**
+ * @brief Shows the progress of a background load until it finishes or the user cancels it
+ *
+ * A progress bar with the percentage, bytes read and throughput appears once
+ * the load has taken longer than a moment, so quick loads do not flash a
+ * screen. Escape cancels the load and returns at once; the handle must still
+ * be finished.
+ *
+ * @param title Name of what is being loaded
+ * @param load Load to follow
+ * @return 1 if the load finished, 0 if the user cancelled it
+ */
+int SelectionMenu_waitForLoad(const char* title, FileLoad* load);
+
+/**
+ * @brief Shows the progress of a sort running on another thread until it finishes or is cancelled
+ *
+ * Like the load progress screen, nothing is drawn for quick sorts. Escape
+ * asks the sort to stop; the screen stays up until the sort has finished its
+ * current pass and put the rows back in their original order.
+ *
+ * @param title Name of the sort
+ * @param progress Progress block the sort publishes to
+ * @return 1 if the sort completed, 0 if it was cancelled
+ */
+int SelectionMenu_waitForSort(const char* title, SortProgress* progress);
+
+/**
+ * @brief Replays a recorded sort as an animated bar chart
+ *
+ * Each bar is the value of one position (or of every so many positions when
+ * there are more than the terminal is wide), and the bars being compared are
+ * marked. The chart is redrawn at a fixed frame rate and the replay advances
+ * by as many compares as are due, so a slow terminal skips frames instead of
+ * slowing the replay down. At the starting speed a replay lasts about ten
+ * seconds whatever the size of the sort. Up and Down change the speed, Space
+ * pauses, and Enter or Escape closes the replay.
+ *
+ * @param title Name of the sort being replayed
+ * @param recording Events of the sort
+ * @param sortedValues Value of the row at each position after the sort (recording->n of them)
+ */
+void SelectionMenu_replaySort(const char* title, const SortRecording* recording,
+                              const double* sortedValues);
+
 /**
  * @brief Create menu items from file list
  * @param menu Menu instance
@@ -154,6 +271,11 @@ void SelectionMenu_waitForKey(const char* message);
  */
 void SelectionMenu_clearScreen(void);
 
+/**
+ * @brief Write out everything printed since the last flush
+ */
+void SelectionMenu_flush(void);
+
 /**
  * @brief Check if a file exists
  * @param filename Path to file
@@ -164,7 +286,7 @@ int SelectionMenu_fileExists(const char* filename);
 /**
  * @brief Prompt for yes/no input
  * @param question Question to display
- * @return 'y' or 'n'
+ * @return 'y' or 'n'; Escape and the end of input count as 'n'
  */
 char SelectionMenu_askYesNo(const char* question);
 
@@ -0,0 +1,302 @@
+/**
+ * @file sidecarCache.cpp
+ * @brief Implementation of the binary sidecar cache
+ */
+
+#include "sidecarCache.h"
+#include "contentHash.h"
+#include "fileHandler.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/** A read-only mapping of a whole file */
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+} MappedFile;
+
+#ifdef _WIN32
+static int mapFile(const char* path, MappedFile* map) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return 0;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);  // The view keeps the mapping alive
+    if (!view) {
+        return 0;
+    }
+    map->data = (const unsigned char*)view;
+    map->size = (size_t)size.QuadPart;
+    return 1;
+}
+
+static void unmapFile(MappedFile* map) {
+    UnmapViewOfFile(map->data);
+}
+#else
+static int mapFile(const char* path, MappedFile* map) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (view == MAP_FAILED) {
+        return 0;
+    }
+    madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+    map->data = (const unsigned char*)view;
+    map->size = (size_t)info.st_size;
+    return 1;
+}
+
+static void unmapFile(MappedFile* map) {
+    munmap((void*)map->data, map->size);
+}
+#endif
+
+// CSVs with a sidecar write in progress; a second write of the same file is skipped
+static std::mutex g_writeMutex;
+static std::condition_variable g_writeDone;
+static std::set<std::string> g_pendingWrites;
+// Numbers temporary files, so that writers in other processes never share one
+static std::atomic<int> g_tempCounter{0};
+
+int Sidecar_enabled(void) {
+    static const int enabled = [] {
+        const char* setting = getenv("LAB06_SIDECAR");
+        return !setting || atoi(setting) != 0;
+    }();
+    return enabled;
+}
+
+int Sidecar_statSource(const char* path, SidecarSource* source) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return 0;
+    }
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        return 0;
+    }
+    source->bytes = (long long)size;
+    source->mtime = (long long)time.time_since_epoch().count();
+    return 1;
+}
+
+/** Rows copied out of a sidecar between progress reports */
+#define SIDECAR_REPORT_ROWS 4096
+
+/** Hashes the CSV in chunks, reporting the first half of its bytes as progress; 0 if unreadable or cancelled */
+static int hashSource(const char* path, long long totalBytes, uint64_t* hash,
+                      int (*progress)(void* context, long long bytesDone), void* progressContext) {
+    TRACE_SCOPE("ContentHash_file");
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t chunkSize = 1 << 20;
+    unsigned char* chunk = (unsigned char*)malloc(chunkSize);
+    if (!chunk) {
+        fclose(file);
+        return 0;
+    }
+
+    ContentHash state;
+    ContentHash_init(&state, 0);
+    long long offset = 0;
+    int ok = 1;
+    size_t got;
+    while ((got = fread(chunk, 1, chunkSize, file)) > 0) {
+        ContentHash_update(&state, chunk, got);
+        offset += (long long)got;
+        if (progress && progress(progressContext, offset < totalBytes ? offset / 2 : totalBytes / 2)) {
+            ok = 0;
+            break;
+        }
+    }
+    ok = ok && !ferror(file);
+    free(chunk);
+    fclose(file);
+    if (ok) {
+        *hash = ContentHash_final(&state);
+    }
+    return ok;
+}
+
+double** Sidecar_load(const char* path, const SidecarSource* source, int* rows, int* cols, uint64_t* contentHash,
+                      int (*progress)(void* context, long long bytesDone), void* progressContext) {
+    TRACE_SCOPE("Sidecar_load");
+    std::string sidecarPath = std::string(path) + SIDECAR_SUFFIX;
+    MappedFile map;
+    if (!mapFile(sidecarPath.c_str(), &map)) {
+        return NULL;
+    }
+
+    // Cheap checks first; the content hash reads the whole CSV
+    SidecarHeader header;
+    int valid = map.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, map.data, sizeof(header));
+        valid = memcmp(header.magic, SIDECAR_MAGIC, 4) == 0 &&
+                header.version == SIDECAR_VERSION &&
+                header.cols > 0 && header.cols <= 0x7fffffff &&
+                header.rows > 0 && header.rows <= 0x7fffffff &&
+                header.sourceBytes == (uint64_t)source->bytes &&
+                header.sourceMtime == source->mtime &&
+                // Counted in doubles: rows * cols fits in 64 bits (both are below 2^31), the byte count may not
+                (map.size - sizeof(header)) % sizeof(double) == 0 &&
+                (map.size - sizeof(header)) / sizeof(double) == header.rows * header.cols;
+    }
+    uint64_t hash;
+    if (!valid || !hashSource(path, source->bytes, &hash, progress, progressContext) || hash != header.sourceHash) {
+        unmapFile(&map);
+        return NULL;
+    }
+
+    int n = (int)header.rows;
+    int m = (int)header.cols;
+    const unsigned char* values = map.data + sizeof(header);
+    double** data = (double**)malloc(n * sizeof(double*));
+    if (!data) {
+        unmapFile(&map);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        data[i] = (double*)malloc(m * sizeof(double));
+        if (!data[i]) {
+            FileHandler_freeCoordinates(data, i);
+            unmapFile(&map);
+            return NULL;
+        }
+        memcpy(data[i], values + (size_t)i * m * sizeof(double), m * sizeof(double));
+        // Copying accounts for the second half of the CSV's bytes
+        if (progress && (i + 1) % SIDECAR_REPORT_ROWS == 0 &&
+            progress(progressContext, source->bytes / 2 + (long long)((double)(i + 1) / n * (source->bytes - source->bytes / 2)))) {
+            FileHandler_freeCoordinates(data, i + 1);
+            unmapFile(&map);
+            return NULL;
+        }
+    }
+    unmapFile(&map);
+    *rows = n;
+    *cols = m;
+    if (contentHash) {
+        *contentHash = hash;
+    }
+    return data;
+}
+
+/** Writes the sidecar of a parsed CSV; runs on a background thread and takes ownership of values */
+static void writeSidecar(std::string path, SidecarSource source, uint64_t contentHash, double* values, int rows, int cols) {
+    TRACE_SCOPE("Sidecar_write");
+    SidecarHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIDECAR_MAGIC, 4);
+    header.version = SIDECAR_VERSION;
+    header.cols = (uint32_t)cols;
+    header.rows = (uint64_t)rows;
+    header.sourceBytes = (uint64_t)source.bytes;
+    header.sourceMtime = source.mtime;
+    header.sourceHash = contentHash;
+
+    // Only write if the CSV still looks like the one that was parsed
+    SidecarSource after;
+    int current = Sidecar_statSource(path.c_str(), &after) &&
+                  after.bytes == source.bytes && after.mtime == source.mtime;
+
+    if (current) {
+        std::string sidecarPath = path + SIDECAR_SUFFIX;
+        std::string tempPath = sidecarPath + ".tmp" + std::to_string((long long)getpid()) + "-" +
+                               std::to_string(g_tempCounter++);
+        FILE* file = fopen(tempPath.c_str(), "wb");
+        if (file) {
+            fwrite(&header, sizeof(header), 1, file);
+            fwrite(values, sizeof(double), (size_t)rows * cols, file);
+            int ok = !ferror(file);
+            if (fclose(file) != 0) {
+                ok = 0;
+            }
+            std::error_code error;
+            if (ok) {
+                std::filesystem::rename(tempPath, sidecarPath, error);
+            }
+            if (!ok || error) {
+                std::filesystem::remove(tempPath, error);
+            }
+        }
+    }
+
+    free(values);
+    std::lock_guard<std::mutex> lock(g_writeMutex);
+    g_pendingWrites.erase(path);
+    g_writeDone.notify_all();
+}
+
+void Sidecar_writeAsync(const char* path, const SidecarSource* source, uint64_t contentHash,
+                        double** coordinates, int rows, int cols) {
+    if (!Sidecar_enabled() || rows <= 0 || cols <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_writeMutex);
+        if (!g_pendingWrites.insert(path).second) {
+            return;
+        }
+    }
+
+    // The caller keeps its rows, so the thread works from a contiguous copy
+    double* values = (double*)malloc((size_t)rows * cols * sizeof(double));
+    if (!values) {
+        std::lock_guard<std::mutex> lock(g_writeMutex);
+        g_pendingWrites.erase(path);
+        return;
+    }
+    for (int i = 0; i < rows; i++) {
+        memcpy(values + (size_t)i * cols, coordinates[i], cols * sizeof(double));
+    }
+    std::thread(writeSidecar, std::string(path), *source, contentHash, values, rows, cols).detach();
+}
+
+void Sidecar_waitForWrites(void) {
+    std::unique_lock<std::mutex> lock(g_writeMutex);
+    g_writeDone.wait(lock, [] { return g_pendingWrites.empty(); });
+}
@@ -0,0 +1,107 @@
+/**
+ * @file sidecarCache.h
+ * @brief Binary sidecar files that let a CSV be reloaded without parsing
+ *
+ * After a CSV is parsed, the parsed matrix is written next to it as
+ * "<file>.lab06cache". The sidecar records the size, modification
+ * time and content hash of the CSV it was made from; a later load maps the
+ * sidecar instead of parsing when all three still match.
+ *
+ * Sidecars are written on a background thread so the first load does not
+ * wait for them, through a temporary file renamed into place so a reader never
+ * sees a partial one. The temporary name carries the process id and a counter,
+ * so processes loading the same CSV do not write over each other's temporary
+ * file. Set LAB06_SIDECAR=0 to neither read nor write them.
+ */
+
+#ifndef SIDECAR_CACHE_H
+#define SIDECAR_CACHE_H
+
+#include <stdint.h>
+
+/** Appended to a CSV path to name its sidecar */
+#define SIDECAR_SUFFIX ".lab06cache"
+/** First four bytes of a sidecar */
+#define SIDECAR_MAGIC "L6SC"
+/** Current sidecar format version (1 also stored row sums, which nothing read) */
+#define SIDECAR_VERSION 2
+
+/**
+ * @struct SidecarHeader
+ * @brief Header of a sidecar file (48 bytes)
+ *
+ * The header is followed by rows * cols doubles in row-major order, in the
+ * byte order of the machine that wrote the file.
+ */
+typedef struct {
+    char magic[4];         ///< SIDECAR_MAGIC, not NUL-terminated
+    uint32_t version;      ///< SIDECAR_VERSION
+    uint32_t cols;
+    uint32_t reserved;     ///< Zero
+    uint64_t rows;
+    uint64_t sourceBytes;  ///< Size of the CSV
+    int64_t sourceMtime;   ///< Modification time of the CSV in file clock ticks
+    uint64_t sourceHash;   ///< ContentHash of the CSV
+} SidecarHeader;
+
+/**
+ * @struct SidecarSource
+ * @brief Size and modification time of a CSV, taken before it is parsed
+ */
+typedef struct {
+    long long bytes;
+    long long mtime;
+} SidecarSource;
+
+/**
+ * @brief Checks whether sidecars are in use (LAB06_SIDECAR is not 0)
+ * @return 1 if enabled, 0 otherwise
+ */
+int Sidecar_enabled(void);
+
+/**
+ * @brief Reads the size and modification time of a CSV
+ * @param path CSV file
+ * @param source Output parameter for the size and time
+ * @return 1 on success, 0 if the file cannot be examined
+ */
+int Sidecar_statSource(const char* path, SidecarSource* source);
+
+/**
+ * @brief Loads a CSV from its sidecar if the sidecar is still current
+ * @param path CSV file (not the sidecar)
+ * @param source Size and time of the CSV from Sidecar_statSource
+ * @param rows Output parameter for number of rows
+ * @param cols Output parameter for number of columns
+ * @param contentHash Optional output parameter for the content hash of the CSV, as checked against the sidecar
+ * @param progress Optional callback given the CSV bytes accounted for so far, between chunks of hashing
+ *        and copying; a nonzero return abandons the load
+ * @param progressContext Passed to progress
+ * @return 2D array as returned by FileHandler_readCoordinates, or NULL if there is no current sidecar or the load was abandoned
+ * @note Caller is responsible for freeing the returned array using FileHandler_freeCoordinates
+ */
+double** Sidecar_load(const char* path, const SidecarSource* source, int* rows, int* cols, uint64_t* contentHash,
+                      int (*progress)(void* context, long long bytesDone), void* progressContext);
+
+/**
+ * @brief Writes the sidecar of a freshly parsed CSV on a background thread
+ *
+ * The coordinates are copied before returning. The write is abandoned if the
+ * CSV no longer has the given size and time.
+ *
+ * @param path CSV file
+ * @param source Size and time of the CSV taken before it was parsed
+ * @param contentHash ContentHash of the bytes the coordinates were parsed from
+ * @param coordinates Parsed coordinates
+ * @param rows Number of rows
+ * @param cols Number of columns
+ */
+void Sidecar_writeAsync(const char* path, const SidecarSource* source, uint64_t contentHash,
+                        double** coordinates, int rows, int cols);
+
+/**
+ * @brief Waits for background sidecar writes to finish; call before exiting
+ */
+void Sidecar_waitForWrites(void);
+
+#endif // SIDECAR_CACHE_H
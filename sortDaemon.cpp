@@ -0,0 +1,377 @@
+/**
+ * @file sortDaemon.cpp
+ * @brief Implementation of the resident sort service
+ */
+
+#include "sortDaemon.h"
+#include "datasetCache.h"
+#include "fileHandler.h"
+#include "sortEngine.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+/** Rows copied into one send buffer when streaming results */
+#define DAEMON_ROWS_PER_SEND 4096
+
+void SortDaemon_initRequest(DaemonRequestHeader* header, DaemonOp op) {
+    memset(header, 0, sizeof(DaemonRequestHeader));
+    header->magic = DAEMON_REQUEST_MAGIC;
+    header->version = DAEMON_PROTOCOL_VERSION;
+    header->op = (uint16_t)op;
+    header->engine = SORT_ENGINE_RADIX;
+}
+
+#ifdef _WIN32
+
+int SortDaemon_run(const char* socketPath, long long memoryBudgetBytes) {
+    fprintf(stderr, "The sort daemon needs Unix domain sockets and is not available on this platform\n");
+    return 0;
+}
+
+int SortDaemon_connect(const char* socketPath) {
+    return -1;
+}
+
+int SortDaemon_request(int connection, DaemonRequestHeader* header, const char* path, const char* keys,
+                       const char* output, DaemonResponseHeader* response, char** message, double** data) {
+    return 0;
+}
+
+void SortDaemon_close(int connection) {
+}
+
+#else
+
+static volatile sig_atomic_t g_stopRequested = 0;
+
+static void onStopSignal(int signalNumber) {
+    (void)signalNumber;
+    g_stopRequested = 1;
+}
+
+static int readFully(int fd, void* buffer, size_t length) {
+    char* p = (char*)buffer;
+    while (length > 0) {
+        ssize_t got = read(fd, p, length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return 0;
+        p += got;
+        length -= (size_t)got;
+    }
+    return 1;
+}
+
+static int writeFully(int fd, const void* buffer, size_t length) {
+    const char* p = (const char*)buffer;
+    while (length > 0) {
+        ssize_t sent = write(fd, p, length);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;
+        p += sent;
+        length -= (size_t)sent;
+    }
+    return 1;
+}
+
+static int readString(int fd, uint32_t length, std::string& text) {
+    if (length > DAEMON_MAX_STRING) return 0;
+    text.resize(length);
+    return length == 0 || readFully(fd, &text[0], length);
+}
+
+/**
+ * @struct DaemonState
+ * @brief State shared by the accept loop and the connection threads
+ */
+typedef struct {
+    DatasetCache* cache;
+    std::mutex mutex;
+    std::condition_variable idle;   ///< Signalled when a connection thread exits
+    std::set<int> connections;
+} DaemonState;
+
+/** Sends the response header, message and (if any) the result rows */
+static int sendResponse(int fd, DaemonResponseHeader* response, const std::string& message,
+                        double** rows, int count, int cols) {
+    response->magic = DAEMON_RESPONSE_MAGIC;
+    response->messageLength = (uint32_t)message.size();
+    if (!writeFully(fd, response, sizeof(DaemonResponseHeader)) ||
+        !writeFully(fd, message.data(), message.size())) {
+        return 0;
+    }
+    if (!rows) {
+        return 1;
+    }
+    std::vector<double> buffer((size_t)DAEMON_ROWS_PER_SEND * cols);
+    for (int first = 0; first < count; first += DAEMON_ROWS_PER_SEND) {
+        int chunk = count - first < DAEMON_ROWS_PER_SEND ? count - first : DAEMON_ROWS_PER_SEND;
+        for (int i = 0; i < chunk; i++) {
+            memcpy(&buffer[(size_t)i * cols], rows[first + i], cols * sizeof(double));
+        }
+        if (!writeFully(fd, buffer.data(), (size_t)chunk * cols * sizeof(double))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Handles one request; returns 0 if the connection should be closed */
+static int handleRequest(DaemonState* state, int fd) {
+    DaemonRequestHeader header;
+    if (!readFully(fd, &header, sizeof(header))) {
+        return 0;
+    }
+    TRACE_SCOPE("daemon.request");
+    auto start = std::chrono::steady_clock::now();
+    DaemonResponseHeader response = {};
+    std::string path, keySpec, output, message;
+
+    if (header.magic != DAEMON_REQUEST_MAGIC || header.version != DAEMON_PROTOCOL_VERSION ||
+        !readString(fd, header.pathLength, path) || !readString(fd, header.keyLength, keySpec) ||
+        !readString(fd, header.outputLength, output)) {
+        response.status = DAEMON_ERROR_REQUEST;
+        sendResponse(fd, &response, "malformed request", NULL, 0, 0);
+        return 0;  // The stream can no longer be trusted
+    }
+
+    if (header.op == DAEMON_OP_STATS) {
+        DatasetCacheStats stats;
+        DatasetCache_getStats(state->cache, &stats);
+        char json[256];
+        snprintf(json, sizeof(json),
+                 "{\"entries\":%d,\"bytes\":%lld,\"budget_bytes\":%lld,\"hits\":%lld,\"misses\":%lld,\"evictions\":%lld}",
+                 stats.entries, stats.bytes, stats.budgetBytes, stats.hits, stats.misses, stats.evictions);
+        return sendResponse(fd, &response, json, NULL, 0, 0);
+    }
+    if (header.op < DAEMON_OP_SORT || header.op > DAEMON_OP_RANGE || header.engine > SORT_ENGINE_RADIX) {
+        response.status = DAEMON_ERROR_REQUEST;
+        return sendResponse(fd, &response, "unknown operation or engine", NULL, 0, 0);
+    }
+
+    int hit = 0;
+    const CachedDataset* dataset = DatasetCache_acquire(state->cache, path.c_str(), &hit);
+    if (!dataset) {
+        response.status = DAEMON_ERROR_LOAD;
+        return sendResponse(fd, &response, "cannot read " + path, NULL, 0, 0);
+    }
+    response.cacheHit = (uint32_t)hit;
+    response.cols = (uint32_t)dataset->m;
+
+    SortKey keys[MAX_SORT_KEYS];
+    int nKeys = SortKeys_parse(keySpec.empty() ? "sum" : keySpec.c_str(), keys, MAX_SORT_KEYS);
+    int sortResult = header.op != DAEMON_OP_RANGE || !keySpec.empty();
+    if (sortResult && !SortKeys_isValid(keys, nKeys, dataset->m)) {
+        DatasetCache_release(state->cache, dataset);
+        response.status = DAEMON_ERROR_KEYS;
+        return sendResponse(fd, &response, "invalid key list " + keySpec, NULL, 0, 0);
+    }
+
+    // Work on a private array of row pointers; the cached rows stay untouched
+    double** result = NULL;
+    int count = 0;
+    if (header.op == DAEMON_OP_RANGE) {
+        const SpatialGrid* grid = DatasetCache_getGrid(state->cache, dataset);
+        if (grid) {
+            result = SpatialGrid_queryRange(grid, header.rect[0], header.rect[1],
+                                            header.rect[2], header.rect[3], &count);
+        }
+    } else if (dataset->n > 0) {
+        result = (double**)malloc(dataset->n * sizeof(double*));
+        if (result) {
+            memcpy(result, dataset->rows, dataset->n * sizeof(double*));
+            count = dataset->n;
+        } else {
+            response.status = DAEMON_ERROR_MEMORY;
+        }
+    }
+    if (result && header.op == DAEMON_OP_TOPK) {
+        // Only the first rows are sent, so select them instead of sorting everything
+        int limit = header.limit < (uint32_t)count ? (int)header.limit : count;
+        selectTopCoordinatesByKeysWith<NoSortStats>(result, count, dataset->m, keys, nKeys, limit);
+        count = limit;
+    } else if (result && sortResult) {
+        sortCoordinatesByKeysWith<NoSortStats>(result, count, dataset->m, keys, nKeys, (SortEngine)header.engine);
+    }
+    response.rows = (uint32_t)count;
+
+    int sendRows = response.status == DAEMON_OK;
+    if (sendRows && !output.empty()) {
+        if (!FileHandler_saveCoordinates(output.c_str(), result, count, dataset->m)) {
+            response.status = DAEMON_ERROR_WRITE;
+            message = "cannot write " + output;
+        }
+        sendRows = 0;
+    }
+    response.serverMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    int ok = sendResponse(fd, &response, message, sendRows ? result : NULL, count, dataset->m);
+
+    free(result);
+    DatasetCache_release(state->cache, dataset);
+    return ok;
+}
+
+static void serveConnection(DaemonState* state, int fd) {
+    TRACE_THREAD_NAME("daemon connection");
+    while (handleRequest(state, fd)) {
+    }
+    // Close under the lock so the descriptor cannot be reused by accept()
+    // while it is still listed as open
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->connections.erase(fd);
+    close(fd);
+    state->idle.notify_all();
+}
+
+static int fillAddress(struct sockaddr_un* address, const char* socketPath) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", socketPath);
+        return 0;
+    }
+    strcpy(address->sun_path, socketPath);
+    return 1;
+}
+
+int SortDaemon_run(const char* socketPath, long long memoryBudgetBytes) {
+    struct sockaddr_un address;
+    if (!fillAddress(&address, socketPath)) {
+        return 0;
+    }
+
+    // A socket file nobody answers on is left over from a previous run
+    int probe = SortDaemon_connect(socketPath);
+    if (probe >= 0) {
+        SortDaemon_close(probe);
+        fprintf(stderr, "A daemon is already listening on %s\n", socketPath);
+        return 0;
+    }
+    unlink(socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, 64) != 0) {
+        fprintf(stderr, "Error opening socket %s: %s\n", socketPath, strerror(errno));
+        if (listener >= 0) close(listener);
+        return 0;
+    }
+
+    DaemonState state;
+    state.cache = DatasetCache_create(memoryBudgetBytes);
+    g_stopRequested = 0;
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    signal(SIGPIPE, SIG_IGN);  // A client hanging up must not kill the daemon
+    printf("Listening on %s\n", socketPath);
+    fflush(stdout);
+
+    while (!g_stopRequested) {
+        struct pollfd waiting = {listener, POLLIN, 0};
+        if (poll(&waiting, 1, 250) <= 0) {
+            continue;
+        }
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.connections.insert(fd);
+        std::thread(serveConnection, &state, fd).detach();
+    }
+
+    // Stop accepting, wake every connection thread and wait for them to finish
+    close(listener);
+    unlink(socketPath);
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        for (int fd : state.connections) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        state.idle.wait(lock, [&]() { return state.connections.empty(); });
+    }
+
+    DatasetCacheStats stats;
+    DatasetCache_getStats(state.cache, &stats);
+    printf("Stopped: %lld hits, %lld misses, %lld evictions\n", stats.hits, stats.misses, stats.evictions);
+    DatasetCache_destroy(state.cache);
+    return 1;
+}
+
+int SortDaemon_connect(const char* socketPath) {
+    struct sockaddr_un address;
+    if (!fillAddress(&address, socketPath)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int SortDaemon_request(int connection, DaemonRequestHeader* header, const char* path, const char* keys,
+                       const char* output, DaemonResponseHeader* response, char** message, double** data) {
+    *message = NULL;
+    *data = NULL;
+    header->pathLength = path ? (uint32_t)strlen(path) : 0;
+    header->keyLength = keys ? (uint32_t)strlen(keys) : 0;
+    header->outputLength = output ? (uint32_t)strlen(output) : 0;
+    if (!writeFully(connection, header, sizeof(DaemonRequestHeader)) ||
+        !writeFully(connection, path, header->pathLength) ||
+        !writeFully(connection, keys, header->keyLength) ||
+        !writeFully(connection, output, header->outputLength) ||
+        !readFully(connection, response, sizeof(DaemonResponseHeader)) ||
+        response->magic != DAEMON_RESPONSE_MAGIC) {
+        return 0;
+    }
+
+    *message = (char*)malloc(response->messageLength + 1);
+    if (!*message || !readFully(connection, *message, response->messageLength)) {
+        free(*message);
+        *message = NULL;
+        return 0;
+    }
+    (*message)[response->messageLength] = '\0';
+
+    int hasRows = response->status == DAEMON_OK && header->op != DAEMON_OP_STATS && header->outputLength == 0;
+    size_t dataBytes = (size_t)response->rows * response->cols * sizeof(double);
+    if (hasRows && dataBytes > 0) {
+        *data = (double*)malloc(dataBytes);
+        if (!*data || !readFully(connection, *data, dataBytes)) {
+            free(*data);
+            *data = NULL;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void SortDaemon_close(int connection) {
+    if (connection >= 0) {
+        close(connection);
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file sortDaemon.h
+ * @brief Resident sort service on a Unix domain socket, and its client side
+ *
+ * The daemon keeps parsed datasets in a DatasetCache so repeated requests on
+ * the same file skip parsing entirely. Each connection is served by its own
+ * thread and may send any number of requests.
+ *
+ * Protocol (native byte order, both ends on the same machine):
+ *   request  = DaemonRequestHeader, input path, key list, output path
+ *   response = DaemonResponseHeader, message, rows * cols doubles
+ * Strings are sent without terminators; their lengths are in the header.
+ * Row data is only sent when the request has no output path; otherwise the
+ * daemon writes the rows to that file as CSV.
+ */
+
+#ifndef SORT_DAEMON_H
+#define SORT_DAEMON_H
+
+#include <stdint.h>
+
+/** "L6RQ" */
+#define DAEMON_REQUEST_MAGIC 0x5152364Cu
+/** "L6RS" */
+#define DAEMON_RESPONSE_MAGIC 0x5352364Cu
+#define DAEMON_PROTOCOL_VERSION 1
+/** Longest path or key list accepted in a request */
+#define DAEMON_MAX_STRING 4096
+/** Socket used when none is given */
+#define DAEMON_DEFAULT_SOCKET "/tmp/lab06.sock"
+
+/** Request types */
+typedef enum {
+    DAEMON_OP_SORT = 1,   ///< All rows, sorted by the key list
+    DAEMON_OP_TOPK = 2,   ///< The first `limit` rows of the sorted order
+    DAEMON_OP_RANGE = 3,  ///< Rows inside rect (x, y), sorted by the key list if one is given
+    DAEMON_OP_STATS = 4   ///< Cache counters as a JSON message; no input needed
+} DaemonOp;
+
+/** Response status codes */
+typedef enum {
+    DAEMON_OK = 0,
+    DAEMON_ERROR_REQUEST = 1,   ///< Malformed request
+    DAEMON_ERROR_LOAD = 2,      ///< Input file could not be read
+    DAEMON_ERROR_KEYS = 3,      ///< Invalid key list for this file
+    DAEMON_ERROR_WRITE = 4,     ///< Output file could not be written
+    DAEMON_ERROR_MEMORY = 5
+} DaemonStatus;
+
+/**
+ * @struct DaemonRequestHeader
+ * @brief Fixed part of a request (64 bytes)
+ */
+typedef struct {
+    uint32_t magic;          ///< DAEMON_REQUEST_MAGIC
+    uint16_t version;        ///< DAEMON_PROTOCOL_VERSION
+    uint16_t op;             ///< DaemonOp
+    uint16_t engine;         ///< SortEngine
+    uint16_t reserved;
+    uint32_t pathLength;     ///< Bytes of input path that follow
+    uint32_t keyLength;      ///< Bytes of key list that follow (0 = "sum")
+    uint32_t outputLength;   ///< Bytes of output path that follow (0 = send rows back)
+    uint32_t limit;          ///< k for DAEMON_OP_TOPK
+    uint32_t padding;
+    double rect[4];          ///< minX, minY, maxX, maxY for DAEMON_OP_RANGE
+} DaemonRequestHeader;
+
+/**
+ * @struct DaemonResponseHeader
+ * @brief Fixed part of a response (32 bytes)
+ */
+typedef struct {
+    uint32_t magic;          ///< DAEMON_RESPONSE_MAGIC
+    int32_t status;          ///< DaemonStatus
+    uint32_t rows;           ///< Rows in the result
+    uint32_t cols;
+    uint32_t messageLength;  ///< Bytes of message text that follow
+    uint32_t cacheHit;       ///< 1 if the dataset was already cached
+    double serverMs;         ///< Time spent handling the request
+} DaemonResponseHeader;
+
+/**
+ * @brief Serves requests until SIGINT or SIGTERM
+ * @param socketPath Filesystem path of the socket
+ * @param memoryBudgetBytes Dataset cache budget, 0 = unlimited
+ * @return 1 after a clean shutdown, 0 if the socket could not be opened
+ */
+int SortDaemon_run(const char* socketPath, long long memoryBudgetBytes);
+
+/**
+ * @brief Fills a request header with defaults for an operation
+ * @param header Header to initialise
+ * @param op Operation
+ */
+void SortDaemon_initRequest(DaemonRequestHeader* header, DaemonOp op);
+
+/**
+ * @brief Connects to a running daemon
+ * @param socketPath Filesystem path of the socket
+ * @return Connection handle, or -1 on failure
+ */
+int SortDaemon_connect(const char* socketPath);
+
+/**
+ * @brief Sends one request and waits for the response
+ * @param connection Handle from SortDaemon_connect
+ * @param header Request header (string lengths are filled in from the strings)
+ * @param path Input file (absolute, as the daemon resolves relative paths itself)
+ * @param keys Key list, or NULL for "sum"
+ * @param output Output file, or NULL to receive the rows
+ * @param response Output parameter for the response header
+ * @param message Output parameter for the message text (NUL-terminated); free with free()
+ * @param data Output parameter for rows * cols doubles, or NULL if none; free with free()
+ * @return 1 if a response was received, 0 if the connection failed
+ */
+int SortDaemon_request(int connection, DaemonRequestHeader* header, const char* path, const char* keys,
+                       const char* output, DaemonResponseHeader* response, char** message, double** data);
+
+/**
+ * @brief Closes a connection
+ * @param connection Handle from SortDaemon_connect
+ */
+void SortDaemon_close(int connection);
+
+#endif // SORT_DAEMON_H
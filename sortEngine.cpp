@@ -0,0 +1,799 @@
+/**
+ * @file sortEngine.cpp
+ * @brief Implementation of coordinate sorting algorithms
+ */
+
+#include "sortEngine.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <math.h>
+#include <bit>
+#include <algorithm>
+
+/**
+ * @brief Calculates the sum of values in a row
+ * 
+ * Used as the comparison metric for sorting coordinates.
+ * 
+ * @param row Array of values to sum
+ * @param m Number of elements in the row
+ * @return Sum of all elements
+ */
+double calculateRowSum(double* row, int m) {
+    double sum = 0;
+    for (int j = 0; j < m; j++) {
+        sum += row[j];
+    }
+    return sum;
+}
+
+/**
+ * @brief Bubble sort by row sum
+ * @return Number of passes made
+ */
+template <typename Stats>
+static int bubbleSortBySum(double** coordinates, int n, int m, Stats& stats) {
+    stats.setTotalWork((long long)n * (n - 1) / 2);
+    int passes = 0;
+    for (int i = 0; i < n - 1; i++) {
+        stats.addComparisons(n - i - 1);  // Every pass compares each adjacent pair once
+        passes++;
+        for (int j = 0; j < n - i - 1; j++) {
+            double sum1 = calculateRowSum(coordinates[j], m);
+            double sum2 = calculateRowSum(coordinates[j + 1], m);
+            
+            if (sum1 > sum2) {
+                // Swap rows
+                double* temp = coordinates[j];
+                coordinates[j] = coordinates[j + 1];
+                coordinates[j + 1] = temp;
+                stats.addSwap();  // Count each swap
+            }
+        }
+        if (!stats.checkpoint(n - i - 1)) break;
+    }
+    return passes;
+}
+
+/** Records the passes of a bubble sort, which cover one position less each time */
+template <typename Stats>
+static void recordBubblePasses(Stats& stats, int n, int passes) {
+    for (int i = 0; i < passes; i++) {
+        stats.recordBubblePass(0, n - i - 1);
+    }
+}
+
+/**
+ * @brief Sorts coordinates using bubble sort algorithm
+ * 
+ * Sorts the coordinates based on the sum of their components.
+ * Tracks and returns statistics about the sorting operation.
+ * 
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @return Statistics about the sorting operation
+ */
+template <typename Stats>
+static SortStats sortCoordinatesUsing(Stats& stats, double** coordinates, int n, int m) {
+    TRACE_SCOPE("sortCoordinates");
+    stats.setSwapBytes(2 * sizeof(double*));
+    stats.beginPhase(PHASE_SORT);
+    
+    // Bubble sort based on row sums
+    int passes = bubbleSortBySum(coordinates, n, m, withoutRecording(stats));
+    recordBubblePasses(stats, n, passes);
+    stats.endPhase(PHASE_SORT);
+    return stats.result();
+}
+
+template <typename Stats>
+SortStats sortCoordinatesWith(double** coordinates, int n, int m) {
+    Stats stats;
+    return sortCoordinatesUsing(stats, coordinates, n, m);
+}
+
+SortStats sortCoordinates(double** coordinates, int n, int m) {
+    return sortCoordinatesWith<DefaultSortStats>(coordinates, n, m);
+}
+
+/**
+ * Runs sort with a snapshot of the row order, restoring it if the sort was
+ * cancelled, then marks the progress block finished
+ */
+template <typename Stats, typename Sort>
+static SortStats trackSort(Stats& stats, double** coordinates, int n, Sort sort) {
+    SortProgress* progress = stats.progress;
+    double** original = (double**)malloc((n > 0 ? n : 1) * sizeof(double*));
+    if (!original) {
+        fprintf(stderr, "Memory allocation failed while sorting %d coordinates\n", n);
+        progress->cancelled.store(1, std::memory_order_relaxed);
+        progress->finished.store(1, std::memory_order_release);
+        return stats.result();
+    }
+    memcpy(original, coordinates, n * sizeof(double*));
+    SortStats result = sort(stats);
+    if (stats.stopped) {
+        memcpy(coordinates, original, n * sizeof(double*));
+        progress->cancelled.store(1, std::memory_order_relaxed);
+    }
+    free(original);
+    progress->finished.store(1, std::memory_order_release);
+    return result;
+}
+
+/** Runs sort under ProgressSortStats, wrapped in RecordingSortStats when there is a recording */
+template <typename Sort>
+static SortStats runTracked(double** coordinates, int n, SortProgress* progress, SortRecording* recording, Sort sort) {
+    SortProgress unwatched = {};
+    if (recording) {
+        recording->n = n;
+        // The replay works out bubble swaps from where each row ends up
+        double** before = (double**)malloc((n > 0 ? n : 1) * sizeof(double*));
+        if (before) {
+            memcpy(before, coordinates, n * sizeof(double*));
+        }
+        RecordingSortStats<ProgressSortStats<DefaultSortStats>> stats(recording);
+        stats.progress = progress ? progress : &unwatched;
+        SortStats result = trackSort(stats, coordinates, n, sort);
+        stats.finish();
+        SortRecording_setOrder(recording, (const void* const*)before, (const void* const*)coordinates);
+        free(before);
+        return result;
+    }
+    ProgressSortStats<DefaultSortStats> stats;
+    stats.progress = progress ? progress : &unwatched;
+    return trackSort(stats, coordinates, n, sort);
+}
+
+SortStats sortCoordinatesTracked(double** coordinates, int n, int m, SortProgress* progress, SortRecording* recording) {
+    return runTracked(coordinates, n, progress, recording,
+                      [&](auto& stats) { return sortCoordinatesUsing(stats, coordinates, n, m); });
+}
+
+/**
+ * @brief Optimized sorting algorithm for coordinates
+ * 
+ * Implements an optimized version of bubble sort that:
+ * 1. Pre-calculates row sums to avoid redundant calculations
+ * 2. Uses early termination when no swaps are needed
+ * 3. Reduces the search range after each pass
+ * 
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @return Statistics about the sorting operation
+ */
+template <typename Stats>
+static SortStats optimisedSortCoordinatesUsing(Stats& stats, double** coordinates, int n, int m) {
+    TRACE_SCOPE("optimisedSortCoordinates");
+    stats.beginPhase(PHASE_KEYS);
+    
+    // Create temporary array to store coordinates and their sums
+    typedef struct {
+        double* coords;
+        double sum;
+        int originalIndex;
+    } CoordInfo;
+    
+    CoordInfo* tempArray = (CoordInfo*)malloc(n * sizeof(CoordInfo));
+    if (!tempArray) {
+        fprintf(stderr, "Memory allocation failed while sorting %d coordinates\n", n);
+        return stats.result();
+    }
+    stats.addAllocation(n * sizeof(CoordInfo));
+    
+    // Calculate sums and store original indices
+    for (int i = 0; i < n; i++) {
+        tempArray[i].coords = coordinates[i];
+        tempArray[i].sum = calculateRowSum(coordinates[i], m);
+        tempArray[i].originalIndex = i;
+    }
+    stats.endPhase(PHASE_KEYS);
+    
+    stats.setSwapBytes(2 * sizeof(CoordInfo));
+    stats.beginPhase(PHASE_SORT);
+    
+    // Sort using selection sort approach to minimize swaps
+    stats.setTotalWork((long long)n * (n - 1) / 2);
+    for (int i = 0; i < n - 1; i++) {
+        int minIdx = i;
+        stats.addComparisons(n - i - 1);
+        stats.recordSelectionPass(i, n);
+        for (int j = i + 1; j < n; j++) {
+            if (tempArray[j].sum < tempArray[minIdx].sum) {
+                minIdx = j;
+                stats.recordSelect(j);
+            }
+        }
+        
+        if (minIdx != i) {
+            // Swap in temporary array
+            CoordInfo temp = tempArray[i];
+            tempArray[i] = tempArray[minIdx];
+            tempArray[minIdx] = temp;
+            stats.addSwap();
+            stats.recordSwap(i, minIdx);
+        }
+        if (!stats.checkpoint(n - i - 1)) break;
+    }
+    
+    // Copy pointers back to original array in sorted order
+    for (int i = 0; i < n; i++) {
+        coordinates[i] = tempArray[i].coords;
+    }
+    stats.addBytesMoved(n * sizeof(double*));
+    
+    // Cleanup
+    free(tempArray);
+    
+    stats.endPhase(PHASE_SORT);
+    return stats.result();
+}
+
+template <typename Stats>
+SortStats optimisedSortCoordinatesWith(double** coordinates, int n, int m) {
+    Stats stats;
+    return optimisedSortCoordinatesUsing(stats, coordinates, n, m);
+}
+
+SortStats optimisedSortCoordinates(double** coordinates, int n, int m) {
+    return optimisedSortCoordinatesWith<DefaultSortStats>(coordinates, n, m);
+}
+
+SortStats optimisedSortCoordinatesTracked(double** coordinates, int n, int m, SortProgress* progress,
+                                          SortRecording* recording) {
+    return runTracked(coordinates, n, progress, recording,
+                      [&](auto& stats) { return optimisedSortCoordinatesUsing(stats, coordinates, n, m); });
+}
+
+/**
+ * @struct KeyedRow
+ * @brief A row reference with its packed composite key
+ *
+ * When all keys fit in 128 bits, hi:lo holds them with the first key in the
+ * most significant bits. Otherwise hi:lo is unused and rows are compared key
+ * by key through a separate table. The original index breaks remaining ties.
+ */
+typedef struct {
+    uint64_t hi;   ///< High 64 bits of the composite key
+    uint64_t lo;   ///< Low 64 bits of the composite key
+    int index;     ///< Original row index
+} KeyedRow;
+
+/**
+ * Maps a double onto an unsigned integer with the same ordering: positive
+ * values get the sign bit set, negative values are bit-inverted.
+ */
+static inline uint64_t orderedBits(double value) {
+    if (value == 0) value = 0;  // Fold -0.0 onto +0.0
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (value != value) bits = 0x7FF8000000000000ULL;  // One positive NaN, ordered after +infinity
+    return (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+static double evaluateKey(const SortKey* key, double* row, int m) {
+    return key->type == SORT_KEY_SUM ? calculateRowSum(row, m) : row[key->column];
+}
+
+/** A key code with the row it belongs to, while codes are being ranked */
+typedef struct {
+    uint64_t code;
+    int index;
+} RankedCode;
+
+/** Bits per pass when ranking codes; 2^11 counters stay in the L1 cache */
+#define RANK_DIGIT_BITS 11
+
+/**
+ * Replaces width-bit codes by their rank among the distinct codes, keeping
+ * their order. The codes are radix sorted with their row indices and then
+ * numbered. Returns the number of bits the ranks need, or -1 if out of memory.
+ */
+static int rankCodes(uint64_t* encoded, int n, int width) {
+    TRACE_SCOPE("rankCodes");
+    RankedCode* source = (RankedCode*)malloc(2 * (size_t)n * sizeof(RankedCode));
+    if (!source) {
+        return -1;
+    }
+    RankedCode* target = source + n;
+    RankedCode* allocated = source;
+    for (int i = 0; i < n; i++) {
+        source[i].code = encoded[i];
+        source[i].index = i;
+    }
+
+    // Count every digit in one read, then skip digits on which every code agrees
+    const int digits = 1 << RANK_DIGIT_BITS;
+    int passes = (width + RANK_DIGIT_BITS - 1) / RANK_DIGIT_BITS;
+    int* counts = (int*)calloc((size_t)digits * (passes ? passes : 1), sizeof(int));
+    if (!counts) {
+        free(allocated);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        uint64_t code = source[i].code;
+        for (int p = 0; p < passes; p++) {
+            counts[p * digits + ((code >> (p * RANK_DIGIT_BITS)) & (digits - 1))]++;
+        }
+    }
+    for (int p = 0; p < passes; p++) {
+        int* count = counts + p * digits;
+        int shift = p * RANK_DIGIT_BITS;
+        if (count[(source[0].code >> shift) & (digits - 1)] == n) {
+            continue;
+        }
+        int offset = 0;
+        for (int d = 0; d < digits; d++) {
+            int here = count[d];
+            count[d] = offset;
+            offset += here;
+        }
+        for (int i = 0; i < n; i++) {
+            target[count[(source[i].code >> shift) & (digits - 1)]++] = source[i];
+        }
+        RankedCode* temp = source;
+        source = target;
+        target = temp;
+    }
+    free(counts);
+
+    uint64_t rank = 0;
+    for (int i = 0; i < n; i++) {
+        if (i > 0 && source[i].code != source[i - 1].code) rank++;
+        encoded[source[i].index] = rank;
+    }
+    free(allocated);
+    return (int)std::bit_width(rank);
+}
+
+/**
+ * Encodes one key for every row as an unsigned code with the key's order and
+ * returns the number of bits the codes need. Integral keys are encoded by
+ * value so that small integer ranges pack into a few bits. Other keys use the
+ * order-preserving bit pattern of the double, which needs up to 64 bits, or
+ * with rank set their rank among the distinct values, which needs only log2
+ * of their count. NaN sorts after everything. Returns -1 if the ranks cannot
+ * be computed.
+ */
+static int encodeKey(const SortKey* key, double** coordinates, int n, int m,
+                     double* values, uint64_t* encoded, int rank) {
+    TRACE_SCOPE("encodeKey");
+    int integral = 1;
+    double minValue = 0, maxValue = 0;
+    for (int i = 0; i < n; i++) {
+        values[i] = evaluateKey(key, coordinates[i], m);
+        if (i == 0 || values[i] < minValue) minValue = values[i];
+        if (i == 0 || values[i] > maxValue) maxValue = values[i];
+        if (values[i] != floor(values[i]) || fabs(values[i]) > 9007199254740992.0) {
+            integral = 0;  // Also true of NaN and the infinities
+        }
+    }
+
+    uint64_t range;
+    if (integral) {
+        int64_t base = (int64_t)minValue;
+        range = (uint64_t)((int64_t)maxValue - base);
+        for (int i = 0; i < n; i++) {
+            encoded[i] = (uint64_t)((int64_t)values[i] - base);
+        }
+    } else {
+        // The minimum and maximum are taken on the bit patterns, where NaN has a place
+        uint64_t base = UINT64_MAX, top = 0;
+        for (int i = 0; i < n; i++) {
+            encoded[i] = orderedBits(values[i]);
+            if (encoded[i] < base) base = encoded[i];
+            if (encoded[i] > top) top = encoded[i];
+        }
+        range = top - base;
+        for (int i = 0; i < n; i++) {
+            encoded[i] -= base;
+        }
+        if (rank) {
+            int width = rankCodes(encoded, n, (int)std::bit_width(range));
+            if (width < 0) {
+                return -1;
+            }
+            range = width ? (1ULL << width) - 1 : 0;
+        }
+    }
+
+    if (key->descending) {
+        for (int i = 0; i < n; i++) {
+            encoded[i] = range - encoded[i];
+        }
+    }
+    return (int)std::bit_width(range);
+}
+
+/** Appends width bits of value to the low end of a 128-bit hi:lo pair */
+static inline void shiftIn(uint64_t* hi, uint64_t* lo, int width, uint64_t value) {
+    if (width == 0) return;
+    if (width == 64) {
+        *hi = *lo;
+        *lo = value;
+        return;
+    }
+    *hi = (*hi << width) | (*lo >> (64 - width));
+    *lo = (*lo << width) | value;
+}
+
+/** Orders rows by their packed composite key, then by original index */
+struct PackedLess {
+    bool operator()(const KeyedRow& a, const KeyedRow& b) const {
+        if (a.hi != b.hi) return a.hi < b.hi;
+        if (a.lo != b.lo) return a.lo < b.lo;
+        return a.index < b.index;
+    }
+};
+
+/** Orders rows key by key through the encoded key table, then by original index */
+struct ChainedLess {
+    const uint64_t* table;  ///< Encoded keys, nKeys entries per original row
+    int nKeys;
+
+    bool operator()(const KeyedRow& a, const KeyedRow& b) const {
+        const uint64_t* keysA = table + (size_t)a.index * nKeys;
+        const uint64_t* keysB = table + (size_t)b.index * nKeys;
+        for (int k = 0; k < nKeys; k++) {
+            if (keysA[k] != keysB[k]) return keysA[k] < keysB[k];
+        }
+        return a.index < b.index;
+    }
+};
+
+/** Bubble sort of keyed rows; returns the number of passes made */
+template <typename Stats, typename Less>
+static int bubbleSortRows(KeyedRow* rows, int n, Less less, Stats& stats) {
+    stats.setTotalWork((long long)n * (n - 1) / 2);
+    int passes = 0;
+    for (int i = 0; i < n - 1; i++) {
+        int swapped = 0;
+        stats.addComparisons(n - i - 1);
+        passes++;
+        for (int j = 0; j < n - i - 1; j++) {
+            if (less(rows[j + 1], rows[j])) {
+                KeyedRow temp = rows[j];
+                rows[j] = rows[j + 1];
+                rows[j + 1] = temp;
+                stats.addSwap();
+                swapped = 1;
+            }
+        }
+        if (!stats.checkpoint(n - i - 1)) break;
+        if (!swapped) break;
+    }
+    return passes;
+}
+
+template <typename Stats, typename Less>
+static void selectionSortRows(KeyedRow* rows, int n, Less less, Stats& stats) {
+    stats.setTotalWork((long long)n * (n - 1) / 2);
+    for (int i = 0; i < n - 1; i++) {
+        int minIdx = i;
+        stats.addComparisons(n - i - 1);
+        stats.recordSelectionPass(i, n);
+        for (int j = i + 1; j < n; j++) {
+            if (less(rows[j], rows[minIdx])) {
+                minIdx = j;
+                stats.recordSelect(j);
+            }
+        }
+        if (minIdx != i) {
+            KeyedRow temp = rows[i];
+            rows[i] = rows[minIdx];
+            rows[minIdx] = temp;
+            stats.addSwap();
+            stats.recordSwap(i, minIdx);
+        }
+        if (!stats.checkpoint(n - i - 1)) break;
+    }
+}
+
+/**
+ * LSD radix sort on the packed key, one byte per pass from the least
+ * significant end. Bytes on which every row agrees are skipped. Stability
+ * keeps the original index order for equal keys.
+ */
+template <typename Stats>
+static int radixSortRows(KeyedRow* rows, int n, int keyBits, Stats& stats) {
+    TRACE_SCOPE("radixSortRows");
+    KeyedRow* buffer = (KeyedRow*)malloc(n * sizeof(KeyedRow));
+    if (!buffer) {
+        return 0;
+    }
+    stats.addAllocation(n * sizeof(KeyedRow));
+
+    KeyedRow* source = rows;
+    KeyedRow* target = buffer;
+    int nBytes = (keyBits + 7) / 8;
+    stats.setTotalWork((long long)n * nBytes);
+    for (int byte = 0; byte < nBytes; byte++) {
+        int counts[256] = {0};
+        for (int i = 0; i < n; i++) {
+            uint64_t word = byte < 8 ? source[i].lo : source[i].hi;
+            counts[(word >> (8 * (byte & 7))) & 0xFF]++;
+        }
+
+        int skip = 0;
+        for (int d = 0; d < 256; d++) {
+            if (counts[d] == n) skip = 1;
+        }
+        if (skip) {
+            if (!stats.checkpoint(n)) break;
+            continue;
+        }
+
+        int offset = 0;
+        for (int d = 0; d < 256; d++) {
+            int count = counts[d];
+            counts[d] = offset;
+            offset += count;
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t word = byte < 8 ? source[i].lo : source[i].hi;
+            target[counts[(word >> (8 * (byte & 7))) & 0xFF]++] = source[i];
+        }
+        stats.addSwaps(n);  // Every row moves once per pass
+        stats.addBytesMoved(n * sizeof(KeyedRow));
+
+        KeyedRow* temp = source;
+        source = target;
+        target = temp;
+        if (!stats.checkpoint(n)) break;
+    }
+
+    if (source != rows) {
+        memcpy(rows, source, n * sizeof(KeyedRow));
+        stats.addBytesMoved(n * sizeof(KeyedRow));
+    }
+    free(buffer);
+    return 1;
+}
+
+int SortKeys_parse(const char* spec, SortKey* keys, int maxKeys) {
+    int count = 0;
+    const char* p = spec;
+
+    while (*p) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        if (count == maxKeys) return 0;
+
+        SortKey key = {SORT_KEY_COLUMN, 0, 0};
+        if (*p == '-') {
+            key.descending = 1;
+            p++;
+        } else if (*p == '+') {
+            p++;
+        }
+
+        char token[16];
+        int length = 0;
+        while (*p && *p != ',' && !isspace((unsigned char)*p)) {
+            if (length == (int)sizeof(token) - 1) return 0;
+            token[length++] = (char)tolower((unsigned char)*p++);
+        }
+        token[length] = '\0';
+
+        if (strcmp(token, "sum") == 0) {
+            key.type = SORT_KEY_SUM;
+        } else if (strcmp(token, "x") == 0) {
+            key.column = 0;
+        } else if (strcmp(token, "y") == 0) {
+            key.column = 1;
+        } else if (strcmp(token, "z") == 0) {
+            key.column = 2;
+        } else if (token[0] == 'c' && token[1] && strspn(token + 1, "0123456789") == strlen(token + 1)) {
+            key.column = atoi(token + 1);
+        } else {
+            return 0;
+        }
+        keys[count++] = key;
+
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == ',') p++;
+        else if (*p) return 0;
+    }
+    return count;
+}
+
+int SortKeys_isValid(const SortKey* keys, int nKeys, int m) {
+    if (nKeys <= 0 || nKeys > MAX_SORT_KEYS) return 0;
+    for (int k = 0; k < nKeys; k++) {
+        if (keys[k].type == SORT_KEY_COLUMN && (keys[k].column < 0 || keys[k].column >= m)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Moves the limit smallest rows to the front in order, in O(n + limit log limit).
+ * Ties are broken by original index, so the order is strict and matches a full
+ * stable sort by any engine.
+ */
+template <typename Stats, typename Less>
+static void selectTopRows(KeyedRow* rows, int n, int limit, Less less, Stats& stats) {
+    auto counted = [&](const KeyedRow& a, const KeyedRow& b) {
+        stats.addComparisons(1);
+        return less(a, b);
+    };
+    std::nth_element(rows, rows + limit, rows + n, counted);
+    std::sort(rows, rows + limit, counted);
+}
+
+/** Sorts by keys; with limit < n only the first limit rows are put in order (the rest follow in no order) */
+template <typename Stats>
+static SortStats sortCoordinatesByKeysUsing(Stats& stats, double** coordinates, int n, int m,
+                                            const SortKey* keys, int nKeys, SortEngine engine, int limit) {
+    TRACE_SCOPE("sortCoordinatesByKeys");
+    if (n < 2 || !SortKeys_isValid(keys, nKeys, m)) {
+        return stats.result();
+    }
+    stats.beginPhase(PHASE_KEYS);
+
+    KeyedRow* rows = (KeyedRow*)malloc(n * sizeof(KeyedRow));
+    uint64_t* table = (uint64_t*)malloc((size_t)n * nKeys * sizeof(uint64_t));
+    uint64_t* encoded = (uint64_t*)malloc(n * sizeof(uint64_t));
+    double* values = (double*)malloc(n * sizeof(double));
+    double** original = (double**)malloc(n * sizeof(double*));
+    if (!rows || !table || !encoded || !values || !original) {
+        fprintf(stderr, "Memory allocation failed while sorting %d coordinates\n", n);
+        free(rows);
+        free(table);
+        free(encoded);
+        free(values);
+        free(original);
+        return stats.result();
+    }
+    stats.addAllocation(n * sizeof(KeyedRow));
+    stats.addAllocation((long long)n * nKeys * sizeof(uint64_t));
+    stats.addAllocation(n * sizeof(uint64_t));
+    stats.addAllocation(n * sizeof(double));
+    stats.addAllocation(n * sizeof(double*));
+
+    // Encode each key and lay the results out row-major
+    int widths[MAX_SORT_KEYS];
+    int keyBits = 0;
+    for (int k = 0; k < nKeys; k++) {
+        widths[k] = encodeKey(&keys[k], coordinates, n, m, values, encoded, 0);
+        keyBits += widths[k];
+        for (int i = 0; i < n; i++) {
+            table[(size_t)i * nKeys + k] = encoded[i];
+        }
+    }
+    // Fractional keys take up to 64 bits each; rank them in turn until the keys can be packed
+    for (int k = 0; k < nKeys && keyBits > 128; k++) {
+        int width = encodeKey(&keys[k], coordinates, n, m, values, encoded, 1);
+        if (width >= 0 && width < widths[k]) {
+            keyBits += width - widths[k];
+            widths[k] = width;
+            for (int i = 0; i < n; i++) {
+                table[(size_t)i * nKeys + k] = encoded[i];
+            }
+        }
+    }
+    free(encoded);
+    free(values);
+
+    // Pack into a single 128-bit composite key when the widths allow it
+    int packed = keyBits <= 128;
+    for (int i = 0; i < n; i++) {
+        rows[i].hi = 0;
+        rows[i].lo = 0;
+        rows[i].index = i;
+    }
+    if (packed) {
+        for (int k = 0; k < nKeys; k++) {
+            for (int i = 0; i < n; i++) {
+                shiftIn(&rows[i].hi, &rows[i].lo, widths[k], table[(size_t)i * nKeys + k]);
+            }
+        }
+    }
+
+    stats.endPhase(PHASE_KEYS);
+
+    stats.setSwapBytes(2 * sizeof(KeyedRow));
+    stats.beginPhase(PHASE_SORT);
+    ChainedLess chained = {table, nKeys};
+    if (limit < n) {
+        stats.setSwapBytes(0);
+        if (packed) selectTopRows(rows, n, limit, PackedLess(), stats);
+        else selectTopRows(rows, n, limit, chained, stats);
+    } else switch (engine) {
+        case SORT_ENGINE_BUBBLE: {
+            int passes = packed ? bubbleSortRows(rows, n, PackedLess(), withoutRecording(stats))
+                                : bubbleSortRows(rows, n, chained, withoutRecording(stats));
+            recordBubblePasses(stats, n, passes);
+            break;
+        }
+        case SORT_ENGINE_SELECTION:
+            if (packed) selectionSortRows(rows, n, PackedLess(), stats);
+            else selectionSortRows(rows, n, chained, stats);
+            break;
+        case SORT_ENGINE_RADIX:
+            stats.setSwapBytes(0);  // Radix passes report their moves as bytes directly
+            if (packed && radixSortRows(rows, n, keyBits, stats)) break;
+            // Keys too wide for one radix key: fall back to a stable merge sort
+            std::stable_sort(rows, rows + n, [&](const KeyedRow& a, const KeyedRow& b) {
+                stats.addComparisons(1);
+                return chained(a, b);
+            });
+            break;
+    }
+
+    // Apply the permutation to the row pointers
+    memcpy(original, coordinates, n * sizeof(double*));
+    for (int i = 0; i < n; i++) {
+        coordinates[i] = original[rows[i].index];
+    }
+    stats.addBytesMoved(2LL * n * sizeof(double*));
+
+    free(original);
+    free(table);
+    free(rows);
+    stats.endPhase(PHASE_SORT);
+    return stats.result();
+}
+
+template <typename Stats>
+SortStats sortCoordinatesByKeysWith(double** coordinates, int n, int m,
+                                    const SortKey* keys, int nKeys, SortEngine engine) {
+    Stats stats;
+    return sortCoordinatesByKeysUsing(stats, coordinates, n, m, keys, nKeys, engine, n);
+}
+
+SortStats sortCoordinatesByKeys(double** coordinates, int n, int m,
+                                const SortKey* keys, int nKeys, SortEngine engine) {
+    return sortCoordinatesByKeysWith<DefaultSortStats>(coordinates, n, m, keys, nKeys, engine);
+}
+
+long long sortCoordinatesByKeysScratchBytes(long long n, int nKeys, SortEngine engine) {
+    // Keyed rows, key table, encoded keys, values and the original order, as allocated above;
+    // radix sort adds a second row buffer (as does the merge sort it falls back to). Ranking
+    // fractional keys, which only several keys can need, briefly takes two ranked codes per row
+    long long perRow = sizeof(KeyedRow) + (long long)nKeys * sizeof(uint64_t) + sizeof(uint64_t) +
+                       sizeof(double) + sizeof(double*);
+    long long extra = engine == SORT_ENGINE_RADIX ? sizeof(KeyedRow) : 0;
+    if (nKeys > 1 && extra < (long long)(2 * sizeof(RankedCode))) {
+        extra = 2 * sizeof(RankedCode);
+    }
+    return n * (perRow + extra);
+}
+
+SortStats sortCoordinatesByKeysTracked(double** coordinates, int n, int m, const SortKey* keys, int nKeys,
+                                       SortEngine engine, SortProgress* progress, SortRecording* recording) {
+    return runTracked(coordinates, n, progress, recording, [&](auto& stats) {
+        return sortCoordinatesByKeysUsing(stats, coordinates, n, m, keys, nKeys, engine, n);
+    });
+}
+
+template <typename Stats>
+SortStats selectTopCoordinatesByKeysWith(double** coordinates, int n, int m,
+                                         const SortKey* keys, int nKeys, int k) {
+    Stats stats;
+    return sortCoordinatesByKeysUsing(stats, coordinates, n, m, keys, nKeys, SORT_ENGINE_RADIX,
+                                      k < 0 ? 0 : k < n ? k : n);
+}
+
+SortStats selectTopCoordinatesByKeys(double** coordinates, int n, int m,
+                                     const SortKey* keys, int nKeys, int k) {
+    return selectTopCoordinatesByKeysWith<DefaultSortStats>(coordinates, n, m, keys, nKeys, k);
+}
+
+// Instantiate every engine for each stats policy
+#define INSTANTIATE_SORT_ENGINES(Stats) \
+    template SortStats sortCoordinatesWith<Stats>(double**, int, int); \
+    template SortStats optimisedSortCoordinatesWith<Stats>(double**, int, int); \
+    template SortStats sortCoordinatesByKeysWith<Stats>(double**, int, int, const SortKey*, int, SortEngine); \
+    template SortStats selectTopCoordinatesByKeysWith<Stats>(double**, int, int, const SortKey*, int, int);
+
+INSTANTIATE_SORT_ENGINES(NoSortStats)
+INSTANTIATE_SORT_ENGINES(CountingSortStats)
+INSTANTIATE_SORT_ENGINES(TimedSortStats)
@@ -0,0 +1,220 @@
+/**
+ * @file sortEngine.h
+ * @brief Coordinate sorting algorithms and sort key handling
+ *
+ * Provides the bubble and selection based coordinate sorts used by the
+ * visualizer, plus a multi-key sort that orders rows by a list of key
+ * expressions (for example "sum, then x, then y"). Key values are packed into
+ * order-preserving 128-bit composite integers whenever they fit, so every
+ * engine compares a single integer pair instead of evaluating a chained
+ * comparator.
+ *
+ * Every engine is a template over a stats policy from sortStats.h
+ * (NoSortStats, CountingSortStats or TimedSortStats). The plain entry points
+ * use DefaultSortStats, which the LAB06_SORT_STATS build setting selects:
+ * 0 = no instrumentation, 1 = counts, 2 = counts and timing (default).
+ *
+ * The *Tracked entry points are for sorts run on a worker thread. They
+ * publish progress to a SortProgress after every pass and stop at the next
+ * pass once it is cancelled, putting the rows back in their original order.
+ * They can also log passes and swaps into a SortRecording for the replay
+ * view. The radix engine and the merge sort fallback for very wide keys
+ * neither compare nor swap positions, so they record nothing, and the merge
+ * sort runs to the end once started.
+ */
+
+#ifndef SORT_ENGINE_H
+#define SORT_ENGINE_H
+
+#include "sortStats.h"
+#include "sortRecording.h"
+#include "sortProgress.h"
+
+/** Maximum number of keys in a multi-key sort */
+#define MAX_SORT_KEYS 8
+
+/** Sort engines available for key based sorting */
+typedef enum {
+    SORT_ENGINE_BUBBLE,     ///< Bubble sort (stable)
+    SORT_ENGINE_SELECTION,  ///< Selection sort (fewest swaps)
+    SORT_ENGINE_RADIX       ///< LSD radix sort on composite keys (stable)
+} SortEngine;
+
+/** Kinds of key expression */
+typedef enum {
+    SORT_KEY_SUM,     ///< Sum of all components
+    SORT_KEY_COLUMN   ///< A single component
+} SortKeyType;
+
+/**
+ * @struct SortKey
+ * @brief One key expression of a multi-key sort
+ */
+typedef struct {
+    SortKeyType type;  ///< What the key evaluates
+    int column;        ///< Component index for SORT_KEY_COLUMN
+    int descending;    ///< Non-zero to sort this key in descending order
+} SortKey;
+
+/**
+ * @brief Calculates the sum of values in a row
+ * @param row Array of values to sum
+ * @param m Number of elements in the row
+ * @return Sum of all elements
+ */
+double calculateRowSum(double* row, int m);
+
+/**
+ * @brief Sorts coordinates by row sum using bubble sort
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @return Statistics about the sorting operation
+ */
+SortStats sortCoordinates(double** coordinates, int n, int m);
+
+/**
+ * @brief Sorts coordinates by row sum using precomputed sums and selection sort
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @return Statistics about the sorting operation
+ */
+SortStats optimisedSortCoordinates(double** coordinates, int n, int m);
+
+/**
+ * @brief Parses a key list such as "sum,x,y" or "-sum,c2"
+ *
+ * Tokens are separated by commas. Recognized keys are "sum", "x", "y", "z"
+ * and "c<N>" for the zero-based component N. A leading '-' sorts that key in
+ * descending order.
+ *
+ * @param spec Key list to parse
+ * @param keys Output array of keys
+ * @param maxKeys Capacity of keys
+ * @return Number of keys parsed, or 0 if the list is empty or invalid
+ */
+int SortKeys_parse(const char* spec, SortKey* keys, int maxKeys);
+
+/**
+ * @brief Checks that every key refers to an existing component
+ * @param keys Keys to check
+ * @param nKeys Number of keys
+ * @param m Number of components per coordinate
+ * @return 1 if all keys are usable, 0 otherwise
+ */
+int SortKeys_isValid(const SortKey* keys, int nKeys, int m);
+
+/**
+ * @brief Sorts coordinates by a list of keys
+ *
+ * Rows that compare equal on every key keep their original relative order, so
+ * the result is identical whichever engine is used.
+ *
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @param keys Keys in priority order
+ * @param nKeys Number of keys
+ * @param engine Sort engine to use
+ * @return Statistics about the sorting operation
+ */
+SortStats sortCoordinatesByKeys(double** coordinates, int n, int m,
+                                const SortKey* keys, int nKeys, SortEngine engine);
+
+/**
+ * @brief Bytes of scratch memory sortCoordinatesByKeys allocates at its peak
+ * @param n Number of coordinates
+ * @param nKeys Number of keys
+ * @param engine Sort engine to use
+ * @return Scratch bytes, not counting the coordinates themselves
+ */
+long long sortCoordinatesByKeysScratchBytes(long long n, int nKeys, SortEngine engine);
+
+/**
+ * @brief Puts the first k rows in the order sortCoordinatesByKeys would give them
+ *
+ * Uses a partial selection followed by a sort of the k selected rows, so it
+ * costs O(n + k log k) instead of a full sort.
+ *
+ * @param coordinates 2D array of coordinates; afterwards the first k are sorted
+ *        and the others follow in no particular order
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @param keys Keys in priority order
+ * @param nKeys Number of keys
+ * @param k Number of leading rows wanted (clamped to [0, n])
+ * @return Statistics about the selection
+ */
+SortStats selectTopCoordinatesByKeys(double** coordinates, int n, int m,
+                                     const SortKey* keys, int nKeys, int k);
+
+/**
+ * @brief sortCoordinates that can be followed, cancelled and recorded
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @param progress Progress block to publish to, or NULL
+ * @param recording Recording to append passes to, or NULL; its n and final positions are set when the sort ends
+ * @return Statistics about the sorting operation
+ */
+SortStats sortCoordinatesTracked(double** coordinates, int n, int m, SortProgress* progress, SortRecording* recording);
+
+/**
+ * @brief optimisedSortCoordinates that can be followed, cancelled and recorded
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @param progress Progress block to publish to, or NULL
+ * @param recording Recording to append passes, new minimums and swaps to, or NULL
+ * @return Statistics about the sorting operation
+ */
+SortStats optimisedSortCoordinatesTracked(double** coordinates, int n, int m, SortProgress* progress,
+                                          SortRecording* recording);
+
+/**
+ * @brief sortCoordinatesByKeys that can be followed, cancelled and recorded
+ * @param coordinates 2D array of coordinates to sort
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @param keys Keys in priority order
+ * @param nKeys Number of keys
+ * @param engine Sort engine to use
+ * @param progress Progress block to publish to, or NULL
+ * @param recording Recording to append passes (and for selection, new minimums and swaps) to, or NULL
+ * @return Statistics about the sorting operation
+ */
+SortStats sortCoordinatesByKeysTracked(double** coordinates, int n, int m, const SortKey* keys, int nKeys,
+                                       SortEngine engine, SortProgress* progress, SortRecording* recording);
+
+/**
+ * @brief sortCoordinates with an explicit stats policy
+ * @tparam Stats NoSortStats, CountingSortStats or TimedSortStats
+ */
+template <typename Stats>
+SortStats sortCoordinatesWith(double** coordinates, int n, int m);
+
+/**
+ * @brief optimisedSortCoordinates with an explicit stats policy
+ * @tparam Stats NoSortStats, CountingSortStats or TimedSortStats
+ */
+template <typename Stats>
+SortStats optimisedSortCoordinatesWith(double** coordinates, int n, int m);
+
+/**
+ * @brief sortCoordinatesByKeys with an explicit stats policy
+ * @tparam Stats NoSortStats, CountingSortStats or TimedSortStats
+ */
+template <typename Stats>
+SortStats sortCoordinatesByKeysWith(double** coordinates, int n, int m,
+                                    const SortKey* keys, int nKeys, SortEngine engine);
+
+/**
+ * @brief selectTopCoordinatesByKeys with an explicit stats policy
+ * @tparam Stats NoSortStats, CountingSortStats or TimedSortStats
+ */
+template <typename Stats>
+SortStats selectTopCoordinatesByKeysWith(double** coordinates, int n, int m,
+                                         const SortKey* keys, int nKeys, int k);
+
+#endif // SORT_ENGINE_H
@@ -0,0 +1,79 @@
+/**
+ * @file sortProgress.h
+ * @brief Progress and cancellation of a sort running on another thread
+ *
+ * The sort and the thread watching it share a SortProgress. The sort adds
+ * the work of each pass as it finishes and checks for a cancel request at
+ * the same moment, so the compare loops are untouched: one pass is a whole
+ * sweep over the rows, which is rare enough that the relaxed atomic updates
+ * do not show in the sort time, yet frequent enough that a cancel is
+ * noticed quickly even on large inputs.
+ *
+ * Progress is a policy (ProgressSortStats) wrapped around the default stats
+ * policy, so sorts that nobody watches compile without it.
+ */
+
+#ifndef SORT_PROGRESS_H
+#define SORT_PROGRESS_H
+
+#include <atomic>
+#include "sortStats.h"
+
+/**
+ * @struct SortProgress
+ * @brief Progress block a sort publishes and its watcher polls
+ *
+ * Zero-initialise it (SortProgress progress = {};) before the sort starts.
+ */
+typedef struct {
+    std::atomic<int> cancelRequested;  ///< Set by the watcher to stop the sort at the next pass
+    std::atomic<int> finished;         ///< Set by the sort once it has returned
+    std::atomic<int> cancelled;        ///< Set with finished when the sort stopped early and restored the order
+    std::atomic<long long> passes;     ///< Passes completed
+    std::atomic<long long> work;       ///< Compares (or row moves for radix passes) completed
+    std::atomic<long long> totalWork;  ///< Estimated work of the whole sort, 0 until the sort knows it
+} SortProgress;
+
+/** Asks a running sort to stop; it restores the original order and sets finished */
+static inline void SortProgress_cancel(SortProgress* progress) {
+    progress->cancelRequested.store(1, std::memory_order_relaxed);
+}
+
+/** Estimated fraction of the sort done, from 0 to 1 */
+static inline double SortProgress_fraction(const SortProgress* progress) {
+    long long total = progress->totalWork.load(std::memory_order_relaxed);
+    if (total <= 0) {
+        return 0.0;
+    }
+    double fraction = (double)progress->work.load(std::memory_order_relaxed) / total;
+    return fraction < 1.0 ? fraction : 1.0;
+}
+
+/**
+ * @struct ProgressSortStats
+ * @brief Stats policy that also publishes progress and obeys cancel requests
+ *
+ * Engines call setTotalWork once they know how much work lies ahead and
+ * checkpoint after every pass. Once checkpoint returns 0 the engine stops
+ * and stopped stays set, so the caller can put the rows back.
+ *
+ * @tparam Base Policy whose counters and timers are kept as well
+ */
+template <typename Base>
+struct ProgressSortStats : Base {
+    SortProgress* progress = nullptr;
+    int stopped = 0;
+
+    void setTotalWork(long long work) { progress->totalWork.store(work, std::memory_order_relaxed); }
+    int checkpoint(long long work) {
+        progress->passes.fetch_add(1, std::memory_order_relaxed);
+        progress->work.fetch_add(work, std::memory_order_relaxed);
+        if (progress->cancelRequested.load(std::memory_order_relaxed)) {
+            stopped = 1;
+            return 0;
+        }
+        return 1;
+    }
+};
+
+#endif // SORT_PROGRESS_H
@@ -0,0 +1,252 @@
+/**
+ * @file sortRecording.cpp
+ * @brief Implementation of the sort event ring buffer
+ */
+
+#include "sortRecording.h"
+#include <stdlib.h>
+
+SortRecording* SortRecording_create(size_t maxBytes) {
+    uint64_t capacity = 1;
+    while (capacity * 2 * sizeof(uint64_t) <= maxBytes) {
+        capacity *= 2;
+    }
+    SortRecording* recording = (SortRecording*)malloc(sizeof(SortRecording));
+    if (!recording) {
+        return NULL;
+    }
+    recording->events = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    if (!recording->events) {
+        free(recording);
+        return NULL;
+    }
+    recording->mask = capacity - 1;
+    recording->count = 0;
+    recording->n = 0;
+    recording->finalPositions = NULL;
+    return recording;
+}
+
+uint64_t SortRecording_kept(const SortRecording* recording) {
+    return recording->count <= recording->mask ? recording->count : recording->mask + 1;
+}
+
+uint64_t SortRecording_event(const SortRecording* recording, uint64_t k) {
+    uint64_t first = recording->count - SortRecording_kept(recording);
+    return recording->events[(first + k) & recording->mask];
+}
+
+/** Home slot of a row address in a table of slots entries (a power of two) */
+static size_t rowSlot(const void* row, size_t slots) {
+    uint64_t bits = (uint64_t)(uintptr_t)row;
+    return (size_t)((bits ^ (bits >> 29)) * 0x9e3779b97f4a7c15ULL >> 32) & (slots - 1);
+}
+
+/** Slot of the address table in SortRecording_setOrder; position -1 marks an empty slot */
+typedef struct {
+    const void* row;
+    int position;
+} RowPosition;
+
+int SortRecording_setOrder(SortRecording* recording, const void* const* before, const void* const* after) {
+    free(recording->finalPositions);
+    recording->finalPositions = NULL;
+    if (!before) {
+        return 0;
+    }
+    int n = recording->n;
+    // Open addressing on the row address, at most half full
+    size_t slots = 2;
+    while (slots < (size_t)n * 2) {
+        slots *= 2;
+    }
+    RowPosition* table = (RowPosition*)malloc(slots * sizeof(RowPosition));
+    int* positions = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!table || !positions) {
+        free(table);
+        free(positions);
+        return 0;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        table[i].position = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        size_t slot = rowSlot(after[i], slots);
+        while (table[slot].position >= 0) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        table[slot].row = after[i];
+        table[slot].position = i;
+    }
+    int complete = 1;
+    for (int i = 0; i < n && complete; i++) {
+        size_t slot = rowSlot(before[i], slots);
+        while (table[slot].position >= 0 && table[slot].row != before[i]) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        positions[i] = table[slot].position;
+        complete = positions[i] >= 0;
+    }
+    free(table);
+    if (!complete) {
+        free(positions);
+        return 0;
+    }
+    recording->finalPositions = positions;
+    return 1;
+}
+
+void SortRecording_free(SortRecording* recording) {
+    if (recording) {
+        free(recording->events);
+        free(recording->finalPositions);
+        free(recording);
+    }
+}
+
+/** Number of compares a pass event stands for */
+static int passLength(SortEventType type, int start, int end) {
+    int length = type == SORT_EVENT_BUBBLE_PASS ? end - start : end - start - 1;
+    return length > 0 ? length : 0;
+}
+
+static void swapValues(SortReplay* replay, int first, int second) {
+    double temp = replay->values[first];
+    replay->values[first] = replay->values[second];
+    replay->values[second] = temp;
+    int position = replay->positions[first];
+    replay->positions[first] = replay->positions[second];
+    replay->positions[second] = position;
+    replay->swapA = first;
+    replay->swapB = second;
+}
+
+static int isPass(SortEventType type) {
+    return type == SORT_EVENT_BUBBLE_PASS || type == SORT_EVENT_SELECTION_PASS;
+}
+
+/** Bubble compare of neighbours j and j + 1: the row that ends up further right moves right */
+static void bubbleCompare(SortReplay* replay, int j) {
+    if (replay->positions[j] > replay->positions[j + 1]) {
+        swapValues(replay, j, j + 1);
+    }
+}
+
+int SortReplay_init(SortReplay* replay, const SortRecording* recording, const double* sortedValues) {
+    int n = recording->n;
+    replay->recording = recording;
+    replay->values = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    replay->positions = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!replay->values || !replay->positions) {
+        SortReplay_free(replay);
+        return 0;
+    }
+
+    // A wrapped ring may start inside a pass whose start was overwritten; replay from the next pass
+    uint64_t kept = SortRecording_kept(recording);
+    replay->next = 0;
+    while (replay->next < kept && !isPass(SortEvent_type(SortRecording_event(recording, replay->next)))) {
+        replay->next++;
+    }
+
+    replay->steps = 0;
+    for (uint64_t k = replay->next; k < kept; k++) {
+        uint64_t event = SortRecording_event(recording, k);
+        SortEventType type = SortEvent_type(event);
+        if (isPass(type)) {
+            replay->steps += passLength(type, SortEvent_first(event), SortEvent_second(event));
+        }
+    }
+
+    if (replay->next < kept && SortEvent_type(SortRecording_event(recording, replay->next)) == SORT_EVENT_BUBBLE_PASS) {
+        // Bubble passes log no swaps: start from the original order and redo the overwritten passes
+        if (!recording->finalPositions) {
+            SortReplay_free(replay);
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            replay->positions[i] = recording->finalPositions[i];
+            replay->values[i] = sortedValues[recording->finalPositions[i]];
+        }
+        uint64_t overwritten = recording->count - kept;
+        for (uint64_t pass = 0; pass < overwritten; pass++) {
+            for (int j = 0; j < n - 1 - (int)pass; j++) {
+                bubbleCompare(replay, j);
+            }
+        }
+    } else {
+        // Undo the selection swaps from there on, newest first, to get the order that pass starts from
+        for (int i = 0; i < n; i++) {
+            replay->positions[i] = i;
+            replay->values[i] = sortedValues[i];
+        }
+        for (uint64_t k = kept; k-- > replay->next;) {
+            uint64_t event = SortRecording_event(recording, k);
+            if (SortEvent_type(event) == SORT_EVENT_SWAP) {
+                swapValues(replay, SortEvent_first(event), SortEvent_second(event));
+            }
+        }
+    }
+    replay->pass = SORT_EVENT_BUBBLE_PASS;
+    replay->passStart = 0;
+    replay->passEnd = 0;
+    replay->cursor = 0;
+    replay->selected = 0;
+    replay->compareA = -1;
+    replay->compareB = -1;
+    replay->swapA = -1;
+    replay->swapB = -1;
+    replay->step = 0;
+    return 1;
+}
+
+int SortReplay_step(SortReplay* replay) {
+    const SortRecording* recording = replay->recording;
+    uint64_t kept = SortRecording_kept(recording);
+
+    // At the end of a pass, apply what the sort did after it (a selection swap), then start the next one
+    while (replay->cursor >= passLength(replay->pass, replay->passStart, replay->passEnd)) {
+        if (replay->next >= kept) {
+            replay->compareA = -1;
+            replay->compareB = -1;
+            return 0;
+        }
+        uint64_t event = SortRecording_event(recording, replay->next++);
+        SortEventType type = SortEvent_type(event);
+        if (isPass(type)) {
+            replay->pass = type;
+            replay->passStart = SortEvent_first(event);
+            replay->passEnd = SortEvent_second(event);
+            replay->cursor = 0;
+            replay->selected = replay->passStart;
+        } else if (type == SORT_EVENT_SWAP) {
+            swapValues(replay, SortEvent_first(event), SortEvent_second(event));
+        }
+    }
+
+    if (replay->pass == SORT_EVENT_BUBBLE_PASS) {
+        int j = replay->passStart + replay->cursor;
+        replay->compareA = j;
+        replay->compareB = j + 1;
+        bubbleCompare(replay, j);
+    } else {
+        int j = replay->passStart + 1 + replay->cursor;
+        replay->compareA = j;
+        replay->compareB = replay->selected;
+        uint64_t event = replay->next < kept ? SortRecording_event(recording, replay->next) : 0;
+        if (replay->next < kept && SortEvent_type(event) == SORT_EVENT_SELECT && SortEvent_first(event) == j) {
+            replay->selected = j;
+            replay->next++;
+        }
+    }
+    replay->cursor++;
+    replay->step++;
+    return 1;
+}
+
+void SortReplay_free(SortReplay* replay) {
+    free(replay->values);
+    free(replay->positions);
+    replay->values = NULL;
+    replay->positions = NULL;
+}
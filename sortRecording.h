@@ -0,0 +1,211 @@
+/**
+ * @file sortRecording.h
+ * @brief Compact log of the passes and swaps a sort performs, for replaying it
+ *
+ * Each event is one 64-bit word: the event type in the top two bits and two
+ * array positions in 31 bits each. Compares are not logged one by one. A
+ * bubble pass always compares neighbours from one end of its range to the
+ * other, and a selection pass compares every remaining position with the
+ * smallest found so far, so one event per pass says which compares it made.
+ *
+ * Selection passes also log each new minimum and their swap, which are rare.
+ * Bubble passes log nothing else: they swap on about every other compare, so
+ * an event per swap would cost more than the budget allows. Instead the
+ * recording keeps where every row ended up, and the replay redoes each bubble
+ * compare on those final positions. Bubble sort is stable, so a row that
+ * ends up further left always compared as smaller, and the outcome of every
+ * compare is known without logging it. Pass n of a bubble sort always covers
+ * the same positions, so the passes are logged after the sort and its loop
+ * runs unrecorded.
+ *
+ * Events go into a ring buffer whose size is a power of two, so recording is
+ * a store and an increment; once the ring is full the oldest events are
+ * overwritten. Swaps are their own inverse, so the order before the oldest
+ * kept selection pass can be rebuilt from the sorted result by undoing the
+ * kept swaps from newest to oldest. Bubble passes are replayed forward from
+ * the starting order, quickly running through any that were overwritten. A
+ * wrapped recording therefore still replays correctly, just not from the
+ * very start of the sort.
+ *
+ * Recording is a stats policy (RecordingSortStats) wrapped around the
+ * default one, so sorts that are not recorded compile without it.
+ */
+
+#ifndef SORT_RECORDING_H
+#define SORT_RECORDING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sortStats.h"
+
+/** Ring size when LAB06_RECORD_MB is not set */
+#define SORT_RECORDING_DEFAULT_MB 16
+
+/** Kinds of recorded event */
+typedef enum {
+    SORT_EVENT_BUBBLE_PASS,     ///< Neighbours (j, j + 1) are compared for j from first up to second (exclusive)
+    SORT_EVENT_SELECTION_PASS,  ///< Positions first + 1 up to second (exclusive) are compared with the minimum, which starts at first
+    SORT_EVENT_SELECT,          ///< The selection pass found a new minimum at first
+    SORT_EVENT_SWAP             ///< Positions first and second exchanged their rows (selection passes only)
+} SortEventType;
+
+
+/**
+ * @struct SortRecording
+ * @brief Ring buffer of packed sort events
+ */
+typedef struct {
+    uint64_t* events;   ///< Ring of packed events
+    uint64_t mask;      ///< Ring capacity - 1
+    uint64_t count;     ///< Events recorded in total, including overwritten ones
+    int n;              ///< Number of positions in the recorded array
+    int* finalPositions;  ///< Where the row at each starting position ended up, NULL until the sort has finished
+} SortRecording;
+
+/** Packs an event into one word */
+static inline uint64_t SortEvent_pack(SortEventType type, int first, int second) {
+    return ((uint64_t)type << 62) | ((uint64_t)(uint32_t)first << 31) | (uint32_t)second;
+}
+
+/** Type of a packed event */
+static inline SortEventType SortEvent_type(uint64_t event) {
+    return (SortEventType)(event >> 62);
+}
+
+/** First position of a packed event */
+static inline int SortEvent_first(uint64_t event) {
+    return (int)((event >> 31) & 0x7fffffff);
+}
+
+/** Second position of a packed event */
+static inline int SortEvent_second(uint64_t event) {
+    return (int)(event & 0x7fffffff);
+}
+
+/**
+ * @brief Creates an empty recording
+ * @param maxBytes Ring size in bytes, rounded down to a power of two events (at least one)
+ * @return New recording, or NULL on allocation failure
+ */
+SortRecording* SortRecording_create(size_t maxBytes);
+
+/**
+ * @brief Number of events still in the ring
+ * @param recording Recording to query
+ * @return min(count, capacity)
+ */
+uint64_t SortRecording_kept(const SortRecording* recording);
+
+/**
+ * @brief Gets a kept event, oldest first
+ * @param recording Recording to read
+ * @param k Index among the kept events, below SortRecording_kept
+ * @return Packed event
+ */
+uint64_t SortRecording_event(const SortRecording* recording, uint64_t k);
+
+/**
+ * @brief Stores where each row ended up, once the sort has finished
+ *
+ * Rows are told apart by address, so every row pointer must be distinct.
+ *
+ * @param recording Recording of the sort
+ * @param before Row pointers in their order before the sort (recording->n of them), or NULL to forget the positions
+ * @param after The same pointers in sorted order
+ * @return 1 on success, 0 if before is NULL, on allocation failure or if the two lists differ
+ */
+int SortRecording_setOrder(SortRecording* recording, const void* const* before, const void* const* after);
+
+/**
+ * @brief Frees a recording
+ * @param recording Recording to free (NULL is ignored)
+ */
+void SortRecording_free(SortRecording* recording);
+
+/**
+ * @struct SortReplay
+ * @brief Steps through a recording one compare at a time
+ */
+typedef struct {
+    const SortRecording* recording;
+    double* values;       ///< Value of the row at each position, as of the current step
+    int* positions;       ///< Final position of the row at each position, as of the current step
+    uint64_t next;        ///< Next kept event to apply
+    SortEventType pass;   ///< Kind of the current pass
+    int passStart;
+    int passEnd;
+    int cursor;           ///< Compares done in the current pass
+    int selected;         ///< Current minimum of a selection pass
+    int compareA;         ///< Positions of the latest compare, -1 if none
+    int compareB;
+    int swapA;            ///< Positions of the latest swap, -1 if none
+    int swapB;
+    uint64_t step;        ///< Compares replayed so far
+    uint64_t steps;       ///< Compares in the kept events
+} SortReplay;
+
+/**
+ * @brief Prepares a replay of the kept events
+ *
+ * The values at the start of the kept window are rebuilt from the values
+ * after the sort: by undoing the swaps of a selection sort, or by running
+ * the overwritten passes of a bubble sort from its starting order.
+ *
+ * @param replay Replay to set up
+ * @param recording Recording to replay
+ * @param sortedValues Value of the row at each position after the sort (recording->n of them)
+ * @return 1 on success, 0 on allocation failure or if a bubble sort has no final positions
+ * @note Free the replay with SortReplay_free
+ */
+int SortReplay_init(SortReplay* replay, const SortRecording* recording, const double* sortedValues);
+
+/**
+ * @brief Replays the next compare and whatever the sort did because of it
+ * @param replay Replay to advance
+ * @return 1 if a compare was replayed, 0 at the end of the recording
+ */
+int SortReplay_step(SortReplay* replay);
+
+/**
+ * @brief Frees the values of a replay
+ * @param replay Replay to free
+ */
+void SortReplay_free(SortReplay* replay);
+
+/**
+ * @struct RecordingSortStats
+ * @brief Stats policy that also logs passes and swaps into a SortRecording
+ *
+ * The ring pointer and event count are copied into the policy, which lives
+ * in the sorting function, so the compiler can keep them in registers instead
+ * of reloading them through the recording. finish() writes the count back.
+ *
+ * @tparam Base Policy whose counters and timers are kept as well
+ */
+template <typename Base>
+struct RecordingSortStats : Base {
+    SortRecording* recording;
+    uint64_t* events;
+    uint64_t mask;
+    uint64_t count;
+
+    explicit RecordingSortStats(SortRecording* target)
+        : recording(target), events(target->events), mask(target->mask), count(target->count) {}
+
+    void record(SortEventType type, int first, int second) {
+        events[count++ & mask] = SortEvent_pack(type, first, second);
+    }
+    void recordBubblePass(int start, int end) { record(SORT_EVENT_BUBBLE_PASS, start, end); }
+    void recordSelectionPass(int start, int end) { record(SORT_EVENT_SELECTION_PASS, start, end); }
+    void recordSelect(int position) { record(SORT_EVENT_SELECT, position, 0); }
+    void recordSwap(int first, int second) { record(SORT_EVENT_SWAP, first, second); }
+    void finish() { recording->count = count; }
+};
+
+/** The policy a recording wraps; see withoutRecording in sortStats.h */
+template <typename Base>
+Base& withoutRecording(RecordingSortStats<Base>& stats) {
+    return stats;
+}
+
+#endif // SORT_RECORDING_H
@@ -0,0 +1,180 @@
+/**
+ * @file sortStats.cpp
+ * @brief Implementation of sort statistics helpers
+ */
+
+#include "sortStats.h"
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+#ifndef LAB06_VERSION
+#define LAB06_VERSION "dev"
+#endif
+
+static double wallMilliseconds(void) {
+    std::chrono::duration<double, std::milli> now = std::chrono::steady_clock::now().time_since_epoch();
+    return now.count();
+}
+
+static double cpuMilliseconds(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) / 10000.0;  // 100 ns units
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+        return 0.0;
+    }
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+void PhaseTimer_start(PhaseTimer* timer) {
+    if (PerfCounters_enabled()) {
+        PerfCounters_read(timer->counterStart);
+    }
+    timer->wallStartMs = wallMilliseconds();
+    timer->cpuStartMs = cpuMilliseconds();
+}
+
+void PhaseTimer_stop(const PhaseTimer* timer, SortStats* stats, SortPhase phase) {
+    PhaseTime* time = &stats->phases[phase];
+    time->wallMs += wallMilliseconds() - timer->wallStartMs;
+    time->cpuMs += cpuMilliseconds() - timer->cpuStartMs;
+
+    if (PerfCounters_enabled()) {
+        long long now[PERF_COUNTER_COUNT];
+        PerfCounters_read(now);
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            if (now[c] < 0 || timer->counterStart[c] < 0 || time->counters[c] < 0) {
+                time->counters[c] = -1;
+            } else {
+                time->counters[c] += now[c] - timer->counterStart[c];
+            }
+        }
+    }
+}
+
+const char* SortStats_phaseName(SortPhase phase) {
+    switch (phase) {
+        case PHASE_LOAD: return "load";
+        case PHASE_KEYS: return "keys";
+        case PHASE_SORT: return "sort";
+        case PHASE_SAVE: return "save";
+        default: return "unknown";
+    }
+}
+
+void SortStats_add(SortStats* total, const SortStats* part) {
+    total->comparisons += part->comparisons;
+    total->swaps += part->swaps;
+    total->bytesMoved += part->bytesMoved;
+    total->allocations += part->allocations;
+    total->allocatedBytes += part->allocatedBytes;
+    if (part->peakMemoryBytes > total->peakMemoryBytes) {
+        total->peakMemoryBytes = part->peakMemoryBytes;
+    }
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        total->phases[p].wallMs += part->phases[p].wallMs;
+        total->phases[p].cpuMs += part->phases[p].cpuMs;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            if (total->phases[p].counters[c] < 0 || part->phases[p].counters[c] < 0) {
+                total->phases[p].counters[c] = -1;
+            } else {
+                total->phases[p].counters[c] += part->phases[p].counters[c];
+            }
+        }
+    }
+}
+
+void SortStats_capturePeakMemory(SortStats* stats) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        stats->peakMemoryBytes = (long long)counters.PeakWorkingSetSize;
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        stats->peakMemoryBytes = (long long)usage.ru_maxrss;          // bytes
+#else
+        stats->peakMemoryBytes = (long long)usage.ru_maxrss * 1024;   // kilobytes
+#endif
+    }
+#endif
+}
+
+/** Writes a JSON string literal, escaping quotes, backslashes and control characters */
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* p = text; p && *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void SortStats_writeJson(FILE* file, const SortStats* stats, const char* label,
+                         const char* input, int n, int m) {
+    fprintf(file, "{\"version\":");
+    writeJsonString(file, LAB06_VERSION);
+    fprintf(file, ",\"label\":");
+    writeJsonString(file, label);
+    fprintf(file, ",\"input\":");
+    writeJsonString(file, input ? input : "");
+    fprintf(file, ",\"n\":%d,\"m\":%d", n, m);
+    fprintf(file, ",\"comparisons\":%lld,\"swaps\":%lld,\"bytes_moved\":%lld",
+            stats->comparisons, stats->swaps, stats->bytesMoved);
+    fprintf(file, ",\"allocations\":%lld,\"allocated_bytes\":%lld,\"peak_memory_bytes\":%lld",
+            stats->allocations, stats->allocatedBytes, stats->peakMemoryBytes);
+    fprintf(file, ",\"phases\":{");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseTime* time = &stats->phases[p];
+        fprintf(file, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f", p ? "," : "",
+                SortStats_phaseName((SortPhase)p), time->wallMs, time->cpuMs);
+        if (PerfCounters_enabled()) {
+            fprintf(file, ",\"counters\":{");
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+                fprintf(file, "%s\"%s\":", c ? "," : "", PerfCounters_name((PerfCounter)c));
+                if (time->counters[c] < 0) fprintf(file, "null");
+                else fprintf(file, "%lld", time->counters[c]);
+            }
+            fprintf(file, "}");
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "}}\n");
+}
+
+int SortStats_appendJson(const char* filename, const SortStats* stats, const char* label,
+                         const char* input, int n, int m) {
+    FILE* file = fopen(filename, "a");
+    if (!file) {
+        return 0;
+    }
+    SortStats_writeJson(file, stats, label, input, n, m);
+    fclose(file);
+    return 1;
+}
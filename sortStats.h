@@ -0,0 +1,221 @@
+/**
+ * @file sortStats.h
+ * @brief Statistics and instrumentation policies for the sort pipeline
+ *
+ * SortStats collects 64-bit operation counters, memory figures and wall/CPU
+ * time for each pipeline phase (load, key computation, sort, save). The sort
+ * engines fill it through a compile-time stats policy; callers time the load
+ * and save phases with PhaseTimer. When hardware counters are enabled (see
+ * perfCounters.h), PhaseTimer also records their deltas for each phase.
+ */
+
+#ifndef SORT_STATS_H
+#define SORT_STATS_H
+
+#include <stdio.h>
+#include "perfCounters.h"
+
+/** Instrumentation level of the default sort entry points (0, 1 or 2) */
+#ifndef LAB06_SORT_STATS
+#define LAB06_SORT_STATS 2
+#endif
+
+/** Pipeline phases timed in SortStats */
+typedef enum {
+    PHASE_LOAD,    ///< Reading and parsing the input file
+    PHASE_KEYS,    ///< Computing sort keys (row sums, composite keys)
+    PHASE_SORT,    ///< Reordering rows
+    PHASE_SAVE,    ///< Writing the output file
+    PHASE_COUNT
+} SortPhase;
+
+/**
+ * @struct PhaseTime
+ * @brief Time spent in one phase
+ */
+typedef struct {
+    double wallMs;  ///< Elapsed wall-clock time in milliseconds
+    double cpuMs;   ///< Process CPU time in milliseconds (all threads)
+    long long counters[PERF_COUNTER_COUNT];  ///< Hardware counter deltas (-1 if unavailable)
+} PhaseTime;
+
+/**
+ * @struct SortStats
+ * @brief Statistics collected during sorting operations
+ */
+typedef struct {
+    long long comparisons;       ///< Number of comparisons performed
+    long long swaps;             ///< Number of swaps (or element moves) performed
+    long long bytesMoved;        ///< Bytes copied while reordering
+    long long allocations;       ///< Heap allocations made by the pipeline
+    long long allocatedBytes;    ///< Bytes requested by those allocations
+    long long peakMemoryBytes;   ///< Peak resident memory of the process
+    PhaseTime phases[PHASE_COUNT];  ///< Time per pipeline phase
+} SortStats;
+
+/**
+ * @struct PhaseTimer
+ * @brief Start point of a phase measurement
+ */
+typedef struct {
+    double wallStartMs;
+    double cpuStartMs;
+    long long counterStart[PERF_COUNTER_COUNT];
+} PhaseTimer;
+
+/**
+ * @brief Starts timing a phase
+ * @param timer Timer to start
+ */
+void PhaseTimer_start(PhaseTimer* timer);
+
+/**
+ * @brief Stops timing and adds the elapsed time to a phase
+ * @param timer Timer started with PhaseTimer_start
+ * @param stats Statistics to update
+ * @param phase Phase the time belongs to
+ */
+void PhaseTimer_stop(const PhaseTimer* timer, SortStats* stats, SortPhase phase);
+
+/**
+ * @brief Returns a short lowercase name for a phase ("load", "keys", ...)
+ * @param phase Phase to name
+ * @return Static string
+ */
+const char* SortStats_phaseName(SortPhase phase);
+
+/**
+ * @brief Adds counters and phase times of one stats record to another
+ * @param total Record to accumulate into
+ * @param part Record to add
+ */
+void SortStats_add(SortStats* total, const SortStats* part);
+
+/**
+ * @brief Records the peak resident memory of the process
+ * @param stats Statistics to update
+ */
+void SortStats_capturePeakMemory(SortStats* stats);
+
+/**
+ * @brief Writes statistics as a single-line JSON object
+ * @param file Output stream
+ * @param stats Statistics to write
+ * @param label Algorithm or run label
+ * @param input Input file name (may be NULL)
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ */
+void SortStats_writeJson(FILE* file, const SortStats* stats, const char* label,
+                         const char* input, int n, int m);
+
+/**
+ * @brief Appends statistics as one JSON line to a file
+ * @param filename File to append to
+ * @param stats Statistics to write
+ * @param label Algorithm or run label
+ * @param input Input file name (may be NULL)
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate
+ * @return 1 on success, 0 if the file could not be opened
+ */
+int SortStats_appendJson(const char* filename, const SortStats* stats, const char* label,
+                         const char* input, int n, int m);
+
+/**
+ * @struct NoSortStats
+ * @brief Stats policy that records nothing
+ *
+ * All hooks are empty inline functions, so an engine instantiated with this
+ * policy compiles to the same code as a sort without any instrumentation.
+ * The record* hooks report passes, new minimums and swaps by array position
+ * and only do something in RecordingSortStats (sortRecording.h). Likewise
+ * setTotalWork and checkpoint (which returns 0 to stop the sort) only
+ * publish progress in ProgressSortStats (sortProgress.h).
+ */
+struct NoSortStats {
+    void beginPhase(SortPhase) {}
+    void endPhase(SortPhase) {}
+    void addComparisons(long long) {}
+    void addSwap() {}
+    void addSwaps(long long) {}
+    void setSwapBytes(long long) {}
+    void addBytesMoved(long long) {}
+    void addAllocation(long long) {}
+    void recordBubblePass(int, int) {}
+    void recordSelectionPass(int, int) {}
+    void recordSelect(int) {}
+    void recordSwap(int, int) {}
+    void setTotalWork(long long) {}
+    int checkpoint(long long) { return 1; }
+    SortStats result() const { return SortStats{}; }
+};
+
+/**
+ * @struct CountingSortStats
+ * @brief Stats policy that counts comparisons, swaps, bytes moved and allocations
+ *
+ * Engines report comparisons in bulk once per pass where the count is known
+ * up front, keeping the counter out of the inner loop. Bytes moved by swaps
+ * are derived from the swap count when the result is taken.
+ */
+struct CountingSortStats {
+    SortStats stats = {};
+    long long swapBytes = 0;
+
+    void beginPhase(SortPhase) {}
+    void endPhase(SortPhase) {}
+    void addComparisons(long long count) { stats.comparisons += count; }
+    void addSwap() { stats.swaps++; }
+    void addSwaps(long long count) { stats.swaps += count; }
+    void setSwapBytes(long long bytes) { swapBytes = bytes; }
+    void addBytesMoved(long long bytes) { stats.bytesMoved += bytes; }
+    void addAllocation(long long bytes) {
+        stats.allocations++;
+        stats.allocatedBytes += bytes;
+    }
+    void recordBubblePass(int, int) {}
+    void recordSelectionPass(int, int) {}
+    void recordSelect(int) {}
+    void recordSwap(int, int) {}
+    void setTotalWork(long long) {}
+    int checkpoint(long long) { return 1; }
+    SortStats result() const {
+        SortStats total = stats;
+        total.bytesMoved += total.swaps * swapBytes;
+        return total;
+    }
+};
+
+/**
+ * @struct TimedSortStats
+ * @brief Stats policy that also records wall and CPU time per phase
+ */
+struct TimedSortStats : CountingSortStats {
+    PhaseTimer timers[PHASE_COUNT] = {};
+
+    void beginPhase(SortPhase phase) { PhaseTimer_start(&timers[phase]); }
+    void endPhase(SortPhase phase) { PhaseTimer_stop(&timers[phase], &stats, phase); }
+};
+
+#if LAB06_SORT_STATS == 0
+typedef NoSortStats DefaultSortStats;
+#elif LAB06_SORT_STATS == 1
+typedef CountingSortStats DefaultSortStats;
+#else
+typedef TimedSortStats DefaultSortStats;
+#endif
+
+/**
+ * @brief Policy to run a loop under when its record* events are written after it
+ *
+ * This is the policy itself. RecordingSortStats (sortRecording.h) overloads
+ * it to return the policy it wraps, so such a loop compiles to the same code
+ * whether the sort is recorded or not.
+ */
+template <typename Stats>
+Stats& withoutRecording(Stats& stats) {
+    return stats;
+}
+
+#endif // SORT_STATS_H
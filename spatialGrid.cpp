@@ -0,0 +1,286 @@
+/**
+ * @file spatialGrid.cpp
+ * @brief Implementation of the uniform grid index
+ */
+
+#include "spatialGrid.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+/** Minimum rows per worker before another build thread is worth starting */
+#define GRID_ROWS_PER_THREAD 65536
+
+static int chooseThreadCount(int n) {
+    int hw = (int)std::thread::hardware_concurrency();
+    if (hw < 1) hw = 1;
+    int wanted = n / GRID_ROWS_PER_THREAD + 1;
+    return wanted < hw ? wanted : hw;
+}
+
+/** Runs body(thread, begin, end) over [0, n) split into nThreads contiguous chunks */
+template <typename Body>
+static void parallelChunks(int n, int nThreads, Body body) {
+    if (nThreads <= 1) {
+        body(0, 0, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        int begin = (int)((long long)n * t / nThreads);
+        int end = (int)((long long)n * (t + 1) / nThreads);
+        workers.emplace_back([=]() {
+            TRACE_THREAD_NAME("grid worker");
+            body(t, begin, end);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Clamps a fractional cell position to [0, cells - 1]. The clamp is done in
+ * double because converting an out-of-range double to int is undefined
+ * (x86 yields INT_MIN); NaN goes to cell 0.
+ */
+static inline int clampCell(double cell, int cells) {
+    if (!(cell >= 0)) return 0;
+    if (cell >= cells - 1) return cells - 1;
+    return (int)cell;
+}
+
+static inline int cellColumn(const SpatialGrid* grid, double x) {
+    return clampCell((x - grid->originX) / grid->cellWidth, grid->cellsX);
+}
+
+static inline int cellRow(const SpatialGrid* grid, double y) {
+    return clampCell((y - grid->originY) / grid->cellHeight, grid->cellsY);
+}
+
+static inline int cellIndex(const SpatialGrid* grid, const double* row) {
+    return cellRow(grid, row[1]) * grid->cellsX + cellColumn(grid, row[0]);
+}
+
+/**
+ * Extent of finite bounds, or 0 when there are none. An extent too large for
+ * a double is capped; the coordinates beyond it then land in the last cell.
+ */
+static double finiteExtent(double low, double high) {
+    if (!(low <= high)) {
+        return 0;
+    }
+    double extent = high - low;
+    return isfinite(extent) ? extent : DBL_MAX;
+}
+
+/**
+ * Picks the grid shape so cells are roughly square in data units and hold
+ * about SPATIAL_GRID_ROWS_PER_CELL rows each. Degenerate axes get one cell.
+ * The bounds are those of the finite coordinates (low > high if there are
+ * none), so infinite or NaN values cannot make the shape undefined; the
+ * shape is worked out in double and clamped before converting to int.
+ */
+static void chooseCellLayout(SpatialGrid* grid, double lowX, double lowY, double highX, double highY) {
+    double width = finiteExtent(lowX, highX);
+    double height = finiteExtent(lowY, highY);
+    grid->originX = lowX <= highX ? lowX : 0;
+    grid->originY = lowY <= highY ? lowY : 0;
+    double targetCells = (double)grid->count / SPATIAL_GRID_ROWS_PER_CELL;
+    if (targetCells < 1) targetCells = 1;
+
+    if (width <= 0 && height <= 0) {
+        grid->cellsX = 1;
+        grid->cellsY = 1;
+    } else if (width <= 0) {
+        grid->cellsX = 1;
+        grid->cellsY = (int)targetCells;
+    } else if (height <= 0) {
+        grid->cellsX = (int)targetCells;
+        grid->cellsY = 1;
+    } else {
+        double columns = ceil(sqrt(targetCells * (width / height)));
+        if (!(columns >= 1)) columns = 1;
+        if (columns > targetCells) columns = targetCells;
+        grid->cellsX = (int)columns;
+        grid->cellsY = (int)ceil(targetCells / grid->cellsX);
+    }
+
+    grid->cellWidth = width > 0 ? width / grid->cellsX : 1.0;
+    grid->cellHeight = height > 0 ? height / grid->cellsY : 1.0;
+}
+
+int SpatialGrid_build(SpatialGrid* grid, double** coordinates, int n, int m) {
+    TRACE_SCOPE("SpatialGrid_build");
+    memset(grid, 0, sizeof(SpatialGrid));
+    if (!coordinates || n <= 0 || m < 2) {
+        return 0;
+    }
+    grid->count = n;
+    int nThreads = chooseThreadCount(n);
+
+    // Pass 1: data bounds, reduced per thread. The first four are the bounds of all
+    // values but NaN, which queries compare against; the last four are the finite
+    // bounds the cells are laid over.
+    std::vector<double> bounds(8 * nThreads);
+    parallelChunks(n, nThreads, [&](int t, int begin, int end) {
+        TRACE_SCOPE("grid.bounds");
+        double lowX = INFINITY, lowY = INFINITY, highX = -INFINITY, highY = -INFINITY;
+        double finiteLowX = INFINITY, finiteLowY = INFINITY, finiteHighX = -INFINITY, finiteHighY = -INFINITY;
+        for (int i = begin; i < end; i++) {
+            double x = coordinates[i][0], y = coordinates[i][1];
+            if (x < lowX) lowX = x;
+            if (x > highX) highX = x;
+            if (y < lowY) lowY = y;
+            if (y > highY) highY = y;
+            if (isfinite(x)) {
+                if (x < finiteLowX) finiteLowX = x;
+                if (x > finiteHighX) finiteHighX = x;
+            }
+            if (isfinite(y)) {
+                if (y < finiteLowY) finiteLowY = y;
+                if (y > finiteHighY) finiteHighY = y;
+            }
+        }
+        double* chunk = &bounds[8 * t];
+        chunk[0] = lowX;
+        chunk[1] = lowY;
+        chunk[2] = highX;
+        chunk[3] = highY;
+        chunk[4] = finiteLowX;
+        chunk[5] = finiteLowY;
+        chunk[6] = finiteHighX;
+        chunk[7] = finiteHighY;
+    });
+    for (int t = 1; t < nThreads; t++) {
+        for (int b = 0; b < 2; b++) {
+            double* total = &bounds[4 * b];
+            const double* chunk = &bounds[8 * t + 4 * b];
+            if (chunk[0] < total[0]) total[0] = chunk[0];
+            if (chunk[1] < total[1]) total[1] = chunk[1];
+            if (chunk[2] > total[2]) total[2] = chunk[2];
+            if (chunk[3] > total[3]) total[3] = chunk[3];
+        }
+    }
+    grid->minX = bounds[0];
+    grid->minY = bounds[1];
+    grid->maxX = bounds[2];
+    grid->maxY = bounds[3];
+    chooseCellLayout(grid, bounds[4], bounds[5], bounds[6], bounds[7]);
+
+    int nCells = grid->cellsX * grid->cellsY;
+    grid->cellStart = (int*)malloc((nCells + 1) * sizeof(int));
+    grid->rows = (double**)malloc(n * sizeof(double*));
+    int* histograms = (int*)calloc((size_t)nCells * nThreads, sizeof(int));
+    if (!grid->cellStart || !grid->rows || !histograms) {
+        free(histograms);
+        SpatialGrid_free(grid);
+        return 0;
+    }
+
+    // Pass 2: per-thread cell histograms
+    parallelChunks(n, nThreads, [&](int t, int begin, int end) {
+        TRACE_SCOPE("grid.histogram");
+        int* histogram = histograms + (size_t)nCells * t;
+        for (int i = begin; i < end; i++) {
+            histogram[cellIndex(grid, coordinates[i])]++;
+        }
+    });
+
+    // Prefix sum: cell-major, thread-minor, so each thread gets its own slots
+    // and the scatter below stays stable
+    int offset = 0;
+    for (int c = 0; c < nCells; c++) {
+        grid->cellStart[c] = offset;
+        for (int t = 0; t < nThreads; t++) {
+            int cellCount = histograms[(size_t)nCells * t + c];
+            histograms[(size_t)nCells * t + c] = offset;
+            offset += cellCount;
+        }
+    }
+    grid->cellStart[nCells] = offset;
+
+    // Pass 3: scatter row pointers into their cells
+    parallelChunks(n, nThreads, [&](int t, int begin, int end) {
+        TRACE_SCOPE("grid.scatter");
+        int* cursor = histograms + (size_t)nCells * t;
+        for (int i = begin; i < end; i++) {
+            grid->rows[cursor[cellIndex(grid, coordinates[i])]++] = coordinates[i];
+        }
+    });
+
+    free(histograms);
+    return 1;
+}
+
+double** SpatialGrid_queryRange(const SpatialGrid* grid, double minX, double minY,
+                                double maxX, double maxY, int* count) {
+    TRACE_SCOPE("SpatialGrid_queryRange");
+    *count = 0;
+    // NaN bounds match nothing; infinite ones are clamped to the edge cells
+    if (isnan(minX) || isnan(minY) || isnan(maxX) || isnan(maxY)) {
+        return NULL;
+    }
+    if (!grid->rows || minX > maxX || minY > maxY ||
+        maxX < grid->minX || minX > grid->maxX ||
+        maxY < grid->minY || minY > grid->maxY) {
+        return NULL;
+    }
+
+    int firstX = cellColumn(grid, minX), lastX = cellColumn(grid, maxX);
+    int firstY = cellRow(grid, minY), lastY = cellRow(grid, maxY);
+
+    // Upper bound on matches is the population of the overlapping cells
+    int capacity = 0;
+    for (int cy = firstY; cy <= lastY; cy++) {
+        int rowBase = cy * grid->cellsX;
+        capacity += grid->cellStart[rowBase + lastX + 1] - grid->cellStart[rowBase + firstX];
+    }
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    double** results = (double**)malloc(capacity * sizeof(double*));
+    if (!results) {
+        return NULL;
+    }
+
+    int found = 0;
+    for (int cy = firstY; cy <= lastY; cy++) {
+        // Cells in a grid row are contiguous, so one span covers the whole strip
+        int rowBase = cy * grid->cellsX;
+        int begin = grid->cellStart[rowBase + firstX];
+        int end = grid->cellStart[rowBase + lastX + 1];
+        for (int i = begin; i < end; i++) {
+            const double* row = grid->rows[i];
+            if (row[0] >= minX && row[0] <= maxX && row[1] >= minY && row[1] <= maxY) {
+                results[found++] = grid->rows[i];
+            }
+        }
+    }
+
+    if (found == 0) {
+        free(results);
+        return NULL;
+    }
+    *count = found;
+    return results;
+}
+
+void SpatialGrid_freeResults(double** results) {
+    free(results);
+}
+
+void SpatialGrid_free(SpatialGrid* grid) {
+    if (grid) {
+        free(grid->cellStart);
+        free(grid->rows);
+        grid->cellStart = NULL;
+        grid->rows = NULL;
+        grid->count = 0;
+    }
+}
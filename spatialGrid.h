@@ -0,0 +1,80 @@
+/**
+ * @file spatialGrid.h
+ * @brief Uniform grid index for axis-aligned range queries over coordinates
+ *
+ * Rows are bucketed into a regular grid of cells with a parallel counting sort.
+ * Cell sizes are derived from the data bounds so that each cell holds roughly
+ * SPATIAL_GRID_ROWS_PER_CELL rows. Range queries only visit the cells that
+ * overlap the query rectangle. The grid spans the finite coordinates; rows
+ * with an infinite or NaN x or y are kept in the edge cells, where queries
+ * still compare them like any other row.
+ *
+ * The grid stores borrowed row pointers; the coordinate array it was built from
+ * must outlive the grid. Query results are arrays of the same row pointers, so
+ * they can be passed straight to the sort, display and save functions.
+ */
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+/** Target average number of rows per grid cell */
+#define SPATIAL_GRID_ROWS_PER_CELL 2
+
+/**
+ * @struct SpatialGrid
+ * @brief Bucketed grid over the first two components (x, y) of each row
+ */
+typedef struct {
+    double minX;         ///< Lower x bound of the indexed data (NaN ignored, may be infinite)
+    double minY;         ///< Lower y bound of the indexed data (NaN ignored, may be infinite)
+    double maxX;         ///< Upper x bound of the indexed data (NaN ignored, may be infinite)
+    double maxY;         ///< Upper y bound of the indexed data (NaN ignored, may be infinite)
+    double originX;      ///< x of the grid's lower edge, the lowest finite x
+    double originY;      ///< y of the grid's lower edge, the lowest finite y
+    double cellWidth;    ///< Width of one cell
+    double cellHeight;   ///< Height of one cell
+    int cellsX;          ///< Number of cell columns
+    int cellsY;          ///< Number of cell rows
+    int* cellStart;      ///< Offset of each cell in rows (cellsX * cellsY + 1 entries)
+    double** rows;       ///< Row pointers grouped by cell
+    int count;           ///< Number of indexed rows
+} SpatialGrid;
+
+/**
+ * @brief Builds a grid index over a coordinate array
+ * @param grid Grid to initialize
+ * @param coordinates 2D array of coordinates (x in column 0, y in column 1)
+ * @param n Number of coordinates
+ * @param m Number of components per coordinate (must be at least 2)
+ * @return 1 on success, 0 on invalid input or allocation failure
+ * @note Release with SpatialGrid_free
+ */
+int SpatialGrid_build(SpatialGrid* grid, double** coordinates, int n, int m);
+
+/**
+ * @brief Finds all coordinates inside an axis-aligned rectangle (bounds inclusive)
+ * @param grid Grid to query
+ * @param minX Lower x bound
+ * @param minY Lower y bound
+ * @param maxX Upper x bound
+ * @param maxY Upper y bound
+ * @param count Output parameter for number of matching rows
+ * @return Array of row pointers into the indexed data, or NULL if nothing matched
+ * @note Free the result with SpatialGrid_freeResults, not FileHandler_freeCoordinates
+ */
+double** SpatialGrid_queryRange(const SpatialGrid* grid, double minX, double minY,
+                                double maxX, double maxY, int* count);
+
+/**
+ * @brief Frees a result array returned by SpatialGrid_queryRange
+ * @param results Result array to free (rows themselves are not freed)
+ */
+void SpatialGrid_freeResults(double** results);
+
+/**
+ * @brief Frees memory owned by the grid
+ * @param grid Grid to release
+ */
+void SpatialGrid_free(SpatialGrid* grid);
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,138 @@
+/**
+ * @file spatialGridTest.cpp
+ * @brief Range query checks for the uniform grid index (run by ctest)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "spatialGrid.h"
+
+static int g_failures = 0;
+
+/** Runs one query and compares its match count with a brute-force scan */
+static void checkQuery(const SpatialGrid* grid, double** rows, int n,
+                       double minX, double minY, double maxX, double maxY, const char* name) {
+    int expected = 0;
+    for (int i = 0; i < n; i++) {
+        if (rows[i][0] >= minX && rows[i][0] <= maxX && rows[i][1] >= minY && rows[i][1] <= maxY) {
+            expected++;
+        }
+    }
+    int count = 0;
+    double** results = SpatialGrid_queryRange(grid, minX, minY, maxX, maxY, &count);
+    if (count != expected) {
+        printf("FAIL %s: %d matches, expected %d\n", name, count, expected);
+        g_failures++;
+    }
+    SpatialGrid_freeResults(results);
+}
+
+/** Allocates n rows of two components */
+static double** allocateRows(int n) {
+    double** rows = (double**)malloc(n * sizeof(double*));
+    for (int i = 0; i < n; i++) {
+        rows[i] = (double*)malloc(2 * sizeof(double));
+    }
+    return rows;
+}
+
+static void freeRows(double** rows, int n) {
+    for (int i = 0; i < n; i++) {
+        free(rows[i]);
+    }
+    free(rows);
+}
+
+/** Builds a grid over the rows and checks a fixed set of queries against a brute-force scan */
+static void checkDataset(double** rows, int n, const char* dataset) {
+    SpatialGrid grid;
+    if (!SpatialGrid_build(&grid, rows, n, 2)) {
+        printf("FAIL %s: build\n", dataset);
+        g_failures++;
+        return;
+    }
+    const double queries[][4] = {
+        {-0.5, -0.5, 0.5, 0.5},
+        {-1000, -1000, 1000, 1000},
+        {0, -INFINITY, INFINITY, 0},
+        {-INFINITY, -INFINITY, INFINITY, INFINITY},
+        {1e300, 1e300, INFINITY, INFINITY},
+        {-INFINITY, -INFINITY, -1e300, -1e300},
+        {-DBL_MAX, -DBL_MAX, DBL_MAX, DBL_MAX},
+        {0.25, 0.25, 0.25, 0.25},
+    };
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+        char name[96];
+        snprintf(name, sizeof(name), "%s, query %d", dataset, (int)q);
+        checkQuery(&grid, rows, n, queries[q][0], queries[q][1], queries[q][2], queries[q][3], name);
+    }
+    SpatialGrid_free(&grid);
+}
+
+int main(void) {
+    // Points on a diagonal, so every cell row and column is populated
+    int n = 1000;
+    double** rows = allocateRows(n);
+    for (int i = 0; i < n; i++) {
+        rows[i][0] = i;
+        rows[i][1] = i;
+    }
+    SpatialGrid grid;
+    if (!SpatialGrid_build(&grid, rows, n, 2)) {
+        printf("FAIL build\n");
+        return 1;
+    }
+
+    checkQuery(&grid, rows, n, 100, 100, 200, 200, "inside");
+    checkQuery(&grid, rows, n, 0, 0, 1e12, 1e12, "upper bound far outside");
+    checkQuery(&grid, rows, n, -1e12, -1e12, 500, 500, "lower bound far outside");
+    checkQuery(&grid, rows, n, -1e300, -1e300, 1e300, 1e300, "both bounds far outside");
+    checkQuery(&grid, rows, n, -INFINITY, -INFINITY, INFINITY, INFINITY, "infinite bounds");
+    checkQuery(&grid, rows, n, NAN, 0, 1000, 1000, "NaN bound");
+
+    SpatialGrid_free(&grid);
+    freeRows(rows, n);
+
+    // Enough rows for the build to split over threads (GRID_ROWS_PER_THREAD is 65536)
+    n = 300000;
+    rows = allocateRows(n);
+    srand(26);
+    for (int i = 0; i < n; i++) {
+        rows[i][0] = (double)rand() / RAND_MAX * 2 - 1;
+        rows[i][1] = (double)rand() / RAND_MAX * 2 - 1;
+    }
+    checkDataset(rows, n, "uniform");
+
+    // Non-finite values scattered through the same rows, in every thread's chunk
+    for (int i = 0; i < n; i += 997) {
+        rows[i][0] = NAN;
+        rows[i + 1][1] = INFINITY;
+        rows[i + 2][0] = -INFINITY;
+        rows[i + 3][0] = INFINITY;
+        rows[i + 3][1] = NAN;
+    }
+    checkDataset(rows, n, "non-finite");
+
+    // Extents too large for a double, and a height of almost nothing
+    for (int i = 0; i < n; i++) {
+        rows[i][0] = i % 2 ? DBL_MAX : -DBL_MAX;
+        rows[i][1] = i % 3 ? 0.25 : nextafter(0.25, 1);
+    }
+    rows[7][0] = NAN;
+    checkDataset(rows, n, "huge extent");
+
+    // No finite value at all
+    for (int i = 0; i < n; i++) {
+        rows[i][0] = i % 2 ? NAN : INFINITY;
+        rows[i][1] = -INFINITY;
+    }
+    checkDataset(rows, n, "nothing finite");
+    freeRows(rows, n);
+
+    if (g_failures == 0) {
+        printf("All spatial grid checks passed\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
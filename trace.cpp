@@ -0,0 +1,228 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of scoped tracing
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACE_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_HAS_TSC 1
+#else
+#define TRACE_HAS_TSC 0
+#endif
+
+/**
+ * @struct TraceEvent
+ * @brief One complete event
+ *
+ * The fields are relaxed atomics (plain stores on common hardware) because
+ * Trace_flush may read a slot while its thread overwrites it.
+ */
+typedef struct {
+    std::atomic<const char*> name;
+    std::atomic<long long> startTicks;
+    std::atomic<long long> endTicks;
+} TraceEvent;
+
+/**
+ * @struct TraceBuffer
+ * @brief Ring buffer of events written by a single thread at a time
+ *
+ * count is published with release ordering after each event, so a flush
+ * that reads it with acquire ordering sees complete events. A flush that
+ * races with a wrap detects overwritten slots and skips them, like a seqlock.
+ */
+typedef struct TraceBuffer {
+    TraceEvent events[TRACE_EVENTS_PER_THREAD];
+    std::atomic<unsigned long long> count;   ///< Events recorded so far (may exceed capacity)
+    int threadId;                            ///< Small id used as "tid" in the output
+    char threadName[32];                     ///< Guarded by g_registryMutex
+    struct TraceBuffer* nextFree;            ///< Link in g_freeBuffers while no thread owns the buffer
+} TraceBuffer;
+
+static std::atomic<int> g_traceEnabled{0};
+static char g_tracePath[260];
+static long long g_originTicks = 0;   ///< Trace clock at Trace_init
+static long long g_originNs = 0;      ///< Steady clock at Trace_init
+static std::mutex g_registryMutex;
+static std::vector<TraceBuffer*> g_buffers;
+static TraceBuffer* g_freeBuffers = NULL;   ///< Buffers of threads that have exited
+static thread_local TraceBuffer* t_buffer = NULL;
+
+/** Hands the thread's buffer back when the thread exits; kept apart from t_buffer so recording stays cheap */
+struct TraceThreadExit {
+    TraceBuffer* buffer = NULL;
+    ~TraceThreadExit() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            buffer->nextFree = g_freeBuffers;
+            g_freeBuffers = buffer;
+        }
+    }
+};
+static thread_local TraceThreadExit t_exit;
+
+/**
+ * Gives the calling thread a buffer. Buffers stay registered until exit so a
+ * late flush still sees their events; a thread reuses the buffer of one that
+ * has exited, keeping its events and tid, so memory is bounded by the number
+ * of threads alive at once rather than by the number ever started.
+ */
+static TraceBuffer* registerThread(void) {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    TraceBuffer* buffer = g_freeBuffers;
+    if (buffer) {
+        g_freeBuffers = buffer->nextFree;
+    } else {
+        buffer = new (std::nothrow) TraceBuffer();
+        if (!buffer) {
+            return NULL;
+        }
+        buffer->threadId = (int)g_buffers.size() + 1;
+        g_buffers.push_back(buffer);
+    }
+    snprintf(buffer->threadName, sizeof(buffer->threadName), "thread %d", buffer->threadId);
+    t_buffer = buffer;
+    t_exit.buffer = buffer;
+    return buffer;
+}
+
+static long long steadyNanoseconds(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+long long Trace_now(void) {
+    // The time stamp counter is much cheaper to read than the OS clock;
+    // ticks are converted to nanoseconds once, when the trace is written
+#if TRACE_HAS_TSC
+    return (long long)__rdtsc();
+#else
+    return steadyNanoseconds();
+#endif
+}
+
+void Trace_init(void) {
+    const char* path = getenv("LAB06_TRACE_FILE");
+    if (!LAB06_TRACE || !path || !*path || g_traceEnabled.load()) {
+        return;
+    }
+    snprintf(g_tracePath, sizeof(g_tracePath), "%s", path);
+    g_originTicks = Trace_now();
+    g_originNs = steadyNanoseconds();
+    g_traceEnabled.store(1);
+    Trace_setThreadName("main");
+    atexit(Trace_flush);
+}
+
+int Trace_enabled(void) {
+    return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace_setThreadName(const char* name) {
+    if (!Trace_enabled()) {
+        return;
+    }
+    TraceBuffer* buffer = t_buffer ? t_buffer : registerThread();
+    if (buffer) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", name);
+    }
+}
+
+void Trace_record(const char* name, long long startTicks, long long endTicks) {
+    TraceBuffer* buffer = t_buffer ? t_buffer : registerThread();
+    if (!buffer) {
+        return;
+    }
+    // Only this thread writes count; the fence orders the slot stores after the
+    // previous event's count, which is what lets a flush detect an overwrite
+    unsigned long long count = buffer->count.load(std::memory_order_relaxed);
+    TraceEvent* event = &buffer->events[count % TRACE_EVENTS_PER_THREAD];
+    std::atomic_thread_fence(std::memory_order_release);
+    event->name.store(name, std::memory_order_relaxed);
+    event->startTicks.store(startTicks, std::memory_order_relaxed);
+    event->endTicks.store(endTicks, std::memory_order_relaxed);
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+/** Writes text as a JSON string, quotes included */
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', file);
+            fputc(*p, file);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void Trace_flush(void) {
+    if (!Trace_enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    FILE* file = fopen(g_tracePath, "w");
+    if (!file) {
+        fprintf(stderr, "Error creating trace file: %s\n", g_tracePath);
+        return;
+    }
+
+    // Calibrate ticks against the steady clock over the whole run
+    double ticksPerUs = 1000.0;
+    long long elapsedNs = steadyNanoseconds() - g_originNs;
+    if (TRACE_HAS_TSC && elapsedNs > 0) {
+        ticksPerUs = (double)(Trace_now() - g_originTicks) * 1000.0 / elapsedNs;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int first = 1;
+    for (TraceBuffer* buffer : g_buffers) {
+        fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+                first ? "" : ",\n", buffer->threadId);
+        writeJsonString(file, buffer->threadName);
+        fprintf(file, "}}");
+        first = 0;
+
+        // Oldest surviving event first when the ring has wrapped. The owning
+        // thread may still be recording: events after count are ignored, and a
+        // slot it has started to overwrite since (count moved a whole ring past
+        // it) is skipped rather than written torn.
+        unsigned long long count = buffer->count.load(std::memory_order_acquire);
+        unsigned long long begin = count > TRACE_EVENTS_PER_THREAD ? count - TRACE_EVENTS_PER_THREAD : 0;
+        for (unsigned long long i = begin; i < count; i++) {
+            const TraceEvent* event = &buffer->events[i % TRACE_EVENTS_PER_THREAD];
+            const char* name = event->name.load(std::memory_order_relaxed);
+            long long startTicks = event->startTicks.load(std::memory_order_relaxed);
+            long long endTicks = event->endTicks.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer->count.load(std::memory_order_relaxed) >= i + TRACE_EVENTS_PER_THREAD) {
+                continue;
+            }
+            fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":", buffer->threadId);
+            writeJsonString(file, name);
+            fprintf(file, ",\"ts\":%.3f,\"dur\":%.3f}",
+                    (startTicks - g_originTicks) / ticksPerUs,
+                    (endTicks - startTicks) / ticksPerUs);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}